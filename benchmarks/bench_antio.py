@@ -0,0 +1,240 @@
+"""Benchmark the end-to-end Python read paths of antio.
+
+Every case is timed over the recordings bundled in ``tests/data`` and over
+synthetic recordings made by repeating one of them to a given duration. For each
+case the wall time (best and median of the repeats) and the peak memory of one
+extra run are reported. The peak memory is split between the Python heap, numpy
+arrays included, as seen by :mod:`tracemalloc` and the memory held by libeep as
+seen by :func:`antio.libeep.get_memory_stats`. Buffers allocated by the binding
+outside of both are only visible in the growth of the resident set size over the
+run, also reported.
+
+Run from the root of the repository::
+
+    python benchmarks/bench_antio.py --output results.json
+"""
+
+from __future__ import annotations
+
+import gc
+import importlib.util
+import json
+import platform
+import statistics
+import tempfile
+import time
+import tracemalloc
+from pathlib import Path
+
+import click
+import numpy as np
+import psutil
+
+import antio
+from antio import libeep
+from antio.libeep import pyeep, read_cnt
+from antio.parser import read_data, read_info, read_triggers
+
+DATA = Path(__file__).parents[1] / "tests" / "data"
+SOURCE = DATA / "CA_208" / "test_CA_208_start_stop.cnt"
+
+
+def _case_read_cnt(fname):
+    read_cnt(fname)
+
+
+def _case_get_samples_as_nparray(fname):
+    cnt = read_cnt(fname)
+    cnt.get_samples_as_nparray(0, cnt.get_sample_count())
+
+
+def _case_read_data(fname):
+    read_data(read_cnt(fname))
+
+
+def _case_read_triggers(fname):
+    read_triggers(read_cnt(fname))
+
+
+def _case_read_info(fname):
+    read_info(read_cnt(fname))
+
+
+def _case_read_raw_ant(fname):
+    from mne.io import read_raw_ant
+
+    read_raw_ant(fname, preload=False, verbose="error")
+
+
+def _case_read_raw_ant_preload(fname):
+    from mne.io import read_raw_ant
+
+    read_raw_ant(fname, preload=True, verbose="error")
+
+
+CASES = {
+    "read_cnt": _case_read_cnt,
+    "get_samples_as_nparray": _case_get_samples_as_nparray,
+    "read_data": _case_read_data,
+    "read_triggers": _case_read_triggers,
+    "read_info": _case_read_info,
+    "read_raw_ant": _case_read_raw_ant,
+    "read_raw_ant_preload": _case_read_raw_ant_preload,
+}
+MNE_CASES = ("read_raw_ant", "read_raw_ant_preload")
+
+
+def _write_synthetic(fname: Path, source: Path, duration: int) -> None:
+    """Write the samples of source repeated to duration seconds."""
+    cnt = read_cnt(source)
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    sfreq = cnt.get_sample_frequency()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        label, unit, ref, _, _ = cnt.get_channel(k, encoding="latin-1")
+        pyeep.add_channel(channel_info, label, ref, unit)
+    handle = pyeep.write_cnt(str(fname), sfreq, channel_info, 0)
+    pyeep.close_channel_info(channel_info)
+    if handle == -1:
+        raise RuntimeError(f"Cannot write '{fname}'.")
+    # one second at a time, wrapping around at the end of the source
+    start = 0
+    for _ in range(duration):
+        stop = min(start + sfreq, n_samples)
+        pyeep.add_samples(handle, cnt.get_samples(start, stop), n_channels)
+        start = 0 if stop == n_samples else stop
+    pyeep.close(handle)
+
+
+def _time(case, fname, repeat: int) -> list[float]:
+    """Wall time of repeat runs, garbage collected in between."""
+    times = []
+    for _ in range(repeat):
+        gc.collect()
+        start = time.perf_counter()
+        case(fname)
+        times.append(time.perf_counter() - start)
+    return times
+
+
+def _peak_memory(case, fname) -> tuple[int, int, int]:
+    """Peak Python and libeep memory and RSS growth of one run, in bytes."""
+    process = psutil.Process()
+    gc.collect()
+    rss = process.memory_info().rss
+    libeep.set_memory_accounting(True)
+    tracemalloc.start()
+    try:
+        case(fname)
+        gc.collect()
+        python = tracemalloc.get_traced_memory()[1]
+    finally:
+        tracemalloc.stop()
+    native = libeep.get_memory_stats().get("total", {}).get("peak_bytes", 0)
+    libeep.set_memory_accounting(False)
+    return python, native, process.memory_info().rss - rss
+
+
+@click.command()
+@click.option(
+    "--repeat",
+    help="Number of timed runs per case and file.",
+    type=int,
+    default=5,
+    show_default=True,
+)
+@click.option(
+    "--synthetic",
+    help="Comma separated durations in seconds of the synthetic recordings.",
+    default="60,600",
+    show_default=True,
+)
+@click.option(
+    "--case",
+    "cases",
+    help="Case to run, can be repeated. Defaults to all of them.",
+    type=click.Choice(list(CASES)),
+    multiple=True,
+)
+@click.option(
+    "--output",
+    help="Write the results to this JSON file.",
+    type=click.Path(dir_okay=False, writable=True),
+)
+def run(repeat: int, synthetic: str, cases: tuple[str, ...], output: str | None):
+    """Time the antio read paths and measure their peak memory."""
+    cases = list(cases or CASES)
+    if importlib.util.find_spec("mne") is None:
+        skipped = [case for case in cases if case in MNE_CASES]
+        if skipped:
+            click.echo(f"Skipping {', '.join(skipped)}: 'mne' is not installed.")
+        cases = [case for case in cases if case not in MNE_CASES]
+    durations = [int(elt) for elt in synthetic.split(",") if elt]
+
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        fnames = sorted(DATA.glob("*/*.cnt"))
+        for duration in durations:
+            fname = Path(tmp) / f"synthetic-{duration}s.cnt"
+            _write_synthetic(fname, SOURCE, duration)
+            fnames.append(fname)
+
+        click.echo(
+            f"{'Case':<24}{'File':<40}{'Best [ms]':>11}{'Median [ms]':>13}"
+            f"{'Python [MB]':>13}{'libeep [MB]':>13}{'RSS [MB]':>10}"
+        )
+        for fname in fnames:
+            label = (
+                fname.relative_to(DATA).as_posix()
+                if DATA in fname.parents
+                else fname.name
+            )
+            cnt = read_cnt(fname)
+            size = dict(
+                n_channels=cnt.get_channel_count(),
+                n_samples=cnt.get_sample_count(),
+                bytes=fname.stat().st_size,
+            )
+            del cnt
+            for name in cases:
+                times = _time(CASES[name], fname, repeat)
+                python, native, rss = _peak_memory(CASES[name], fname)
+                results.append(
+                    dict(
+                        case=name,
+                        file=label,
+                        **size,
+                        best_s=min(times),
+                        median_s=statistics.median(times),
+                        times_s=times,
+                        peak_python_bytes=python,
+                        peak_libeep_bytes=native,
+                        rss_growth_bytes=rss,
+                    )
+                )
+                click.echo(
+                    f"{name:<24}{label[-39:]:<40}{1e3 * min(times):>11.2f}"
+                    f"{1e3 * statistics.median(times):>13.2f}"
+                    f"{python / 1e6:>13.1f}{native / 1e6:>13.1f}{rss / 1e6:>10.1f}"
+                )
+
+    if output is not None:
+        with open(output, "w") as fid:
+            json.dump(
+                dict(
+                    antio=antio.__version__,
+                    libeep=pyeep.get_version(),
+                    numpy=np.__version__,
+                    python=platform.python_version(),
+                    platform=platform.platform(),
+                    repeat=repeat,
+                    results=results,
+                ),
+                fid,
+                indent=2,
+            )
+
+
+if __name__ == "__main__":
+    run()
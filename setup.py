@@ -56,6 +56,7 @@ class build_ext(_build_ext):  # noqa: D101
                 "-B",
                 build_dir,
                 "-DCMAKE_BUILD_TYPE=Release",
+                "-DLIBEEP_BUILD_TESTS=OFF",
                 f"-DPython3_EXECUTABLE={sys.executable}",
             ]
             for key in (
@@ -1,4 +1,4 @@
 from . import io, libeep, parser, utils
 from ._version import __version__
-from .libeep import read_cnt
+from .libeep import read_cnt, write_cnt
 from .utils.config import sys_info
@@ -0,0 +1,132 @@
+from __future__ import annotations
+
+import click
+import numpy as np
+
+from ..libeep import read_cnt
+
+_METHODS = {
+    0: "copy",
+    1: "time",
+    2: "time2",
+    3: "chan",
+    5: "time-rice",
+    6: "time2-rice",
+    7: "chan-rice",
+    12: "lpc",
+}
+
+
+def _merge_widths(methods):
+    """Count the 32 bit variants of the methods under their 16 bit codes."""
+    merged = methods.copy()
+    merged[..., :4] += methods[..., 8:12]
+    merged[..., 8:12] = 0
+    return merged
+
+
+@click.command(name="compression-report")
+@click.argument("fname", type=click.Path(exists=True, dir_okay=False))
+@click.option(
+    "--top",
+    help="Number of channels and epochs to list, worst first.",
+    type=int,
+    default=10,
+    show_default=True,
+)
+@click.option(
+    "--per-epoch",
+    help="Also list the epochs with the largest compressed size.",
+    is_flag=True,
+)
+@click.option(
+    "--encoding",
+    help="Encoding used for the channel labels.",
+    default="latin-1",
+    show_default=True,
+)
+def run(fname: str, top: int, per_epoch: bool, encoding: str) -> None:
+    """Report the RAW3 compression statistics of a CNT file per channel."""
+    cnt = read_cnt(fname)
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    epoch_length = cnt.get_epoch_length()
+    n_epochs = -(-n_samples // epoch_length)
+    labels = [cnt.get_channel(k, encoding=encoding)[0] for k in range(n_channels)]
+
+    # scan epoch by epoch to keep the size of each one
+    cnt.set_compression_stats()
+    epoch_bytes = np.zeros((n_epochs, n_channels), dtype=np.int64)
+    total = dict()
+    for epoch in range(n_epochs):
+        cnt.reset_compression_stats()
+        cnt.scan_compression_stats(epoch)
+        stats = cnt.get_compression_stats()
+        epoch_bytes[epoch] = stats["bytes"]
+        # means are over the blocks which are not copies, accumulate the sums
+        coded = np.maximum(stats["blocks"] - stats["copies"], 1)
+        stats["nbits_sum"] = stats.pop("nbits_mean") * coded
+        stats.pop("nexcbits_mean")
+        for key, value in stats.items():
+            if key not in total:
+                total[key] = value
+            elif key.endswith("_max"):
+                total[key] = np.maximum(total[key], value)
+            else:
+                total[key] = total[key] + value
+    coded = np.maximum(total["blocks"] - total["copies"], 1)
+    nbits = total["nbits_sum"] / coded
+
+    samples = np.maximum(total["samples"], 1)
+    bits = 8 * total["bytes"] / samples
+    methods = total["methods"].sum(axis=0)
+    merged = _merge_widths(methods)
+    n_blocks = max(int(methods.sum()), 1)
+    click.echo(f"File: {fname}")
+    click.echo(
+        f"Channels: {n_channels}, samples: {n_samples}, "
+        f"epochs: {n_epochs} of {epoch_length} samples"
+    )
+    click.echo(
+        f"Compressed: {total['bytes'].sum()} bytes, "
+        f"{8 * total['bytes'].sum() / max(samples.sum(), 1):.2f} bits/sample"
+    )
+    shares = ", ".join(
+        f"{name} {100 * merged[code] / n_blocks:.1f}%"
+        for code, name in _METHODS.items()
+    )
+    click.echo(
+        f"Methods: {shares}, 32 bit {100 * methods[8:12].sum() / n_blocks:.1f}%"
+    )
+    click.echo(
+        "Exceptions: "
+        f"{100 * total['exceptions'].sum() / max(samples.sum(), 1):.2f}% of samples"
+    )
+
+    click.echo("")
+    click.echo(
+        f"{'Channel':<12}{'Bits/sample':>12}{'Share':>8}{'Method':>11}"
+        f"{'nbits':>7}{'nexcbits':>10}{'Exceptions':>12}{'Copies':>8}"
+        f"{'Worst epoch':>13}"
+    )
+    share = 100 * total["bytes"] / max(total["bytes"].sum(), 1)
+    for k in np.argsort(-bits, kind="stable")[:top]:
+        method = _METHODS.get(int(np.argmax(_merge_widths(total["methods"][k]))), "?")
+        click.echo(
+            f"{labels[k]:<12}{bits[k]:>12.2f}{share[k]:>7.1f}%{method:>11}"
+            f"{nbits[k]:>7.1f}{total['nexcbits_max'][k]:>10}"
+            f"{100 * total['exceptions'][k] / samples[k]:>11.2f}%"
+            f"{total['copies'][k]:>8}{int(np.argmax(epoch_bytes[:, k])):>13}"
+        )
+
+    if per_epoch:
+        click.echo("")
+        click.echo(f"{'Epoch':<8}{'Bytes':>10}{'Bits/sample':>12}  Worst channel")
+        sizes = epoch_bytes.sum(axis=1)
+        for epoch in np.argsort(-sizes, kind="stable")[:top]:
+            length = min(epoch_length, n_samples - epoch * epoch_length)
+            worst = labels[int(np.argmax(epoch_bytes[epoch]))]
+            click.echo(
+                f"{epoch:<8}{sizes[epoch]:>10}"
+                f"{8 * sizes[epoch] / (length * n_channels):>12.2f}  {worst}"
+            )
@@ -2,6 +2,8 @@ from __future__ import annotations
 
 import click
 
+from .compression_report import run as compression_report
+from .synthetic import run as synthetic
 from .sys_info import run as sys_info
 
 
@@ -10,4 +12,6 @@ def run() -> None:
     """Main package entry-point."""  # noqa: D401
 
 
+run.add_command(compression_report)
+run.add_command(synthetic)
 run.add_command(sys_info)
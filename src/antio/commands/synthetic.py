@@ -0,0 +1,91 @@
+from __future__ import annotations
+
+import click
+
+from ..libeep import write_synthetic
+
+
+@click.command(name="synthetic")
+@click.argument("fname", type=click.Path(dir_okay=False, writable=True))
+@click.option(
+    "--channels",
+    help="Number of channels.",
+    type=click.IntRange(min=1),
+    default=64,
+    show_default=True,
+)
+@click.option(
+    "--sfreq",
+    help="Sampling frequency in Hz.",
+    type=click.IntRange(min=1),
+    default=1000,
+    show_default=True,
+)
+@click.option(
+    "--duration",
+    help="Duration of the recording in seconds.",
+    type=click.FloatRange(min=0, min_open=True),
+    default=600.0,
+    show_default=True,
+)
+@click.option(
+    "--trigger-rate",
+    help="Mean number of triggers per second.",
+    type=click.FloatRange(min=0),
+    default=1.0,
+    show_default=True,
+)
+@click.option(
+    "--segments",
+    help="Number of recording segments, more than one requires --sidecars.",
+    type=click.IntRange(min=1),
+    default=1,
+    show_default=True,
+)
+@click.option("--rf64", help="Write a 64 bit RIFF file.", is_flag=True)
+@click.option(
+    "--sidecars",
+    help="Also write the .evt and .seg files next to the CNT file.",
+    is_flag=True,
+)
+@click.option(
+    "--line-freq",
+    help="Power line frequency in Hz.",
+    type=float,
+    default=50.0,
+    show_default=True,
+)
+@click.option(
+    "--seed",
+    help="Seed of the random generator.",
+    type=click.IntRange(min=0),
+    default=0,
+    show_default=True,
+)
+def run(
+    fname: str,
+    channels: int,
+    sfreq: int,
+    duration: float,
+    trigger_rate: float,
+    segments: int,
+    rf64: bool,
+    sidecars: bool,
+    line_freq: float,
+    seed: int,
+) -> None:
+    """Write a CNT file of synthetic EEG for testing at scale."""
+    if segments > 1 and not sidecars:
+        raise click.BadParameter("more than one segment requires --sidecars.")
+    write_synthetic(
+        fname,
+        channels,
+        sfreq,
+        duration,
+        trigger_rate=trigger_rate,
+        n_segments=segments,
+        rf64=rf64,
+        sidecars=sidecars,
+        line_freq=line_freq,
+        seed=seed,
+    )
@@ -1,7 +1,10 @@
 from __future__ import annotations
 
+from collections import OrderedDict
 from datetime import datetime, timezone
 from pathlib import Path
+from queue import Queue
+from threading import Lock, Thread
 from typing import TYPE_CHECKING
 
 import numpy as np
@@ -10,11 +13,11 @@ from ..utils._checks import ensure_path
 from . import pyeep
 
 if TYPE_CHECKING:
-    from collections.abc import ByteString
+    from collections.abc import Iterator
     from datetime import date
     from typing import Optional, Union
 
-    from numpy.typing import NDArray
+    from numpy.typing import ArrayLike, DTypeLike, NDArray
 
 
 class BaseCNT:
@@ -29,12 +32,40 @@ class BaseCNT:
         if self._handle != -1:
             pyeep.close(self._handle)
 
+    def get_memory_stats(self) -> dict[str, dict[str, int]]:
+        """Get the memory allocated for this file, per allocation tag.
+
+        Returns
+        -------
+        stats : dict
+            See :func:`get_memory_stats`, restricted to this file.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        return _memory_stats(self._handle)
+
 
 class InputCNT(BaseCNT):
-    """Object representing reading a CNT file."""
+    """Object representing reading a CNT file.
+
+    Notes
+    -----
+    Opening a file, reading samples and scanning compression statistics release
+    the GIL, so files read from a :class:`~concurrent.futures.ThreadPoolExecutor`
+    are decoded in parallel. Reads on different files run concurrently; reads on
+    the same file are serialized by libeep and may be issued from several threads.
+    The metadata and trigger accessors hold the GIL.
+
+    The channel and recording information is read from libeep in a single call
+    each, on first access, and kept for the lifetime of the object.
+    """
 
     def __init__(self, handle: int) -> None:
         BaseCNT.__init__(self, handle)
+        self._channels = None
+        self._recording = None
 
     def get_channel_count(self) -> int:
         """Get the total number of channels.
@@ -70,23 +101,76 @@ class InputCNT(BaseCNT):
         """
         if index < 0:
             raise RuntimeError(f"Channel index {index} cannot be negative.")
-        n_channels = self.get_channel_count()
-        if n_channels <= index:
+        channels = self._get_channels()
+        if len(channels) <= index:
             raise RuntimeError(
-                f"Channel index {index} exceeds total channel count {n_channels}."
+                f"Channel index {index} exceeds total channel count {len(channels)}."
             )
-        functions = (
-            pyeep.get_channel_label,
-            pyeep.get_channel_unit,
-            pyeep.get_channel_reference,
-            pyeep.get_channel_status,
-            pyeep.get_channel_type,
+        return tuple(
+            value.decode(encoding) if value is not None else ""
+            for value in channels[index][:5]
         )
-        channel = []
-        for func in functions:
-            value = func(self._handle, index)
-            channel.append(value.decode(encoding) if value is not None else "")
-        return tuple(channel)
+
+    def get_channels(
+        self, *, encoding: str
+    ) -> tuple[list[str], list[str], list[str], list[str], list[str]]:
+        """Get the information of all the channels.
+
+        Parameters
+        ----------
+        encoding : str
+            Encoding used for the strings.
+
+        Returns
+        -------
+        labels : list of str
+            Label of each channel.
+        units : list of str
+            Unit of each channel.
+        references : list of str
+            Reference of each channel.
+        status : list of str
+            Status of each channel.
+        types : list of str
+            Type of each channel.
+
+        Notes
+        -----
+        Equivalent to :meth:`get_channel` for every channel, in one call to libeep.
+
+        .. versionadded: 0.6.0
+        """
+        fields = ([], [], [], [], [])
+        for channel in self._get_channels():
+            # the scale, last in channel, is left out by zip
+            for field, value in zip(fields, channel):
+                field.append(value.decode(encoding) if value is not None else "")
+        return fields
+
+    def _get_channels(self) -> list[tuple]:
+        """Get the (label, unit, reference, status, type, scale) of each channel."""
+        if self._channels is None:
+            channels = pyeep.get_channels(self._handle)
+            if channels is None:
+                raise RuntimeError("Could not read the channel information.")
+            self._channels = channels
+        return self._channels
+
+    def get_channel_scales(self) -> NDArray[np.float32]:
+        """Get the factor converting the raw samples of each channel to its unit.
+
+        Returns
+        -------
+        scales : array of shape (n_channels,)
+            Scale of each channel. ``raw.astype(np.float32) * scales[:, np.newaxis]``
+            gives the same values as :meth:`get_samples_as_nparray`, ``raw`` being
+            the output of :meth:`get_raw_samples_as_nparray`.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        return np.array([elt[5] for elt in self._get_channels()], dtype=np.float32)
 
     def get_sample_frequency(self) -> int:
         """Get the sampling frequency of the recording in Hz.
@@ -108,6 +192,207 @@ class InputCNT(BaseCNT):
         """
         return pyeep.get_sample_count(self._handle)
 
+    def get_epoch_length(self) -> int:
+        """Get the number of samples per compressed epoch.
+
+        Returns
+        -------
+        epoch_length : int
+            Number of samples stored in each compressed block of the file.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        return pyeep.get_epoch_length(self._handle)
+
+    def set_compression_stats(self, enable: bool = True) -> None:
+        """Collect compression statistics for the EEG epochs decoded from now on.
+
+        Parameters
+        ----------
+        enable : bool
+            If True, collect statistics (enabling again resets them). If False, stop
+            collecting and discard them.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        if pyeep.set_compression_stats(self._handle, int(enable)) != 0:
+            raise RuntimeError("Could not enable the compression statistics.")
+
+    def reset_compression_stats(self) -> None:
+        """Reset the collected compression statistics, e.g. between epochs.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        if pyeep.reset_compression_stats(self._handle) != 0:
+            raise RuntimeError("Compression statistics are not collected.")
+
+    def scan_compression_stats(self, epoch: int) -> None:
+        """Add a compressed epoch to the statistics without reading its samples.
+
+        Parameters
+        ----------
+        epoch : int
+            Index of the epoch, see :meth:`get_epoch_length`.
+
+        Notes
+        -----
+        Unlike reading samples, which may decode the epochs around the requested
+        range, this accounts exactly one epoch. Use :meth:`reset_compression_stats`
+        in between to get per-epoch statistics.
+
+        .. versionadded: 0.6.0
+        """
+        n_epochs = -(-self.get_sample_count() // self.get_epoch_length())
+        if epoch < 0 or n_epochs <= epoch:
+            raise RuntimeError(f"Epoch index {epoch} out of range [0, {n_epochs}).")
+        if pyeep.scan_compression_stats(self._handle, epoch) != 0:
+            raise RuntimeError(f"Could not scan the compression of epoch {epoch}.")
+
+    def get_compression_stats(self) -> dict[str, NDArray]:
+        """Get the compression statistics collected per channel.
+
+        Returns
+        -------
+        stats : dict
+            Arrays of shape (n_channels,) unless specified otherwise:
+            - ``blocks``: number of compressed blocks, one per channel and epoch.
+            - ``samples``: number of samples in these blocks.
+            - ``bytes``: compressed size of these blocks.
+            - ``methods``: array of shape (n_channels, 16), number of blocks per
+              compression method code: 0 copy, 1 time, 2 time2, 3 chan, +4 for
+              the adaptive Rice coded variants, +8 for the 32 bit variants, 12
+              linear prediction.
+            - ``copies``: number of blocks stored uncompressed (methods 0 and 8).
+            - ``nbits_mean``, ``nexcbits_mean``: mean residual and exception bit
+              widths over the blocks which are not copies.
+            - ``nbits_max``, ``nexcbits_max``: largest residual and exception bit
+              widths.
+            - ``exceptions``: number of residuals stored with the exception width.
+
+        Notes
+        -----
+        Statistics count every epoch decoded, an epoch read twice is counted twice.
+        See :meth:`scan_compression_stats` for exact per-epoch statistics.
+
+        .. versionadded: 0.6.0
+        """
+        n_channels = self.get_channel_count()
+        values = [
+            pyeep.get_compression_stats(self._handle, k) for k in range(n_channels)
+        ]
+        if any(value is None for value in values):
+            raise RuntimeError("Compression statistics are not collected.")
+        keys = (
+            "blocks",
+            "samples",
+            "bytes",
+            "methods",
+            "nbits",
+            "nexcbits",
+            "nbits_max",
+            "nexcbits_max",
+            "exceptions",
+        )
+        stats = {
+            key: np.array(elt, dtype=np.int64) for key, elt in zip(keys, zip(*values))
+        }
+        stats["copies"] = stats["methods"][:, 0] + stats["methods"][:, 8]
+        coded = np.maximum(stats["blocks"] - stats["copies"], 1)
+        stats["nbits_mean"] = stats.pop("nbits") / coded
+        stats["nexcbits_mean"] = stats.pop("nexcbits") / coded
+        return stats
+
+    def get_stats(self) -> dict[str, int | NDArray]:
+        """Get the read performance counters of this file.
+
+        Returns
+        -------
+        stats : dict
+            Counters since the file was opened or :meth:`reset_stats`, times in
+            nanoseconds:
+            - ``bytes_read``: stored epoch bytes read from the file.
+            - ``epochs_decoded``: number of epochs decompressed.
+            - ``seeks``: number of repositionings, one per read of samples.
+            - ``cache_hits``: seeks within the epoch decoded last, which need no
+              read nor decode.
+            - ``read_ns``, ``decode_ns``, ``scale_ns``: time spent reading epochs
+              from the file, decompressing them and scaling the samples.
+            - ``read_hist``, ``decode_hist``: arrays of shape (32,), number of
+              epochs whose read or decode took between ``2**k`` and
+              ``2**(k + 1)`` nanoseconds.
+
+        Notes
+        -----
+        The counters are always collected, a split of the time into ``read_ns``
+        and ``decode_ns`` tells I/O from CPU bound reads.
+
+        .. versionadded: 0.6.0
+        """
+        values = pyeep.get_stats(self._handle)
+        if values is None:
+            raise RuntimeError("Could not get the read statistics.")
+        keys = (
+            "bytes_read",
+            "epochs_decoded",
+            "seeks",
+            "cache_hits",
+            "read_ns",
+            "decode_ns",
+            "scale_ns",
+        )
+        stats = dict(zip(keys, values))
+        stats["read_hist"] = np.array(values[-2], dtype=np.int64)
+        stats["decode_hist"] = np.array(values[-1], dtype=np.int64)
+        return stats
+
+    def reset_stats(self) -> None:
+        """Zero the read performance counters and drop the recorded trace.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        if pyeep.reset_stats(self._handle) != 0:
+            raise RuntimeError("Could not reset the read statistics.")
+
+    def set_trace(self, max_events: int = 100_000) -> None:
+        """Record the read and decode spans of the epochs from now on.
+
+        Parameters
+        ----------
+        max_events : int
+            Number of spans to keep, later ones are not recorded. 0 stops
+            recording and drops the trace.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        if max_events < 0 or pyeep.set_trace(self._handle, max_events) != 0:
+            raise RuntimeError(f"Could not record {max_events} trace events.")
+
+    def write_trace(self, fname: str | Path) -> None:
+        """Write the recorded spans as a Chrome trace event file.
+
+        Parameters
+        ----------
+        fname : str | Path
+            Path to the ``.json`` file to write, which can be opened in
+            ``chrome://tracing`` or https://ui.perfetto.dev.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        if pyeep.write_trace(self._handle, str(fname)) != 0:
+            raise RuntimeError(f"Could not write the trace to '{fname}'.")
+
     def get_samples(self, fro: int, to: int) -> list[float]:
         """Get samples between 2 index.
 
@@ -129,7 +414,9 @@ class InputCNT(BaseCNT):
             raise RuntimeError(f"End index {to} exceeds total sample count.")
         return pyeep.get_samples(self._handle, fro, to)
 
-    def get_samples_as_nparray(self, fro: int, to: int) -> NDArray[np.float32]:
+    def get_samples_as_nparray(
+        self, fro: int, to: int, *, out: Optional[NDArray[np.float32]] = None
+    ) -> NDArray[np.float32]:
         """Get samples between 2 index as numpy array.
 
         Parameters
@@ -138,25 +425,35 @@ class InputCNT(BaseCNT):
             Start index.
         to : int
             End index.
+        out : array of shape (n_channels, n_samples) | None
+            If provided, the samples are decoded into this writable float32 array
+            instead of a new one. Its transpose must be C-contiguous, as for the
+            arrays returned by this method or created with ``order="F"``.
+
+            .. versionadded: 0.6.0
 
         Returns
         -------
         samples : array of shape (n_channels, n_samples)
-            List of retrieved samples as 2-dimensional numpy array.
+            List of retrieved samples as 2-dimensional numpy array, ``out`` if
+            provided.
 
         Notes
         -----
-        This array is read-only.
+        Without ``out``, this array is read-only.
         """
         if fro < 0 or to < 0:
             raise RuntimeError(f"Start/Stop index {fro}/{to} cannot be negative.")
         if self.get_sample_count() < to:
             raise RuntimeError(f"End index {to} exceeds total sample count.")
+        if out is not None:
+            self._get_samples_into(fro, to, out)
+            return out
         buffer = self._get_samples_as_buffer(fro, to)
         return np.frombuffer(buffer, dtype=np.float32).reshape((to - fro, -1)).T
 
-    def _get_samples_as_buffer(self, fro: int, to: int) -> ByteString:
-        """Get samples between 2 index as memoryview.
+    def _get_samples_as_buffer(self, fro: int, to: int) -> bytes:
+        """Get samples between 2 index as bytes.
 
         Parameters
         ----------
@@ -167,14 +464,279 @@ class InputCNT(BaseCNT):
 
         Returns
         -------
-        samples : buffer of shape (n_channels * n_samples)
-            List of retrieved samples, ordered by (n_channels,) samples.
+        samples : bytes of shape (n_channels * n_samples)
+            Retrieved float32 samples, ordered by (n_channels,) samples.
+
+        Notes
+        -----
+        The samples are decoded into the returned object, which owns its memory.
+        """
+        buffer = pyeep.get_samples_as_buffer(self._handle, fro, to)
+        if buffer is None:
+            raise RuntimeError(f"Could not read the samples {fro} to {to}.")
+        return buffer
+
+    def _get_samples_into(self, fro: int, to: int, out: NDArray[np.float32]) -> None:
+        """Decode samples between 2 index into a float32 array.
+
+        Parameters
+        ----------
+        fro : int
+            Start index.
+        to : int
+            End index.
+        out : array of shape (n_channels, n_samples)
+            Writable float32 array whose transpose is C-contiguous.
+        """
+        shape = (self.get_channel_count(), to - fro)
+        if not isinstance(out, np.ndarray) or out.dtype != np.float32:
+            raise TypeError("The output must be a float32 numpy array.")
+        if out.shape != shape:
+            raise ValueError(f"The output shape {out.shape} should be {shape}.")
+        if not out.T.flags.c_contiguous or not out.flags.writeable:
+            raise ValueError("The output must be writable, its transpose C-contiguous.")
+        status = pyeep.get_samples_into(
+            self._handle, fro, to, out.ctypes.data, out.nbytes
+        )
+        if status != 0:
+            raise RuntimeError(f"Could not read the samples {fro} to {to}.")
+
+    def _get_samples_picked_into(
+        self,
+        fro: int,
+        to: int,
+        picks: NDArray[np.intc],
+        scales: NDArray[np.float64],
+        out: NDArray[np.float64],
+    ) -> None:
+        """Decode the samples of some channels between 2 index into a float64 array.
+
+        Parameters
+        ----------
+        fro : int
+            Start index.
+        to : int
+            End index.
+        picks : array of shape (n_picks,)
+            C-contiguous int array of channel indices.
+        scales : array of shape (n_picks,)
+            C-contiguous float64 array of factors applied on top of the channel
+            scales.
+        out : array of shape (n_picks, n_samples)
+            Writable float64 array whose rows are C-contiguous.
+        """
+        n_picks, n_samples = out.shape
+        stride = out.strides[0] // out.itemsize if 1 < n_picks else n_samples
+        size = (max(n_picks - 1, 0) * stride + n_samples) * out.itemsize
+        status = pyeep.get_samples_picked(
+            self._handle,
+            fro,
+            to,
+            picks.ctypes.data,
+            n_picks,
+            scales.ctypes.data,
+            out.ctypes.data,
+            size,
+            stride,
+        )
+        if status != 0:
+            raise RuntimeError(f"Could not read the samples {fro} to {to}.")
+
+    def get_raw_samples_as_nparray(
+        self, fro: int, to: int, *, out: Optional[NDArray[np.int32]] = None
+    ) -> NDArray[np.int32]:
+        """Get the unscaled samples between 2 index as numpy array.
+
+        Parameters
+        ----------
+        fro : int
+            Start index.
+        to : int
+            End index.
+        out : array of shape (n_channels, n_samples) | None
+            If provided, the samples are decoded into this writable int32 array
+            instead of a new one. Its transpose must be C-contiguous.
+
+        Returns
+        -------
+        samples : array of shape (n_channels, n_samples)
+            Raw int32 samples, half the size of the float64 data. Use
+            :meth:`get_channel_scales` to convert them.
+
+        Notes
+        -----
+        Only continuous recordings store raw samples, a RuntimeError is raised for
+        averaged data.
+
+        .. versionadded: 0.6.0
+        """
+        if fro < 0 or to < 0:
+            raise RuntimeError(f"Start/Stop index {fro}/{to} cannot be negative.")
+        if self.get_sample_count() < to:
+            raise RuntimeError(f"End index {to} exceeds total sample count.")
+        shape = (self.get_channel_count(), to - fro)
+        if out is None:
+            out = np.empty(shape[::-1], dtype=np.int32).T
+        if not isinstance(out, np.ndarray) or out.dtype != np.int32:
+            raise TypeError("The output must be an int32 numpy array.")
+        if out.shape != shape:
+            raise ValueError(f"The output shape {out.shape} should be {shape}.")
+        if not out.T.flags.c_contiguous or not out.flags.writeable:
+            raise ValueError("The output must be writable, its transpose C-contiguous.")
+        status = pyeep.get_raw_samples_into(
+            self._handle, fro, to, out.ctypes.data, out.nbytes
+        )
+        if status != 0:
+            raise RuntimeError(f"Could not read the raw samples {fro} to {to}.")
+        return out
+
+    def iter_chunks(
+        self,
+        chunk_samples: Optional[int] = None,
+        overlap: int = 0,
+        *,
+        channels: Optional[ArrayLike] = None,
+        dtype: DTypeLike = np.float32,
+        reuse_buffer: bool = False,
+    ) -> Iterator[tuple[int, NDArray]]:
+        """Iterate over the samples in blocks of bounded size.
+
+        Parameters
+        ----------
+        chunk_samples : int | None
+            Number of samples per block. If None, the compression epoch length is
+            used. With a multiple of the epoch length and no overlap, every block
+            starts on an epoch boundary and each epoch is decoded exactly once.
+        overlap : int
+            Number of samples shared by consecutive blocks. They are copied from
+            the previous block instead of being decoded again.
+        channels : array-like of int | None
+            Indices of the channels to return, all of them if None.
+        dtype : data-type
+            Data type of the returned blocks.
+        reuse_buffer : bool
+            If True, every block is a view of the same array, overwritten by the
+            next iteration. Copy a block to keep it.
+
+        Yields
+        ------
+        start : int
+            Index of the first sample of the block.
+        samples : array of shape (n_channels, n_samples)
+            Samples of the block. The last block, which ends with the recording,
+            may be shorter.
+
+        Notes
+        -----
+        The memory used does not depend on the length of the recording.
+
+        .. versionadded: 0.6.0
+        """
+        epoch_length = self.get_epoch_length()
+        if chunk_samples is None:
+            chunk_samples = epoch_length if 0 < epoch_length else 1000
+        if chunk_samples < 1:
+            raise ValueError(f"The chunk size should be positive, got {chunk_samples}.")
+        if not 0 <= overlap < chunk_samples:
+            raise ValueError(
+                f"The overlap should be in [0, {chunk_samples}), got {overlap}."
+            )
+        picks = self._pick_channels(channels)
+        n_samples = self.get_sample_count()
+        step = chunk_samples - overlap
+        # decoded samples, the overlap is moved to the front of the next block
+        scratch = np.empty(
+            (self.get_channel_count(), chunk_samples), dtype=np.float32, order="F"
+        )
+        buffer = None
+        if reuse_buffer:
+            buffer = np.empty((picks.size, chunk_samples), dtype=dtype)
+        start, decoded = 0, 0
+        while decoded < n_samples:
+            stop = min(start + chunk_samples, n_samples)
+            n_kept = max(decoded - start, 0)
+            if n_kept:
+                scratch[:, :n_kept] = scratch[:, step : step + n_kept]
+            self._get_samples_into(
+                start + n_kept, stop, scratch[:, n_kept : stop - start]
+            )
+            block = scratch[:, : stop - start]
+            if buffer is None:
+                samples = block[picks].astype(dtype, copy=False)
+            else:
+                samples = buffer[:, : stop - start]
+                np.copyto(samples, block if channels is None else block[picks])
+            yield start, samples
+            decoded = stop
+            start += step
+
+    def as_array(self, cache_epochs: int = 8) -> CNTArray:
+        """Get a lazy array view of the samples.
+
+        Parameters
+        ----------
+        cache_epochs : int
+            Number of decoded compression epochs kept in memory.
+
+        Returns
+        -------
+        array : CNTArray
+            Read-only array of shape (n_channels, n_samples) decoding the samples
+            on access.
+
+        Notes
+        -----
+        .. versionadded: 0.6.0
+        """
+        return CNTArray(self, cache_epochs)
+
+    def load_raw_array(self, fro: int = 0, to: Optional[int] = None) -> RawArray:
+        """Load the unscaled samples in memory as a compact array.
+
+        Parameters
+        ----------
+        fro : int
+            Start index.
+        to : int | None
+            End index. If None, the last sample.
+
+        Returns
+        -------
+        array : RawArray
+            Array of shape (n_channels, n_samples) backed by the int32 samples and
+            the channel scales, scaled on access.
 
         Notes
         -----
-        This buffer is read-only.
+        .. versionadded: 0.6.0
         """
-        return pyeep.get_samples_as_buffer(self._handle, fro, to)
+        to = self.get_sample_count() if to is None else to
+        return RawArray(
+            self.get_raw_samples_as_nparray(fro, to), self.get_channel_scales()
+        )
+
+    def _pick_channels(self, channels: Optional[ArrayLike]) -> NDArray[np.intp]:
+        """Validate channel indices.
+
+        Parameters
+        ----------
+        channels : array-like of int | None
+            Indices of the channels, all of them if None.
+
+        Returns
+        -------
+        picks : array of shape (n_picks,)
+            Indices of the channels.
+        """
+        n_channels = self.get_channel_count()
+        if channels is None:
+            return np.arange(n_channels)
+        picks = np.asarray(channels)
+        if picks.ndim != 1 or not np.issubdtype(picks.dtype, np.integer):
+            raise TypeError("The channels should be a 1D array-like of indices.")
+        if picks.size and (picks.min() < -n_channels or n_channels <= picks.max()):
+            raise ValueError(f"Channel index out of range for {n_channels} channels.")
+        return picks % n_channels if picks.size else picks.astype(np.intp)
 
     def get_start_time(self) -> datetime:
         """Get start time.
@@ -184,7 +746,7 @@ class InputCNT(BaseCNT):
         start_time : datetime
             Acquisition start time.
         """
-        start_time = pyeep.get_start_time(self._handle)
+        start_time = self._get_recording()[0]
         return datetime.fromtimestamp(start_time, timezone.utc)
 
     def get_start_time_and_fraction(self) -> Optional[datetime]:
@@ -196,7 +758,7 @@ class InputCNT(BaseCNT):
             The measurement time of the recording (in the UTC timezone). None if the
             start date parsed was not a valid EXCEL format start date.
         """
-        start_date, start_fraction = pyeep.get_start_date_and_fraction(self._handle)
+        start_date, start_fraction = self._get_recording()[1:3]
         # start date is in EXCEL format
         if start_date >= 27538 and start_date <= 2958464:
             start_date = np.round(start_date * 3600.0 * 24.0) - 2209161600
@@ -212,8 +774,7 @@ class InputCNT(BaseCNT):
         encoding : str
             Encoding used for the string.
         """
-        hospital = pyeep.get_hospital(self._handle)
-        return hospital.decode(encoding) if hospital is not None else ""
+        return self.get_recording_info(encoding=encoding)["hospital"]
 
     def get_machine_info(self, *, encoding: str) -> tuple[str, str, str]:
         """Get machine information.
@@ -228,16 +789,12 @@ class InputCNT(BaseCNT):
         encoding : str
             Encoding used for the strings.
         """
-        functions = (
-            pyeep.get_machine_make,
-            pyeep.get_machine_model,
-            pyeep.get_machine_serial_number,
+        info = self.get_recording_info(encoding=encoding)
+        return (
+            info["machine_make"],
+            info["machine_model"],
+            info["machine_serial_number"],
         )
-        info = []
-        for func in functions:
-            value = func(self._handle)
-            info.append(value.decode(encoding) if value is not None else "")
-        return tuple(info)
 
     def get_patient_info(self, *, encoding: str) -> tuple[str, str, str, date | None]:
         """Get patient info.
@@ -253,15 +810,13 @@ class InputCNT(BaseCNT):
         encoding : str
             Encoding used for the strings.
         """
-        functions = (pyeep.get_patient_name, pyeep.get_patient_id)
-        info = []
-        for func in functions:
-            value = func(self._handle)
-            info.append(value.decode(encoding) if value is not None else "")
-        sex = pyeep.get_patient_sex(self._handle)
-        info.append("" if sex == "\x00" else sex)
-        info.append(self._get_date_of_birth())
-        return tuple(info)
+        info = self.get_recording_info(encoding=encoding)
+        return (
+            info["patient_name"],
+            info["patient_id"],
+            info["patient_sex"],
+            info["date_of_birth"],
+        )
 
     def _get_date_of_birth(self) -> date:
         """Get date of birth of the patient.
@@ -271,7 +826,7 @@ class InputCNT(BaseCNT):
         date : datetime.date
             Date of birth.
         """
-        year, month, day = pyeep.get_date_of_birth(self._handle)
+        year, month, day = self._get_recording()[-3:]
         try:
             # one of the value year, month, day could bet set to 0 as this is the
             # initial value, which is invalid for a datetime object.
@@ -279,6 +834,49 @@ class InputCNT(BaseCNT):
         except Exception:
             return None
 
+    def get_recording_info(self, *, encoding: str) -> dict[str, Union[str, date]]:
+        """Get all the recording information.
+
+        Parameters
+        ----------
+        encoding : str
+            Encoding used for the strings.
+
+        Returns
+        -------
+        info : dict
+            The strings ``hospital``, ``test_name``, ``test_serial``, ``physician``,
+            ``technician``, ``machine_make``, ``machine_model``,
+            ``machine_serial_number``, ``patient_name``, ``patient_id``,
+            ``patient_address``, ``patient_phone``, ``comment``, ``patient_sex`` and
+            ``patient_handedness``, empty if not set, and ``date_of_birth``, a
+            :class:`datetime.date` or None if it could not be parsed.
+
+        Notes
+        -----
+        The start time is available from :meth:`get_start_time_and_fraction`.
+
+        .. versionadded: 0.6.0
+        """
+        recording = self._get_recording()
+        info = {
+            key: value.decode(encoding) if value is not None else ""
+            for key, value in zip(_RECORDING_STRINGS, recording[3:16])
+        }
+        for key, value in zip(("patient_sex", "patient_handedness"), recording[16:18]):
+            info[key] = "" if value == "\x00" else value
+        info["date_of_birth"] = self._get_date_of_birth()
+        return info
+
+    def _get_recording(self) -> tuple:
+        """Get the recording information as returned by pyeep."""
+        if self._recording is None:
+            recording = pyeep.get_recording(self._handle)
+            if recording is None:
+                raise RuntimeError("Could not read the recording information.")
+            self._recording = recording
+        return self._recording
+
     def get_trigger_count(self) -> int:
         """Get the total number of triggers (annotations).
 
@@ -319,6 +917,512 @@ class InputCNT(BaseCNT):
             )
         return pyeep.get_trigger(self._handle, index)
 
+    def get_triggers(self) -> dict[str, Union[NDArray, list[Optional[str]]]]:
+        """Get all the triggers (annotations) as columns.
+
+        Returns
+        -------
+        triggers : dict
+            The dictionary contains the following columns, one entry per trigger
+            unless stated otherwise:
+            - ``sample``: array of int64, sample index.
+            - ``duration``: array of int64, duration in samples.
+            - ``type``: array of int32, event type.
+            - ``code``: array of int32, event code.
+            - ``label``: list of str, the code returned by :meth:`get_trigger`.
+            - ``condition``: list of str | None.
+            - ``description``: list of str | None.
+            - ``impedance_index``: array of int32, index of the triggers with an
+              impedance string.
+            - ``impedance_size``: array of int32, number of values in each of these
+              strings, -1 for the strings which do not parse.
+            - ``impedances``: array of float64 of shape (n_impedance_index, n_values)
+              holding the values parsed from these strings. Rows shorter than the
+              longest one and rows which do not parse are padded with NaN.
+
+            The strings are numbers separated by single spaces with a ``.`` decimal
+            point, whatever the locale.
+
+        Notes
+        -----
+        Equal strings are returned as the same object. The numeric columns, except
+        ``sample`` and ``duration``, are read-only.
+
+        .. versionadded: 0.6.0
+        """
+        columns = pyeep.get_triggers(self._handle)
+        if columns is None:
+            raise RuntimeError("Could not read the triggers.")
+        (
+            samples,
+            durations,
+            types,
+            codes,
+            labels,
+            conditions,
+            descriptions,
+            index,
+            sizes,
+            impedances,
+            n_values,
+        ) = columns
+        index = np.frombuffer(index, dtype=np.int32)
+        return dict(
+            sample=np.frombuffer(samples, dtype=np.uint64).astype(np.int64),
+            duration=np.frombuffer(durations, dtype=np.uint64).astype(np.int64),
+            type=np.frombuffer(types, dtype=np.int32),
+            code=np.frombuffer(codes, dtype=np.int32),
+            label=labels,
+            condition=conditions,
+            description=descriptions,
+            impedance_index=index,
+            impedance_size=np.frombuffer(sizes, dtype=np.int32),
+            impedances=np.frombuffer(impedances, dtype=np.float64).reshape(
+                (index.size, n_values)
+            ),
+        )
+
+
+_RECORDING_STRINGS = (
+    "hospital",
+    "test_name",
+    "test_serial",
+    "physician",
+    "technician",
+    "machine_make",
+    "machine_model",
+    "machine_serial_number",
+    "patient_name",
+    "patient_id",
+    "patient_address",
+    "patient_phone",
+    "comment",
+)
+
+
+class CNTArray:
+    """Lazy read-only array of shape (n_channels, n_samples) over a CNT file.
+
+    Indexing with ``[channels, samples]``, where both are an integer, a slice or
+    a list of integers, decodes only the compression epochs covering the
+    selected samples. The last decoded epochs are cached. ``np.asarray`` loads
+    all the samples into a new array, hence it raises with ``copy=False``.
+
+    Use :meth:`InputCNT.as_array` to create one.
+
+    Parameters
+    ----------
+    cnt : InputCNT
+        The file to read.
+    cache_epochs : int
+        Number of decoded compression epochs kept in memory.
+
+    Notes
+    -----
+    .. versionadded: 0.6.0
+    """
+
+    def __init__(self, cnt: InputCNT, cache_epochs: int = 8) -> None:
+        if cache_epochs < 1:
+            raise ValueError(f"At least one epoch must be cached, got {cache_epochs}.")
+        self._cnt = cnt
+        self._n_samples = cnt.get_sample_count()
+        self._epoch_length = max(cnt.get_epoch_length(), 1)
+        self._cache = OrderedDict()
+        self._cache_epochs = cache_epochs
+        self._lock = Lock()
+
+    @property
+    def shape(self) -> tuple[int, int]:
+        """Number of channels and samples."""
+        return (self._cnt.get_channel_count(), self._n_samples)
+
+    @property
+    def dtype(self) -> np.dtype:
+        """Data type of the samples."""
+        return np.dtype(np.float32)
+
+    @property
+    def ndim(self) -> int:
+        """Number of dimensions."""
+        return 2
+
+    @property
+    def size(self) -> int:
+        """Number of elements."""
+        return self.shape[0] * self.shape[1]
+
+    def __len__(self) -> int:  # noqa: D105
+        return self.shape[0]
+
+    def __repr__(self) -> str:  # noqa: D105
+        return f"<CNTArray | {self.shape[0]} channels x {self.shape[1]} samples>"
+
+    def __array__(self, dtype=None, copy=None) -> NDArray:  # noqa: D105
+        # the samples are decoded into a new array, copy=True and None hold
+        if copy is False:
+            raise ValueError(
+                "A CNTArray is decoded on access, it cannot be converted without copy."
+            )
+        data = self[:, :]
+        return data if dtype is None else data.astype(dtype, copy=False)
+
+    def __getitem__(self, key) -> NDArray[np.float32]:  # noqa: D105
+        if not isinstance(key, tuple):
+            key = (key,)
+        if any(elt is Ellipsis for elt in key):
+            if 1 < sum(elt is Ellipsis for elt in key):
+                raise IndexError("An index can only have a single ellipsis.")
+            idx = next(k for k, elt in enumerate(key) if elt is Ellipsis)
+            key = key[:idx] + (slice(None),) * (3 - len(key)) + key[idx + 1 :]
+        if 2 < len(key):
+            raise IndexError(f"Too many indices for a 2D array, got {len(key)}.")
+        ch_key, sample_key = key + (slice(None),) * (2 - len(key))
+        picks = np.arange(self.shape[0])[ch_key]
+        samples = self._sample_indices(sample_key)
+        data = np.empty((np.size(picks), samples.size), dtype=np.float32)
+        # runs of consecutive samples in the same epoch, one per epoch for slices
+        epochs = samples // self._epoch_length
+        bounds = np.flatnonzero(np.diff(epochs)) + 1
+        runs = zip([0, *bounds], [*bounds, samples.size]) if samples.size else ()
+        for start, stop in runs:
+            epoch = int(epochs[start])
+            block = self._get_epoch(epoch)
+            offsets = samples[start:stop] - epoch * self._epoch_length
+            data[:, start:stop] = block[offsets][:, np.atleast_1d(picks)].T
+        if np.ndim(sample_key) == 0 and not isinstance(sample_key, slice):
+            data = data[:, 0]
+        if np.ndim(picks) == 0:
+            data = data[0]
+        return data
+
+    def _sample_indices(self, key) -> NDArray[np.intp]:
+        """Sample indices selected by an integer, a slice or a list."""
+        if isinstance(key, slice):
+            return np.arange(*key.indices(self._n_samples))
+        samples = np.atleast_1d(np.asarray(key))
+        if samples.ndim == 1 and samples.size == 0:
+            return samples.astype(np.intp)  # an empty list is float64
+        if samples.ndim != 1 or not np.issubdtype(samples.dtype, np.integer):
+            raise IndexError("Samples can only be indexed by integers or a slice.")
+        if samples.size and (
+            samples.min() < -self._n_samples or self._n_samples <= samples.max()
+        ):
+            raise IndexError(f"Sample index out of range for {self._n_samples}.")
+        return samples % self._n_samples
+
+    def _get_epoch(self, epoch: int) -> NDArray[np.float32]:
+        """Samples of a compression epoch, of shape (n_samples, n_channels)."""
+        with self._lock:
+            if epoch in self._cache:
+                self._cache.move_to_end(epoch)
+                return self._cache[epoch]
+        start = epoch * self._epoch_length
+        stop = min(start + self._epoch_length, self._n_samples)
+        buffer = self._cnt._get_samples_as_buffer(start, stop)
+        block = np.frombuffer(buffer, dtype=np.float32).reshape((stop - start, -1))
+        with self._lock:
+            self._cache[epoch] = block
+            while self._cache_epochs < len(self._cache):
+                self._cache.popitem(last=False)
+        return block
+
+
+class RawArray:
+    """In-memory array of shape (n_channels, n_samples) storing int32 samples.
+
+    The samples are kept unscaled, half the memory of float64 data, and the scale
+    of each channel is applied on indexing. ``array[key]`` gives the same float32
+    values as ``cnt.get_samples_as_nparray(fro, to)[key]``. ``np.asarray``
+    scales all the samples into a new array, hence it raises with ``copy=False``.
+
+    Use :meth:`InputCNT.load_raw_array` to create one.
+
+    Parameters
+    ----------
+    raw : array of shape (n_channels, n_samples)
+        The unscaled int32 samples.
+    scales : array of shape (n_channels,)
+        The scale of each channel.
+
+    Notes
+    -----
+    .. versionadded: 0.6.0
+    """
+
+    def __init__(self, raw: NDArray[np.int32], scales: NDArray[np.float32]) -> None:
+        raw = np.asarray(raw)
+        scales = np.asarray(scales, dtype=np.float32)
+        if raw.dtype != np.int32 or raw.ndim != 2:
+            raise TypeError("The raw samples must be a 2D int32 array.")
+        if scales.shape != raw.shape[:1]:
+            raise ValueError(
+                f"The scales shape {scales.shape} should be {raw.shape[:1]}."
+            )
+        self._raw = raw
+        self._scales = scales
+
+    @property
+    def raw(self) -> NDArray[np.int32]:
+        """Unscaled samples."""
+        return self._raw
+
+    @property
+    def scales(self) -> NDArray[np.float32]:
+        """Scale of each channel."""
+        return self._scales
+
+    @property
+    def shape(self) -> tuple[int, int]:
+        """Number of channels and samples."""
+        return self._raw.shape
+
+    @property
+    def dtype(self) -> np.dtype:
+        """Data type of the scaled samples."""
+        return np.dtype(np.float32)
+
+    @property
+    def ndim(self) -> int:
+        """Number of dimensions."""
+        return 2
+
+    @property
+    def size(self) -> int:
+        """Number of elements."""
+        return self._raw.size
+
+    @property
+    def nbytes(self) -> int:
+        """Number of bytes held by the samples and the scales."""
+        return self._raw.nbytes + self._scales.nbytes
+
+    def __len__(self) -> int:  # noqa: D105
+        return self.shape[0]
+
+    def __repr__(self) -> str:  # noqa: D105
+        return f"<RawArray | {self.shape[0]} channels x {self.shape[1]} samples>"
+
+    def __array__(self, dtype=None, copy=None) -> NDArray:  # noqa: D105
+        # the samples are scaled into a new array, copy=True and None hold
+        if copy is False:
+            raise ValueError(
+                "A RawArray is scaled on access, it cannot be converted without copy."
+            )
+        data = self[:, :]
+        return data if dtype is None else data.astype(dtype, copy=False)
+
+    def __getitem__(self, key) -> NDArray[np.float32]:  # noqa: D105
+        # index the scales broadcast to the samples with the same key
+        scales = np.broadcast_to(self._scales[:, np.newaxis], self.shape)
+        return self._raw[key].astype(np.float32) * scales[key]
+
+
+class OutputCNT(BaseCNT):
+    """Object representing writing a CNT file.
+
+    Use :func:`write_cnt` to create one.
+
+    Parameters
+    ----------
+    handle : int
+        libeep handle of the file open for writing.
+    n_channels : int
+        Number of channels of the file.
+    background : bool
+        If True, the samples are compressed and written by a background thread
+        while the caller prepares the next block. The GIL is released during
+        compression, so the two run in parallel.
+    max_pending : int
+        Number of blocks queued for the background thread before
+        :meth:`add_samples` blocks.
+
+    Notes
+    -----
+    .. versionadded: 0.6.0
+    """
+
+    def __init__(
+        self,
+        handle: int,
+        n_channels: int,
+        *,
+        background: bool = False,
+        max_pending: int = 8,
+    ) -> None:
+        BaseCNT.__init__(self, handle)
+        self._n_channels = n_channels
+        self._queue = None
+        self._worker = None
+        self._errors = []
+        if background:
+            self._queue = Queue(maxsize=max_pending)
+            # the worker must not reference self, else the file is never closed
+            self._worker = Thread(
+                target=_write_worker,
+                args=(handle, self._queue, self._errors),
+                daemon=True,
+            )
+            self._worker.start()
+
+    def __del__(self) -> None:  # noqa: D105
+        self.close()
+
+    def __enter__(self) -> OutputCNT:  # noqa: D105
+        return self
+
+    def __exit__(self, *args) -> None:  # noqa: D105
+        self.close()
+
+    def get_channel_count(self) -> int:
+        """Get the total number of channels.
+
+        Returns
+        -------
+        n_channels : int
+            Number of channels.
+        """
+        return self._n_channels
+
+    def add_samples(self, data: NDArray) -> None:
+        """Append samples to the file.
+
+        Parameters
+        ----------
+        data : array of shape (n_channels, n_samples)
+            Samples to write. float32 and float64 arrays are in the unit of the
+            channels, µV by default. int32 arrays are the raw values stored in
+            the file, which are multiplied by the channel scale of 1/128 on read.
+            Other dtypes are rejected. The array is passed to libeep with its
+            strides and interleaved while it is converted, without copy.
+
+        Notes
+        -----
+        With background compression, the array is written later: it must not be
+        modified before :meth:`flush` or :meth:`close` returns.
+        """
+        self._check_open()
+        data = np.asarray(data)
+        if data.ndim != 2 or data.shape[0] != self._n_channels:
+            raise ValueError(
+                f"The samples should be of shape ({self._n_channels}, n_samples), "
+                f"got {data.shape}."
+            )
+        if data.dtype.newbyteorder("=") not in _SAMPLE_KINDS:
+            raise TypeError(
+                "The samples should be float32, float64 or int32, got "
+                f"{data.dtype}."
+            )
+        if not data.dtype.isnative or any(
+            stride % data.itemsize for stride in data.strides
+        ):
+            data = np.ascontiguousarray(data, dtype=data.dtype.newbyteorder("="))
+        if self._queue is None:
+            _add_samples(self._handle, data)
+        else:
+            self._queue.put(data)
+
+    def add_trigger(self, sample: int, code: str) -> None:
+        """Add a trigger.
+
+        Parameters
+        ----------
+        sample : int
+            Sample of the trigger, counted from the start of the file.
+        code : str
+            Trigger code, up to 8 characters.
+        """
+        self.add_triggers([sample], [code])
+
+    def add_triggers(self, samples: NDArray[np.int64], codes: list[str]) -> None:
+        """Add several triggers at once.
+
+        Parameters
+        ----------
+        samples : array of shape (n_triggers,)
+            Samples of the triggers, counted from the start of the file.
+        codes : list of str
+            Trigger codes, up to 8 characters each.
+        """
+        self._check_open()
+        samples = [int(sample) for sample in samples]
+        codes = [str(code) for code in codes]
+        if len(samples) != len(codes):
+            raise ValueError("The number of samples and codes should be equal.")
+        if any(sample < 0 for sample in samples):
+            raise ValueError("The trigger samples cannot be negative.")
+        if pyeep.add_triggers(self._handle, samples, codes) != 0:
+            raise RuntimeError("Could not add the triggers.")
+
+    def flush(self) -> None:
+        """Wait for the background thread to write the queued samples."""
+        if self._queue is not None:
+            self._queue.join()
+        self._raise_errors()
+
+    def close(self) -> None:
+        """Finish writing and close the file.
+
+        The file is also closed when the object is garbage collected.
+        """
+        if self._handle == -1:
+            return
+        if self._worker is not None:
+            self._queue.put(None)
+            self._worker.join()
+            self._worker = None
+        pyeep.close(self._handle)
+        self._handle = -1
+        self._raise_errors()
+
+    def _check_open(self) -> None:
+        """Raise if the file is closed or the background thread failed."""
+        if self._handle == -1:
+            raise RuntimeError("The file is closed.")
+        self._raise_errors()
+
+    def _raise_errors(self) -> None:
+        """Re-raise the first error of the background thread."""
+        if self._errors:
+            raise RuntimeError("Could not write the samples.") from self._errors.pop()
+
+
+_SAMPLE_KINDS = {
+    np.dtype(np.float32): "f",
+    np.dtype(np.float64): "d",
+    np.dtype(np.int32): "i",
+}
+
+
+def _add_samples(handle: int, data: NDArray) -> None:
+    """Write a block of shape (n_channels, n_samples) with its strides."""
+    channel_stride, sample_stride = (stride // data.itemsize for stride in data.strides)
+    status = pyeep.add_samples_buffer(
+        handle,
+        data.ctypes.data,
+        data.shape[1],
+        channel_stride,
+        sample_stride,
+        _SAMPLE_KINDS[data.dtype],
+    )
+    if status != 0:
+        raise RuntimeError("Could not write the samples.")
+
+
+def _write_worker(handle: int, queue: Queue, errors: list) -> None:
+    """Write the blocks put in the queue until None is received."""
+    while True:
+        block = queue.get()
+        try:
+            if block is None:
+                return
+            if not errors:
+                _add_samples(handle, block)
+        except Exception as error:
+            errors.append(error)
+        finally:
+            queue.task_done()
+
 
 def read_cnt(fname: Union[str, Path]) -> InputCNT:
     """Read a CNT file.
@@ -337,3 +1441,253 @@ def read_cnt(fname: Union[str, Path]) -> InputCNT:
     if fname.suffix != ".cnt":
         raise RuntimeError(f"Unsupported file extension '{fname.suffix}'.")
     return InputCNT(pyeep.read(str(fname)))
+
+
+def write_cnt(
+    fname: Union[str, Path],
+    sfreq: int,
+    ch_names: list[str],
+    *,
+    ch_units: Optional[list[str]] = None,
+    ch_refs: Optional[list[str]] = None,
+    rf64: bool = False,
+    epoch_length: Optional[int] = None,
+    meas_date: Optional[datetime] = None,
+    hospital: Optional[str] = None,
+    machine_info: Optional[tuple[str, str, str]] = None,
+    patient_info: Optional[tuple[str, str, str, Optional[date]]] = None,
+    encoding: str = "latin-1",
+    background: bool = False,
+) -> OutputCNT:
+    """Create a CNT file for writing.
+
+    Parameters
+    ----------
+    fname : str | Path
+        Path to the .cnt file.
+    sfreq : int
+        Sampling frequency in Hz.
+    ch_names : list of str
+        Channel labels.
+    ch_units : list of str | None
+        Channel units, ``"uV"`` if None.
+    ch_refs : list of str | None
+        Channel reference labels, ``"ref"`` if None.
+    rf64 : bool
+        If True, write a 64 bit RIFF file, required above 4 GB.
+    epoch_length : int | None
+        Number of samples per compressed epoch, one second if None.
+    meas_date : datetime | None
+        Acquisition start time, as returned by
+        :meth:`InputCNT.get_start_time_and_fraction`.
+    hospital : str | None
+        Hospital, as returned by :meth:`InputCNT.get_hospital`.
+    machine_info : tuple of shape (3,) | None
+        Machine make, model and serial number, as returned by
+        :meth:`InputCNT.get_machine_info`.
+    patient_info : tuple of shape (4,) | None
+        Patient name, id, sex and date of birth, as returned by
+        :meth:`InputCNT.get_patient_info`.
+    encoding : str
+        Encoding used for the recording information strings.
+    background : bool
+        If True, compress and write the samples in a background thread. See
+        :class:`OutputCNT`.
+
+    Returns
+    -------
+    cnt : OutputCNT
+        An object representing the CNT file.
+
+    Notes
+    -----
+    .. versionadded: 0.6.0
+    """
+    fname = ensure_path(fname, must_exist=False)
+    if fname.suffix != ".cnt":
+        raise RuntimeError(f"Unsupported file extension '{fname.suffix}'.")
+    n_channels = len(ch_names)
+    if n_channels == 0:
+        raise ValueError("At least one channel is required.")
+    ch_units = ["uV"] * n_channels if ch_units is None else ch_units
+    ch_refs = ["ref"] * n_channels if ch_refs is None else ch_refs
+    if len(ch_units) != n_channels or len(ch_refs) != n_channels:
+        raise ValueError("The channel names, units and references should match.")
+    channel_info = pyeep.create_channel_info()
+    for label, ref, unit in zip(ch_names, ch_refs, ch_units):
+        pyeep.add_channel(channel_info, label, ref, unit)
+    handle = pyeep.write_cnt(
+        str(fname), sfreq, channel_info, int(rf64), epoch_length or 0
+    )
+    pyeep.close_channel_info(channel_info)
+    if handle == -1:
+        raise RuntimeError(f"Could not write '{fname}'.")
+    recinfo = pyeep.create_recinfo()
+    if meas_date is not None:
+        timestamp = meas_date.timestamp()
+        seconds = np.floor(timestamp)
+        pyeep.set_start_date_and_fraction(
+            recinfo, (seconds + 2209161600) / (3600.0 * 24.0), timestamp - seconds
+        )
+    if hospital is not None:
+        pyeep.set_hospital(recinfo, hospital.encode(encoding))
+    setters = (
+        pyeep.set_machine_make,
+        pyeep.set_machine_model,
+        pyeep.set_machine_serial_number,
+    )
+    for setter, value in zip(setters, machine_info or ()):
+        setter(recinfo, value.encode(encoding))
+    if patient_info is not None:
+        name, pid, sex, birthday = patient_info
+        pyeep.set_patient_name(recinfo, name.encode(encoding))
+        pyeep.set_patient_id(recinfo, pid.encode(encoding))
+        if sex:
+            pyeep.set_patient_sex(recinfo, sex)
+        if birthday is not None:
+            pyeep.set_date_of_birth(
+                recinfo, birthday.year, birthday.month, birthday.day
+            )
+    pyeep.add_recording_info(handle, recinfo)
+    pyeep.close_recinfo(recinfo)
+    return OutputCNT(handle, n_channels, background=background)
+
+
+def write_synthetic(
+    fname: Union[str, Path],
+    n_channels: int = 64,
+    sfreq: int = 1000,
+    duration: float = 600.0,
+    *,
+    trigger_rate: float = 1.0,
+    n_segments: int = 1,
+    rf64: bool = False,
+    sidecars: bool = False,
+    line_freq: float = 50.0,
+    seed: int = 0,
+) -> None:
+    """Write a CNT file of synthetic EEG for testing at scale.
+
+    Parameters
+    ----------
+    fname : str | Path
+        Path to the .cnt file.
+    n_channels : int
+        Number of channels. The first 64 are named after a 64 channel cap, the next
+        ones ``E65``, ``E66``, ...
+    sfreq : int
+        Sampling frequency in Hz.
+    duration : float
+        Duration of the recording in seconds.
+    trigger_rate : float
+        Mean number of triggers per second, with codes 1 to 8 at random times.
+    n_segments : int
+        Number of recording segments, the recording pauses between two of them.
+        More than one segment requires ``sidecars=True``.
+    rf64 : bool
+        If True, write a 64 bit RIFF file.
+    sidecars : bool
+        If True, also write the triggers and two impedance measurements to a
+        ``.evt`` file and the segments to a ``.seg`` file, next to the CNT file.
+    line_freq : float
+        Power line frequency in Hz.
+    seed : int
+        Seed of the random generator, the same seed writes the same data.
+
+    Notes
+    -----
+    The signal is pink noise, an alpha rhythm and line noise with blinks and
+    electrode pops, so the file compresses like recorded data.
+
+    .. versionadded: 0.6.0
+    """
+    fname = ensure_path(fname, must_exist=False)
+    if fname.suffix != ".cnt":
+        raise RuntimeError(f"Unsupported file extension '{fname.suffix}'.")
+    if n_segments > 1 and not sidecars:
+        raise ValueError("Recordings with more than one segment require sidecars.")
+    status = pyeep.write_synthetic(
+        str(fname),
+        n_channels,
+        sfreq,
+        duration,
+        trigger_rate,
+        n_segments,
+        int(rf64),
+        int(sidecars),
+        line_freq,
+        seed,
+    )
+    if status != 0:
+        raise RuntimeError(f"Could not write the synthetic recording '{fname}'.")
+
+
+_MEMORY_KEYS = (
+    "live_bytes",
+    "peak_bytes",
+    "live_blocks",
+    "allocations",
+    "reallocations",
+    "frees",
+)
+
+
+def _memory_stats(handle: int) -> dict[str, dict[str, int]]:
+    """Get the memory accounting rows of a handle, -2 for all handles."""
+    return {
+        "total" if tag is None else tag: dict(zip(_MEMORY_KEYS, values))
+        for tag, owner, *values in pyeep.get_memory_stats()
+        if owner == handle
+    }
+
+
+def set_memory_accounting(enable: bool = True) -> None:
+    """Account the memory libeep allocates from now on, per tag and file.
+
+    Parameters
+    ----------
+    enable : bool
+        If True, account allocations (enabling again resets the statistics). If
+        False, stop and discard the statistics.
+
+    Notes
+    -----
+    Accounting costs a table lookup per allocation and is off by default.
+
+    .. versionadded: 0.6.0
+    """
+    pyeep.set_memory_accounting(int(enable))
+
+
+def reset_memory_stats() -> None:
+    """Set the peaks to the memory currently allocated and the counts to zero.
+
+    Notes
+    -----
+    .. versionadded: 0.6.0
+    """
+    pyeep.reset_memory_stats()
+
+
+def get_memory_stats() -> dict[str, dict[str, int]]:
+    """Get the memory allocated by libeep since accounting was enabled.
+
+    Returns
+    -------
+    stats : dict
+        Counters per allocation tag, such as ``"buf"`` for the decoded epoch or
+        ``"epochv"`` for the epoch table, summed over all files, and the sums over
+        all tags under ``"total"``. Each entry is a dict with:
+        - ``live_bytes``, ``live_blocks``: memory allocated and not yet freed.
+        - ``peak_bytes``: largest value of ``live_bytes``.
+        - ``allocations``, ``reallocations``, ``frees``: number of calls.
+
+    Notes
+    -----
+    Peaks are taken over the sums, the peak of ``"total"`` is the largest amount
+    of memory libeep held at once. Use :meth:`InputCNT.get_memory_stats` for the
+    memory of a single file; statistics of closed files are kept.
+
+    .. versionadded: 0.6.0
+    """
+    return _memory_stats(-2)
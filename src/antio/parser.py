@@ -6,9 +6,9 @@ import numpy as np
 
 if TYPE_CHECKING:
     from datetime import date, datetime
-    from typing import Optional
+    from typing import Optional, Union
 
-    from numpy.typing import NDArray
+    from numpy.typing import ArrayLike, NDArray
 
     from .libeep import InputCNT
 
@@ -41,14 +41,10 @@ def read_info(
         Encoding used for the strings.
         .. versionadded: 0.5.0
     """
-    ch_names, ch_units, ch_refs, ch_status, ch_types = [], [], [], [], []
-    for k in range(cnt.get_channel_count()):
-        channel = cnt.get_channel(k, encoding=encoding)
-        ch_names.append(channel[0])
-        ch_units.append(channel[1].lower())  # always lower the unit for mapping
-        ch_refs.append(channel[2])
-        ch_status.append(channel[3])
-        ch_types.append(channel[4])
+    ch_names, ch_units, ch_refs, ch_status, ch_types = cnt.get_channels(
+        encoding=encoding
+    )
+    ch_units = [unit.lower() for unit in ch_units]  # always lower the unit for mapping
     return ch_names, ch_units, ch_refs, ch_status, ch_types
 
 
@@ -113,9 +109,13 @@ def read_device_info(
     -----
     .. versionadded: 0.3.0.
     """
-    make, mode, serial = cnt.get_machine_info(encoding=encoding)
-    site = cnt.get_hospital(encoding=encoding)
-    return make, mode, serial, site
+    info = cnt.get_recording_info(encoding=encoding)
+    return (
+        info["machine_make"],
+        info["machine_model"],
+        info["machine_serial_number"],
+        info["hospital"],
+    )
 
 
 def read_meas_date(cnt: InputCNT) -> Optional[datetime]:
@@ -157,11 +157,97 @@ def read_data(
 
     Notes
     -----
-    The type casting makes the output array writeable.
+    The output array is a new writeable array.
     """
     if last_samp is None:
         last_samp = cnt.get_sample_count()  # sample = (n_channels,)
-    return cnt.get_samples_as_nparray(first_samp, last_samp).astype("float64")
+    # same errors as InputCNT.get_samples_as_nparray, checked before allocating
+    if first_samp < 0 or last_samp < 0:
+        raise RuntimeError(
+            f"Start/Stop index {first_samp}/{last_samp} cannot be negative."
+        )
+    if cnt.get_sample_count() < last_samp:
+        raise RuntimeError(f"End index {last_samp} exceeds total sample count.")
+    if last_samp < first_samp:
+        raise RuntimeError(
+            f"End index {last_samp} is before the start index {first_samp}."
+        )
+    data = np.empty((cnt.get_channel_count(), last_samp - first_samp), np.float64)
+    return read_data_into(cnt, data, first_samp, last_samp)
+
+
+def read_data_into(
+    cnt: InputCNT,
+    out: NDArray[np.float64],
+    start: int,
+    stop: int,
+    picks: Optional[Union[ArrayLike, slice]] = None,
+    scale: ArrayLike = 1.0,
+) -> NDArray[np.float64]:
+    """Read the data of some channels into a preallocated array.
+
+    Parameters
+    ----------
+    cnt : InputCNT
+        The cnt object from which the data is read.
+    out : array of shape (n_picks, n_samples)
+        Writable float64 array filled with the samples ``start`` to ``stop`` of the
+        picked channels. Its rows must be C-contiguous, e.g. ``data[:, a:b]`` of a
+        C-contiguous ``data`` is accepted.
+    start : int
+        Start index.
+    stop : int
+        End index.
+    picks : array-like of int | slice | None
+        Indices of the channels to read, in the order of the rows of ``out``. All the
+        channels if None.
+    scale : float | array-like of shape (n_picks,)
+        Factor applied to the data in µV, e.g. ``1e-6`` for data in V or the
+        calibration of each picked channel.
+
+    Returns
+    -------
+    out : array of shape (n_picks, n_samples)
+        The array ``out`` filled with the data.
+
+    Notes
+    -----
+    The samples are decoded one compression epoch at a time and scaled straight into
+    ``out``, without an intermediate array of all the channels.
+
+    .. versionadded: 0.6.0
+    """
+    n_channels = cnt.get_channel_count()
+    if isinstance(picks, slice):
+        picks = np.arange(n_channels)[picks]
+    picks = np.ascontiguousarray(cnt._pick_channels(picks), dtype=np.intc)
+    try:
+        scale = np.ascontiguousarray(
+            np.broadcast_to(np.asarray(scale, dtype=np.float64), picks.shape)
+        )
+    except ValueError:
+        raise ValueError(
+            f"The scale should be a float or an array of {picks.size} factors."
+        ) from None
+    if not 0 <= start <= stop <= cnt.get_sample_count():
+        raise ValueError(
+            f"The samples {start} to {stop} are out of range for a recording of "
+            f"{cnt.get_sample_count()} samples."
+        )
+    shape = (picks.size, stop - start)
+    if not isinstance(out, np.ndarray) or out.dtype != np.float64:
+        raise TypeError("The output must be a float64 numpy array.")
+    if out.shape != shape:
+        raise ValueError(f"The output shape {out.shape} should be {shape}.")
+    if not out.flags.writeable:
+        raise ValueError("The output must be writable.")
+    if (1 < shape[1] and out.strides[1] != out.itemsize) or (
+        1 < shape[0]
+        and (out.strides[0] % out.itemsize or out.strides[0] < shape[1] * out.itemsize)
+    ):
+        raise ValueError("The rows of the output must be C-contiguous and disjoint.")
+    cnt._get_samples_picked_into(start, stop, picks, scale, out)
+    return out
 
 
 def read_triggers(cnt: InputCNT) -> tuple[list, list, list, list, dict[str, list[int]]]:
@@ -186,17 +272,40 @@ def read_triggers(cnt: InputCNT) -> tuple[list, list, list, list, dict[str, list
         Dictionary with keys 'start' and 'stop' containing the onsets of the amplifier
         disconnection and reconnection.
     """
+    triggers = cnt.get_triggers()
+    impedance_rows = {
+        k: (size, row)
+        for k, size, row in zip(
+            triggers["impedance_index"].tolist(),
+            triggers["impedance_size"].tolist(),
+            triggers["impedances"].tolist(),
+        )
+    }
     onsets, durations, descriptions, impedances = [], [], [], []
     disconnect = dict(start=[], stop=[])
-    for k in range(cnt.get_trigger_count()):
-        code, idx, duration, condition, description, impedance = cnt.get_trigger(k)
+    for k, (idx, duration, code, condition, description) in enumerate(
+        zip(
+            triggers["sample"].tolist(),
+            triggers["duration"].tolist(),
+            triggers["label"],
+            triggers["condition"],
+            triggers["description"],
+        )
+    ):
         # detect impedance measurements
         if (
             description is not None
             and description.lower() == "impedance"
-            and impedance is not None
+            and k in impedance_rows
         ):
-            impedances.append([float(elt) for elt in impedance.split(" ")])
+            size, row = impedance_rows[k]
+            if size >= 0:
+                row = row[:size]
+            else:
+                # not in the syntax libeep parses, float() raises or accepts it
+                impedance = cnt.get_trigger(k)[5]
+                row = [float(elt) for elt in impedance.split(" ")]
+            impedances.append(row)
             # create an impedance annotation to mark the measurement
             onsets.append(idx)
             durations.append(duration)
@@ -0,0 +1,231 @@
+/*
+ * libeep_decode_stress: decode many recordings on many threads at once
+ *
+ * Every input recording is first decoded on the main thread, the samples
+ * and triggers are hashed into a reference digest. Then the worker threads
+ * open, decode and close the recordings round-robin, each with a different
+ * read block size, and compare their digest against the reference. Every
+ * other thread reads through libeep_get_samples_borrowed().
+ * It reports mismatches and the aggregate decode throughput, the exit
+ * status is non-zero if any decode differs.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <v4/eep.h>
+
+#define DEFAULT_THREADS 8
+#define DEFAULT_ROUNDS  4
+#define DECODE_BLOCK    1000
+
+/* monotonic clock in seconds */
+static double
+bench_now(void) {
+#if WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+/* FNV-1a, continued from hash */
+static uint64_t
+digest_update(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  size_t i;
+  for(i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* digest of all samples and triggers of a file, read block samples at a time;
+   returns 0 on success */
+static int
+decode_file(const char *filename, long block, int borrowed, uint64_t *digest, uint64_t *values) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  uint64_t sample;
+  const char *label;
+  cntfile_t handle;
+  const float *samples;
+  long sample_count, from, to;
+  int channel_count, i;
+
+  handle = libeep_read(filename);
+  if(handle == -1) {
+    return 1;
+  }
+  channel_count = libeep_get_channel_count(handle);
+  sample_count = libeep_get_sample_count(handle);
+  for(from = 0; from < sample_count; from = to) {
+    to = from + block < sample_count ? from + block : sample_count;
+    samples = borrowed ? libeep_get_samples_borrowed(handle, from, to) : libeep_get_samples(handle, from, to);
+    if(samples == NULL) {
+      libeep_close(handle);
+      return 1;
+    }
+    hash = digest_update(hash, samples, sizeof(float) * (to - from) * channel_count);
+    if(!borrowed) {
+      libeep_free_samples((float *)samples);
+    }
+  }
+  for(i = 0; i < libeep_get_trigger_count(handle); ++i) {
+    label = libeep_get_trigger(handle, i, &sample);
+    hash = digest_update(hash, label, strlen(label));
+    hash = digest_update(hash, &sample, sizeof(sample));
+  }
+  libeep_close(handle);
+
+  *digest = hash;
+  *values = (uint64_t)sample_count * channel_count;
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+struct stress_job {
+  char     **filenames;
+  uint64_t  *digests;
+  int        filec;
+  int        rounds;
+  int        index;     /* worker index, offsets the files and block size */
+  int        mismatches;
+  uint64_t   values;
+};
+///////////////////////////////////////////////////////////////////////////////
+#if WIN32
+static DWORD WINAPI
+stress_worker(LPVOID arg) {
+#else
+static void *
+stress_worker(void *arg) {
+#endif
+  struct stress_job *job = (struct stress_job *)arg;
+  uint64_t digest, values;
+  int n, f;
+
+  for(n = 0; n < job->rounds * job->filec; ++n) {
+    f = (n + job->index) % job->filec;
+    if(decode_file(job->filenames[f], DECODE_BLOCK + 37 * job->index, job->index & 1, &digest, &values)
+       || digest != job->digests[f]) {
+      job->mismatches += 1;
+    } else {
+      job->values += values;
+    }
+  }
+#if WIN32
+  return 0;
+#else
+  return NULL;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+usage(void) {
+  fprintf(stderr, "usage: libeep_decode_stress [-t threads] [-r rounds] file.cnt [file.cnt ...]\n");
+  fprintf(stderr, "  -t  number of decoding threads (default %i)\n", DEFAULT_THREADS);
+  fprintf(stderr, "  -r  number of times each thread decodes every file (default %i)\n", DEFAULT_ROUNDS);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(int argc, char **argv) {
+  int threadc = DEFAULT_THREADS;
+  int rounds = DEFAULT_ROUNDS;
+  struct stress_job *jobs;
+  uint64_t *digests, values, total = 0;
+  double t0, t;
+  int filec, mismatches = 0;
+  int i = 1, t_i;
+#if WIN32
+  HANDLE *threads;
+#else
+  pthread_t *threads;
+#endif
+
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+      threadc = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-r") && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if(i == argc || threadc < 1 || rounds < 1) {
+    usage();
+    return 1;
+  }
+  filec = argc - i;
+
+  libeep_init();
+  digests = (uint64_t *)malloc(sizeof(uint64_t) * filec);
+  jobs = (struct stress_job *)calloc(threadc, sizeof(struct stress_job));
+#if WIN32
+  threads = (HANDLE *)malloc(sizeof(HANDLE) * threadc);
+#else
+  threads = (pthread_t *)malloc(sizeof(pthread_t) * threadc);
+#endif
+  if(digests == NULL || jobs == NULL || threads == NULL) {
+    fprintf(stderr, "libeep_decode_stress: out of memory\n");
+    return 1;
+  }
+
+  // single threaded reference
+  t0 = bench_now();
+  for(t_i = 0; t_i < filec; ++t_i) {
+    if(decode_file(argv[i + t_i], DECODE_BLOCK, 0, &digests[t_i], &values)) {
+      fprintf(stderr, "libeep_decode_stress: cannot decode %s\n", argv[i + t_i]);
+      return 1;
+    }
+    total += values;
+  }
+  t = bench_now() - t0;
+  printf("%-10s %8s %12s %14s %10s\n", "threads", "decodes", "mismatches", "values[M/s]", "seconds");
+  printf("%-10i %8i %12i %14.1f %10.3f\n", 1, filec, 0, total * 1e-6 / t, t);
+
+  // concurrent decodes
+  t0 = bench_now();
+  for(t_i = 0; t_i < threadc; ++t_i) {
+    jobs[t_i].filenames = argv + i;
+    jobs[t_i].digests = digests;
+    jobs[t_i].filec = filec;
+    jobs[t_i].rounds = rounds;
+    jobs[t_i].index = t_i;
+#if WIN32
+    threads[t_i] = CreateThread(NULL, 0, stress_worker, &jobs[t_i], 0, NULL);
+#else
+    pthread_create(&threads[t_i], NULL, stress_worker, &jobs[t_i]);
+#endif
+  }
+  total = 0;
+  for(t_i = 0; t_i < threadc; ++t_i) {
+#if WIN32
+    WaitForSingleObject(threads[t_i], INFINITE);
+    CloseHandle(threads[t_i]);
+#else
+    pthread_join(threads[t_i], NULL);
+#endif
+    mismatches += jobs[t_i].mismatches;
+    total += jobs[t_i].values;
+  }
+  t = bench_now() - t0;
+  printf("%-10i %8i %12i %14.1f %10.3f\n", threadc, threadc * rounds * filec, mismatches, total * 1e-6 / t, t);
+
+  free(threads);
+  free(jobs);
+  free(digests);
+  libeep_exit();
+  return mismatches != 0;
+}
@@ -0,0 +1,209 @@
+/*
+ * libeep_epoch_bench: sweep the RAW3 epoch length used on write
+ *
+ * Every input recording is rewritten with each epoch length of the sweep.
+ * For each length it reports:
+ *   - the compression ratio against plain 32 bit samples
+ *   - the sequential decode throughput
+ *   - the mean latency of a single-sample read at a random position
+ *   - the writer latency, i.e. how long samples wait before their epoch
+ *     reaches the file
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if WIN32
+#include <windows.h>
+#endif
+
+#include <v4/eep.h>
+
+#define DEFAULT_EPOCH_LENGTHS "32,64,128,256,512,1024,2048,4096,8192"
+#define DEFAULT_RANDOM_READS  500
+#define DECODE_BLOCK          4096
+#define TEMP_FILENAME         "libeep_epoch_bench.tmp.cnt"
+
+/* monotonic clock in seconds */
+static double
+bench_now(void) {
+#if WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+static long
+file_size(const char *filename) {
+  long size;
+  FILE *f = fopen(filename, "rb");
+  if(f == NULL) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  return size;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* rewrite samples with the given epoch length, returns 0 on success */
+static int
+write_copy(cntfile_t in, const int32_t *samples, long sample_count, int epoch_length) {
+  int c;
+  int channel_count = libeep_get_channel_count(in);
+  chaninfo_t channel_info = libeep_create_channel_info();
+  cntfile_t out;
+
+  for(c = 0; c < channel_count; ++c) {
+    libeep_add_channel(channel_info,
+                       libeep_get_channel_label(in, c),
+                       libeep_get_channel_reference(in, c),
+                       libeep_get_channel_unit(in, c));
+  }
+  out = libeep_write_cnt_with_epoch_length(TEMP_FILENAME, libeep_get_sample_frequency(in), channel_info, 0, epoch_length);
+  libeep_close_channel_info(channel_info);
+  if(out == -1) {
+    return -1;
+  }
+  libeep_add_raw_samples(out, samples, (int)sample_count);
+  libeep_close(out);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+bench_file(const char *filename, const int *epoch_lengths, int epoch_length_count, int random_reads) {
+  cntfile_t in;
+  int32_t *samples;
+  int32_t *block;
+  long sample_count, s, n;
+  int channel_count, rate, i, r;
+  double t0, decode_time, random_time, raw_bytes;
+
+  in = libeep_read(filename);
+  if(in == -1) {
+    fprintf(stderr, "libeep_epoch_bench: cannot read %s\n", filename);
+    return 1;
+  }
+  channel_count = libeep_get_channel_count(in);
+  sample_count = libeep_get_sample_count(in);
+  rate = libeep_get_sample_frequency(in);
+  samples = libeep_get_raw_samples(in, 0, sample_count);
+  if(samples == NULL) {
+    fprintf(stderr, "libeep_epoch_bench: cannot decode %s\n", filename);
+    libeep_close(in);
+    return 1;
+  }
+  raw_bytes = (double)sample_count * channel_count * sizeof(int32_t);
+
+  printf("%s: %i channels, %ld samples, %i Hz, epoch length %i\n", filename, channel_count, sample_count, rate, libeep_get_epoch_length(in));
+  printf("%8s %8s %14s %12s %12s\n", "epoch", "ratio", "decode[MS/s]", "random[us]", "latency[ms]");
+
+  for(i = 0; i < epoch_length_count; ++i) {
+    cntfile_t copy;
+
+    if(write_copy(in, samples, sample_count, epoch_lengths[i])) {
+      fprintf(stderr, "libeep_epoch_bench: cannot write %s\n", TEMP_FILENAME);
+      break;
+    }
+
+    copy = libeep_read(TEMP_FILENAME);
+    if(copy == -1) {
+      fprintf(stderr, "libeep_epoch_bench: cannot read %s\n", TEMP_FILENAME);
+      break;
+    }
+
+    /* sequential decode */
+    t0 = bench_now();
+    for(s = 0; s < sample_count; s += n) {
+      n = sample_count - s < DECODE_BLOCK ? sample_count - s : DECODE_BLOCK;
+      block = libeep_get_raw_samples(copy, s, s + n);
+      libeep_free_raw_samples(block);
+    }
+    decode_time = bench_now() - t0;
+
+    /* single samples at random positions, fixed seed for comparable runs */
+    srand(1);
+    t0 = bench_now();
+    for(r = 0; r < random_reads; ++r) {
+      s = (long)((double)rand() / ((double)RAND_MAX + 1.0) * sample_count);
+      block = libeep_get_raw_samples(copy, s, s + 1);
+      libeep_free_raw_samples(block);
+    }
+    random_time = bench_now() - t0;
+
+    libeep_close(copy);
+
+    printf("%8i %8.3f %14.2f %12.2f %12.1f\n",
+           epoch_lengths[i],
+           raw_bytes / (double)file_size(TEMP_FILENAME),
+           (double)sample_count * channel_count / decode_time * 1e-6,
+           random_reads ? random_time / random_reads * 1e6 : 0.0,
+           1000.0 * epoch_lengths[i] / rate);
+    remove(TEMP_FILENAME);
+  }
+  printf("\n");
+
+  libeep_free_raw_samples(samples);
+  libeep_close(in);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+usage(void) {
+  fprintf(stderr, "usage: libeep_epoch_bench [-e len,len,...] [-r random_reads] file.cnt [file.cnt ...]\n");
+  fprintf(stderr, "  -e  epoch lengths to sweep (default %s)\n", DEFAULT_EPOCH_LENGTHS);
+  fprintf(stderr, "  -r  number of random single-sample reads (default %i)\n", DEFAULT_RANDOM_READS);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(int argc, char **argv) {
+  const char *sweep = DEFAULT_EPOCH_LENGTHS;
+  int random_reads = DEFAULT_RANDOM_READS;
+  int epoch_lengths[64];
+  int epoch_length_count = 0;
+  int status = 0;
+  int i = 1;
+  char *list, *token;
+
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(!strcmp(argv[i], "-e") && i + 1 < argc) {
+      sweep = argv[++i];
+    } else if(!strcmp(argv[i], "-r") && i + 1 < argc) {
+      random_reads = atoi(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if(i == argc) {
+    usage();
+    return 1;
+  }
+
+  list = (char *)malloc(strlen(sweep) + 1);
+  strcpy(list, sweep);
+  for(token = strtok(list, ","); token != NULL && epoch_length_count < 64; token = strtok(NULL, ",")) {
+    epoch_lengths[epoch_length_count] = atoi(token);
+    if(epoch_lengths[epoch_length_count] < 1) {
+      fprintf(stderr, "libeep_epoch_bench: invalid epoch length %s\n", token);
+      free(list);
+      return 1;
+    }
+    epoch_length_count++;
+  }
+  free(list);
+
+  libeep_init();
+  for(; i < argc; ++i) {
+    status |= bench_file(argv[i], epoch_lengths, epoch_length_count, random_reads);
+  }
+  libeep_exit();
+  return status;
+}
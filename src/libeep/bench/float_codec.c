@@ -0,0 +1,296 @@
+/*
+ * libeep_float_bench: compressed float blocks for TIMEFREQ and AVERAGE data
+ *
+ * The EEG of every input recording is turned into float data the way
+ * analysis tools produce it:
+ *   - TIMEFREQ: band power per channel by complex demodulation at each of
+ *     the analysis frequencies, smoothed over one period
+ *   - AVERAGE: the signal itself, in microvolts
+ * Both are written with plain and with compressed float blocks
+ * (eep_set_float_compression). For each it reports the compression ratio
+ * and the write and read throughput, and checks that the data read back
+ * is bit identical.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if WIN32
+#include <windows.h>
+#endif
+
+#include <cnt/cnt.h>
+#include <eep/eepio.h>
+#include <v4/eep.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DEFAULT_COMPONENTS 20
+#define DEFAULT_SAMPLES    10000
+#define EPOCH_LENGTH       256
+#define TEMP_FILENAME      "libeep_float_bench.tmp.cnt"
+
+/* monotonic clock in seconds */
+static double
+bench_now(void) {
+#if WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+static long
+file_size(const char *filename) {
+  long size;
+  FILE *f = fopen(filename, "rb");
+  if(f == NULL) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  return size;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* band power of every channel at compc frequencies up to rate / 4, TF multiplexed */
+static float *
+band_power(const float *samples, long sample_count, int channel_count, int rate, int compc) {
+  float *power = (float *)malloc(sizeof(float) * sample_count * channel_count * compc);
+  double *re, *im;
+  double freq, phase, sre, sim;
+  long s;
+  int c, comp, width;
+
+  re = (double *)malloc(sizeof(double) * (sample_count + 1));
+  im = (double *)malloc(sizeof(double) * (sample_count + 1));
+  if(power == NULL || re == NULL || im == NULL) {
+    free(power);
+    free(re);
+    free(im);
+    return NULL;
+  }
+  for(comp = 0; comp < compc; ++comp) {
+    freq = 1.0 + (rate / 4.0 - 1.0) * comp / (compc > 1 ? compc - 1 : 1);
+    width = (int)(rate / freq) + 1;
+    for(c = 0; c < channel_count; ++c) {
+      /* running sums of the demodulated signal, averaged over one period */
+      re[0] = im[0] = 0;
+      for(s = 0; s < sample_count; ++s) {
+        phase = 2 * M_PI * freq * s / rate;
+        re[s + 1] = re[s] + samples[s * channel_count + c] * cos(phase);
+        im[s + 1] = im[s] - samples[s * channel_count + c] * sin(phase);
+      }
+      for(s = 0; s < sample_count; ++s) {
+        long lo = s - width / 2 < 0 ? 0 : s - width / 2;
+        long hi = lo + width > sample_count ? sample_count : lo + width;
+        sre = (re[hi] - re[lo]) / (hi - lo);
+        sim = (im[hi] - im[lo]) / (hi - lo);
+        power[(s * compc + comp) * channel_count + c] = (float)(sre * sre + sim * sim);
+      }
+    }
+  }
+  free(re);
+  free(im);
+  return power;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* write data of the given type, returns the seconds taken or -1 */
+static double
+write_floats(eep_datatype_e type, const float *data, long sample_count, int channel_count, int rate, int compc, int compress) {
+  eegchan_t *chanv = eep_chan_init((short)channel_count);
+  tf_component_t *compv = NULL;
+  eeg_t *cnt;
+  FILE *f;
+  char label[16];
+  double t0;
+  int c, status;
+
+  for(c = 0; c < channel_count; ++c) {
+    sprintf(label, "E%i", c + 1);
+    eep_chan_set(chanv, (short)c, label, 1.0, 1.0, "uV");
+  }
+  if(type == DATATYPE_TIMEFREQ) {
+    compv = eep_comp_init((short)compc);
+    for(c = 0; c < compc; ++c) {
+      eep_comp_set(compv, (short)c, (float)c, "");
+    }
+    cnt = eep_init_from_tf_values(1.0 / rate, (short)channel_count, chanv, (short)compc, compv);
+    if(cnt != NULL) {
+      eep_set_tf_type(cnt, "Demodulation");
+      eep_set_tf_contenttype(cnt, CONTENT_POWER);
+    }
+  } else {
+    cnt = eep_init_from_values(1.0 / rate, (short)channel_count, chanv);
+  }
+  if(cnt == NULL) {
+    return -1;
+  }
+  f = eepio_fopen(TEMP_FILENAME, "wb");
+  if(f == NULL) {
+    eep_free(cnt);
+    return -1;
+  }
+
+  t0 = bench_now();
+  status = eep_create_file(cnt, TEMP_FILENAME, f, NULL, 0, "libeep_float_bench");
+  if(status == CNTERR_NONE) {
+    status = eep_prepare_to_write(cnt, type, EPOCH_LENGTH, NULL);
+  }
+  if(status == CNTERR_NONE) {
+    eep_set_float_compression(cnt, compress);
+    status = eep_write_float(cnt, (float *)data, sample_count);
+  }
+  if(status == CNTERR_NONE) {
+    status = eep_fclose(cnt);
+  }
+  return status == CNTERR_NONE ? bench_now() - t0 : -1;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* read the data back, returns the seconds taken or -1 if it differs */
+static double
+read_floats(eep_datatype_e type, const float *data, long sample_count, int values) {
+  float *buf = (float *)malloc(sizeof(float) * sample_count * values);
+  eeg_t *cnt;
+  FILE *f;
+  double t0, t;
+  int status;
+
+  f = eepio_fopen(TEMP_FILENAME, "rb");
+  if(buf == NULL || f == NULL) {
+    free(buf);
+    return -1;
+  }
+  t0 = bench_now();
+  cnt = eep_init_from_file(TEMP_FILENAME, f, &status);
+  if(status == CNTERR_NONE) {
+    status = eep_seek(cnt, type, 0, 0);
+  }
+  if(status == CNTERR_NONE) {
+    status = eep_read_float(cnt, type, buf, sample_count);
+  }
+  t = bench_now() - t0;
+  if(cnt != NULL) {
+    eep_fclose(cnt);
+  }
+  if(status != CNTERR_NONE || memcmp(buf, data, sizeof(float) * sample_count * values)) {
+    t = -1;
+  }
+  free(buf);
+  return t;
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+bench_type(const char *name, eep_datatype_e type, const float *data, long sample_count, int channel_count, int rate, int compc) {
+  int values = channel_count * (type == DATATYPE_TIMEFREQ ? compc : 1);
+  double mb = (double)sample_count * values * sizeof(float) * 1e-6;
+  double tw, tr;
+  long size[2];
+  int compress;
+
+  for(compress = 0; compress < 2; ++compress) {
+    tw = write_floats(type, data, sample_count, channel_count, rate, compc, compress);
+    if(tw < 0) {
+      fprintf(stderr, "libeep_float_bench: cannot write %s\n", TEMP_FILENAME);
+      return 1;
+    }
+    size[compress] = file_size(TEMP_FILENAME);
+    tr = read_floats(type, data, sample_count, values);
+    remove(TEMP_FILENAME);
+    if(tr < 0) {
+      fprintf(stderr, "libeep_float_bench: %s data read back differs\n", name);
+      return 1;
+    }
+    printf("%-9s %-6s %12ld %8.3f %12.1f %12.1f\n",
+           name, compress ? "xor" : "plain", size[compress],
+           (double)size[0] / (double)size[compress], mb / tw, mb / tr);
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+bench_file(const char *filename, long max_samples, int compc) {
+  cntfile_t in;
+  float *samples, *power;
+  long sample_count;
+  int channel_count, rate, status;
+
+  in = libeep_read(filename);
+  if(in == -1) {
+    fprintf(stderr, "libeep_float_bench: cannot read %s\n", filename);
+    return 1;
+  }
+  channel_count = libeep_get_channel_count(in);
+  rate = libeep_get_sample_frequency(in);
+  sample_count = libeep_get_sample_count(in);
+  if(sample_count > max_samples) {
+    sample_count = max_samples;
+  }
+  samples = libeep_get_samples(in, 0, sample_count);
+  libeep_close(in);
+  if(samples == NULL) {
+    fprintf(stderr, "libeep_float_bench: cannot decode %s\n", filename);
+    return 1;
+  }
+  power = band_power(samples, sample_count, channel_count, rate, compc);
+  if(power == NULL) {
+    libeep_free_samples(samples);
+    return 1;
+  }
+
+  printf("%s: %i channels, %ld samples, %i Hz, %i components\n", filename, channel_count, sample_count, rate, compc);
+  printf("%-9s %-6s %12s %8s %12s %12s\n", "data", "blocks", "bytes", "ratio", "write[MB/s]", "read[MB/s]");
+  status = bench_type("timefreq", DATATYPE_TIMEFREQ, power, sample_count, channel_count, rate, compc)
+        || bench_type("average", DATATYPE_AVERAGE, samples, sample_count, channel_count, rate, compc);
+  printf("\n");
+
+  free(power);
+  libeep_free_samples(samples);
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+usage(void) {
+  fprintf(stderr, "usage: libeep_float_bench [-c components] [-n samples] file.cnt [file.cnt ...]\n");
+  fprintf(stderr, "  -c  number of time-frequency components (default %i)\n", DEFAULT_COMPONENTS);
+  fprintf(stderr, "  -n  use at most this many samples of each file (default %i)\n", DEFAULT_SAMPLES);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(int argc, char **argv) {
+  int compc = DEFAULT_COMPONENTS;
+  long max_samples = DEFAULT_SAMPLES;
+  int status = 0;
+  int i = 1;
+
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(!strcmp(argv[i], "-c") && i + 1 < argc) {
+      compc = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-n") && i + 1 < argc) {
+      max_samples = atol(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if(i == argc || compc < 1 || max_samples < 1) {
+    usage();
+    return 1;
+  }
+
+  libeep_init();
+  for(; i < argc; ++i) {
+    status |= bench_file(argv[i], max_samples, compc);
+  }
+  libeep_exit();
+  return status;
+}
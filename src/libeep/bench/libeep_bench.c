@@ -0,0 +1,398 @@
+/*
+ * libeep_bench: read and write hot paths, as JSON
+ *
+ * For every input recording it measures:
+ *   - the open latency, libeep_read() followed by libeep_close()
+ *   - the sequential decode throughput of the whole file, with the split of
+ *     the time into reading, decoding and scaling from libeep_get_stats()
+ *   - the mean latency of a single-sample read at a random position
+ *   - the throughput of reads of a subset of the channels
+ * Then it writes synthetic recordings for every combination of channel
+ * count and epoch length and measures the write throughput, the
+ * compression ratio and the decode throughput of the result.
+ *
+ * The results are written as one JSON document to stdout or to the file
+ * given with -o, so they can be compared between releases. The random
+ * positions and the synthetic data use fixed seeds.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if WIN32
+#include <windows.h>
+#endif
+
+#include <v4/eep.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DEFAULT_OPENS          20
+#define DEFAULT_RANDOM_READS   500
+#define DEFAULT_CHANNELS       "8,32,64,128,256"
+#define DEFAULT_EPOCH_LENGTHS  "256,1024,4096"
+#define DEFAULT_SYNTH_SECONDS  60
+#define SYNTH_RATE             1000
+#define DECODE_BLOCK           4096
+#define MAX_LIST               64
+#define TEMP_FILENAME          "libeep_bench.tmp.cnt"
+
+static const int subset_sizes[] = { 1, 4, 16 };
+
+/* monotonic clock in seconds */
+static double
+bench_now(void) {
+#if WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+static long
+file_size(const char *filename) {
+  long size;
+  FILE *f = fopen(filename, "rb");
+  if(f == NULL) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  return size;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* s as a JSON string */
+static void
+json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for(; *s; ++s) {
+    if(*s == '"' || *s == '\\') {
+      fprintf(out, "\\%c", *s);
+    } else if((unsigned char)*s < 0x20) {
+      fprintf(out, "\\u%04x", (unsigned char)*s);
+    } else {
+      fputc(*s, out);
+    }
+  }
+  fputc('"', out);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* parse a comma separated list of positive integers, returns the count or -1 */
+static int
+parse_list(const char *text, int *values) {
+  char *list, *token;
+  int count = 0;
+
+  list = (char *)malloc(strlen(text) + 1);
+  if(list == NULL) {
+    return -1;
+  }
+  strcpy(list, text);
+  for(token = strtok(list, ","); token != NULL; token = strtok(NULL, ",")) {
+    if(count == MAX_LIST || atoi(token) < 1) {
+      count = -1;
+      break;
+    }
+    values[count++] = atoi(token);
+  }
+  free(list);
+  return count;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* decode the whole file block by block, returns the seconds taken or -1 */
+static double
+decode_all(cntfile_t handle, long sample_count) {
+  long s, n;
+  double t0 = bench_now();
+
+  for(s = 0; s < sample_count; s += n) {
+    n = sample_count - s < DECODE_BLOCK ? sample_count - s : DECODE_BLOCK;
+    if(libeep_get_samples_borrowed(handle, s, s + n) == NULL) {
+      return -1;
+    }
+  }
+  return bench_now() - t0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* read the whole file, keeping subset_count channels spread over all of
+   them, returns the seconds taken or -1 */
+static double
+decode_subset(cntfile_t handle, long sample_count, int channel_count, int subset_count, float *dest) {
+  const float *samples;
+  long s, n, i;
+  int c, stride = channel_count / subset_count;
+  double t0 = bench_now();
+
+  for(s = 0; s < sample_count; s += n) {
+    n = sample_count - s < DECODE_BLOCK ? sample_count - s : DECODE_BLOCK;
+    samples = libeep_get_samples_borrowed(handle, s, s + n);
+    if(samples == NULL) {
+      return -1;
+    }
+    for(i = 0; i < n; ++i) {
+      for(c = 0; c < subset_count; ++c) {
+        dest[i * subset_count + c] = samples[i * channel_count + c * stride];
+      }
+    }
+  }
+  return bench_now() - t0;
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+bench_file(FILE *out, const char *filename, int opens, int random_reads) {
+  struct libeep_stats stats;
+  cntfile_t handle;
+  float *dest;
+  long sample_count, s;
+  int channel_count, i, r;
+  double t0, t, open_time, decode_time, random_time, mb;
+
+  /* open latency, the first open also warms the file cache */
+  handle = libeep_read(filename);
+  if(handle == -1) {
+    fprintf(stderr, "libeep_bench: cannot read %s\n", filename);
+    return 1;
+  }
+  libeep_close(handle);
+  t0 = bench_now();
+  for(r = 0; r < opens; ++r) {
+    libeep_close(libeep_read(filename));
+  }
+  open_time = (bench_now() - t0) / opens;
+
+  handle = libeep_read(filename);
+  channel_count = libeep_get_channel_count(handle);
+  sample_count = libeep_get_sample_count(handle);
+  mb = (double)sample_count * channel_count * sizeof(float) * 1e-6;
+
+  /* sequential decode */
+  libeep_reset_stats(handle);
+  decode_time = decode_all(handle, sample_count);
+  libeep_get_stats(handle, &stats);
+  if(decode_time < 0) {
+    fprintf(stderr, "libeep_bench: cannot decode %s\n", filename);
+    libeep_close(handle);
+    return 1;
+  }
+
+  /* single samples at random positions */
+  srand(1);
+  t0 = bench_now();
+  for(r = 0; r < random_reads; ++r) {
+    s = (long)((double)rand() / ((double)RAND_MAX + 1.0) * sample_count);
+    libeep_get_samples_borrowed(handle, s, s + 1);
+  }
+  random_time = bench_now() - t0;
+
+  fprintf(out, "    {\n      \"file\": ");
+  json_string(out, filename);
+  fprintf(out, ",\n      \"channels\": %i,\n      \"samples\": %ld,\n      \"rate\": %i,\n      \"epoch_length\": %i,\n",
+          channel_count, sample_count, libeep_get_sample_frequency(handle), libeep_get_epoch_length(handle));
+  fprintf(out, "      \"open_ms\": %.4f,\n", open_time * 1e3);
+  fprintf(out, "      \"decode\": {\"seconds\": %.6f, \"mb_per_s\": %.2f, \"read_ns\": %llu, \"decode_ns\": %llu, \"scale_ns\": %llu, \"bytes_read\": %llu},\n",
+          decode_time, mb / decode_time,
+          (unsigned long long)stats.read_ns, (unsigned long long)stats.decode_ns,
+          (unsigned long long)stats.scale_ns, (unsigned long long)stats.bytes_read);
+  fprintf(out, "      \"random_read_us\": %.3f,\n", random_reads ? random_time / random_reads * 1e6 : 0.0);
+
+  /* channel subsets, the output is the size of the subset */
+  fprintf(out, "      \"subsets\": [");
+  dest = (float *)malloc(sizeof(float) * DECODE_BLOCK * subset_sizes[sizeof(subset_sizes) / sizeof(subset_sizes[0]) - 1]);
+  for(i = 0; dest != NULL && i < (int)(sizeof(subset_sizes) / sizeof(subset_sizes[0])) && subset_sizes[i] <= channel_count; ++i) {
+    t = decode_subset(handle, sample_count, channel_count, subset_sizes[i], dest);
+    fprintf(out, "%s\n        {\"channels\": %i, \"seconds\": %.6f, \"mb_per_s\": %.2f}",
+            i ? "," : "", subset_sizes[i], t, (double)sample_count * subset_sizes[i] * sizeof(float) * 1e-6 / t);
+  }
+  fprintf(out, "\n      ]\n    }");
+  free(dest);
+
+  libeep_close(handle);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* EEG-like synthetic data: per channel an AR(1) process and a 10 Hz rhythm,
+   plus a drift shared by all channels, from a fixed seed */
+static int32_t *
+synth_samples(long sample_count, int channel_count) {
+  int32_t *samples = (int32_t *)malloc(sizeof(int32_t) * sample_count * channel_count);
+  double *state = (double *)calloc(channel_count, sizeof(double));
+  uint32_t seed = 12345;
+  double noise, alpha, drift = 0;
+  long s;
+  int c;
+
+  if(samples == NULL || state == NULL) {
+    free(samples);
+    free(state);
+    return NULL;
+  }
+  for(s = 0; s < sample_count; ++s) {
+    seed = seed * 1664525u + 1013904223u;
+    drift += (double)(seed >> 8) / 16777216.0 - 0.5;
+    for(c = 0; c < channel_count; ++c) {
+      seed = seed * 1664525u + 1013904223u;
+      noise = (double)(seed >> 8) / 16777216.0 - 0.5;
+      state[c] = 0.95 * state[c] + 400.0 * noise;
+      alpha = (c % 8) * 100.0 * sin(2 * M_PI * 10.0 * s / SYNTH_RATE);
+      samples[s * channel_count + c] = (int32_t)(state[c] + alpha + 10.0 * drift);
+    }
+  }
+  free(state);
+  return samples;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* write a synthetic recording and read it back */
+static int
+bench_write(FILE *out, int first, int channel_count, int epoch_length, long sample_count) {
+  chaninfo_t channel_info;
+  cntfile_t handle;
+  int32_t *samples;
+  char label[16];
+  double t0, write_time, decode_time, mb;
+  long size;
+  int c;
+
+  samples = synth_samples(sample_count, channel_count);
+  if(samples == NULL) {
+    fprintf(stderr, "libeep_bench: out of memory\n");
+    return 1;
+  }
+  channel_info = libeep_create_channel_info();
+  for(c = 0; c < channel_count; ++c) {
+    sprintf(label, "E%i", c + 1);
+    libeep_add_channel(channel_info, label, "ref", "uV");
+  }
+
+  t0 = bench_now();
+  handle = libeep_write_cnt_with_epoch_length(TEMP_FILENAME, SYNTH_RATE, channel_info, 0, epoch_length);
+  if(handle != -1) {
+    libeep_add_raw_samples(handle, samples, (int)sample_count);
+    libeep_close(handle);
+  }
+  write_time = bench_now() - t0;
+  libeep_close_channel_info(channel_info);
+  free(samples);
+  if(handle == -1) {
+    fprintf(stderr, "libeep_bench: cannot write %s\n", TEMP_FILENAME);
+    return 1;
+  }
+  size = file_size(TEMP_FILENAME);
+
+  handle = libeep_read(TEMP_FILENAME);
+  decode_time = handle == -1 ? -1 : decode_all(handle, sample_count);
+  if(handle != -1) {
+    libeep_close(handle);
+  }
+  remove(TEMP_FILENAME);
+  if(decode_time < 0) {
+    fprintf(stderr, "libeep_bench: cannot decode %s\n", TEMP_FILENAME);
+    return 1;
+  }
+
+  mb = (double)sample_count * channel_count * sizeof(int32_t) * 1e-6;
+  fprintf(out, "%s\n    {\"channels\": %i, \"epoch_length\": %i, \"samples\": %ld, \"bytes\": %ld, \"ratio\": %.4f, \"write_mb_per_s\": %.2f, \"decode_mb_per_s\": %.2f}",
+          first ? "" : ",", channel_count, epoch_length, sample_count, size,
+          mb * 1e6 / (double)size, mb / write_time, mb / decode_time);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+usage(void) {
+  fprintf(stderr, "usage: libeep_bench [-o out.json] [-n opens] [-r random_reads] [-c chans,...] [-e len,...] [-s seconds] [file.cnt ...]\n");
+  fprintf(stderr, "  -o  write the JSON results to this file instead of stdout\n");
+  fprintf(stderr, "  -n  number of opens timed per file (default %i)\n", DEFAULT_OPENS);
+  fprintf(stderr, "  -r  number of random single-sample reads per file (default %i)\n", DEFAULT_RANDOM_READS);
+  fprintf(stderr, "  -c  channel counts of the synthetic recordings (default %s)\n", DEFAULT_CHANNELS);
+  fprintf(stderr, "  -e  epoch lengths of the synthetic recordings (default %s)\n", DEFAULT_EPOCH_LENGTHS);
+  fprintf(stderr, "  -s  length of the synthetic recordings in seconds at %i Hz, 0 skips them (default %i)\n", SYNTH_RATE, DEFAULT_SYNTH_SECONDS);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(int argc, char **argv) {
+  const char *output = NULL;
+  const char *channels = DEFAULT_CHANNELS;
+  const char *epochs = DEFAULT_EPOCH_LENGTHS;
+  int opens = DEFAULT_OPENS;
+  int random_reads = DEFAULT_RANDOM_READS;
+  int seconds = DEFAULT_SYNTH_SECONDS;
+  int channel_counts[MAX_LIST], epoch_lengths[MAX_LIST];
+  int channel_count_count, epoch_length_count;
+  int status = 0;
+  int i = 1, c, e, f;
+  FILE *out = stdout;
+
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+      output = argv[++i];
+    } else if(!strcmp(argv[i], "-n") && i + 1 < argc) {
+      opens = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-r") && i + 1 < argc) {
+      random_reads = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-c") && i + 1 < argc) {
+      channels = argv[++i];
+    } else if(!strcmp(argv[i], "-e") && i + 1 < argc) {
+      epochs = argv[++i];
+    } else if(!strcmp(argv[i], "-s") && i + 1 < argc) {
+      seconds = atoi(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  channel_count_count = parse_list(channels, channel_counts);
+  epoch_length_count = parse_list(epochs, epoch_lengths);
+  if(opens < 1 || random_reads < 0 || seconds < 0 || channel_count_count < 0 || epoch_length_count < 0) {
+    usage();
+    return 1;
+  }
+  if(output != NULL) {
+    out = fopen(output, "w");
+    if(out == NULL) {
+      fprintf(stderr, "libeep_bench: cannot open %s\n", output);
+      return 1;
+    }
+  }
+
+  libeep_init();
+  fprintf(out, "{\n  \"libeep_version\": \"%s\",\n  \"opens\": %i,\n  \"random_reads\": %i,\n  \"files\": [\n",
+          libeep_get_version(), opens, random_reads);
+  for(f = 0; i < argc; ++i) {
+    if(f) {
+      fprintf(out, ",\n");
+    }
+    if(bench_file(out, argv[i], opens, random_reads)) {
+      status = 1;
+      fprintf(out, "    {\"file\": ");
+      json_string(out, argv[i]);
+      fprintf(out, ", \"error\": true}");
+    }
+    f = 1;
+  }
+  fprintf(out, "\n  ],\n  \"synthetic\": [");
+  for(c = 0, f = 1; seconds && c < channel_count_count; ++c) {
+    for(e = 0; e < epoch_length_count; ++e) {
+      if(bench_write(out, f, channel_counts[c], epoch_lengths[e], (long)seconds * SYNTH_RATE)) {
+        status = 1;
+      } else {
+        f = 0;
+      }
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+  libeep_exit();
+
+  if(out != stdout) {
+    fclose(out);
+  }
+  return status;
+}
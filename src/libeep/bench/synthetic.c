@@ -0,0 +1,85 @@
+/*
+ * libeep_synth: write synthetic recordings for testing at scale
+ *
+ * Writes a CNT file of synthetic EEG with libeep_write_synthetic(): pink
+ * noise, an alpha rhythm, line noise, blinks and electrode pops, and
+ * triggers at random times. The same seed writes the same file.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <v4/eep.h>
+
+#define DEFAULT_CHANNELS     64
+#define DEFAULT_RATE         1000
+#define DEFAULT_DURATION     600
+#define DEFAULT_TRIGGER_RATE 1.0
+#define DEFAULT_LINE         50
+
+static void
+usage(void) {
+  fprintf(stderr, "usage: libeep_synth [-c channels] [-r rate] [-d seconds] [-t triggers/s] [-g segments] [-l line] [-s seed] [-64] [-e] file.cnt\n");
+  fprintf(stderr, "  -c   number of channels (default %i)\n", DEFAULT_CHANNELS);
+  fprintf(stderr, "  -r   sampling rate in Hz (default %i)\n", DEFAULT_RATE);
+  fprintf(stderr, "  -d   duration in seconds (default %i)\n", DEFAULT_DURATION);
+  fprintf(stderr, "  -t   mean number of triggers per second, 0 for none (default %g)\n", DEFAULT_TRIGGER_RATE);
+  fprintf(stderr, "  -g   number of recording segments, more than 1 needs -e (default 1)\n");
+  fprintf(stderr, "  -l   power line frequency in Hz (default %i)\n", DEFAULT_LINE);
+  fprintf(stderr, "  -s   random seed (default 0)\n");
+  fprintf(stderr, "  -64  write a 64 bit RIFF file\n");
+  fprintf(stderr, "  -e   also write .evt and .seg sidecars\n");
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(int argc, char **argv) {
+  struct libeep_synthetic synthetic;
+  int status;
+  int i = 1;
+
+  memset(&synthetic, 0, sizeof(synthetic));
+  synthetic.channel_count = DEFAULT_CHANNELS;
+  synthetic.rate = DEFAULT_RATE;
+  synthetic.duration = DEFAULT_DURATION;
+  synthetic.trigger_rate = DEFAULT_TRIGGER_RATE;
+  synthetic.segments = 1;
+  synthetic.line_frequency = DEFAULT_LINE;
+
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(!strcmp(argv[i], "-c") && i + 1 < argc) {
+      synthetic.channel_count = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-r") && i + 1 < argc) {
+      synthetic.rate = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-d") && i + 1 < argc) {
+      synthetic.duration = atof(argv[++i]);
+    } else if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+      synthetic.trigger_rate = atof(argv[++i]);
+    } else if(!strcmp(argv[i], "-g") && i + 1 < argc) {
+      synthetic.segments = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-l") && i + 1 < argc) {
+      synthetic.line_frequency = atof(argv[++i]);
+    } else if(!strcmp(argv[i], "-s") && i + 1 < argc) {
+      synthetic.seed = strtoull(argv[++i], NULL, 10);
+    } else if(!strcmp(argv[i], "-64")) {
+      synthetic.rf64 = 1;
+    } else if(!strcmp(argv[i], "-e")) {
+      synthetic.sidecars = 1;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if(i + 1 != argc) {
+    usage();
+    return 1;
+  }
+
+  libeep_init();
+  status = libeep_write_synthetic(argv[i], &synthetic);
+  libeep_exit();
+  if(status) {
+    fprintf(stderr, "libeep_synth: cannot write %s\n", argv[i]);
+  }
+  return status != 0;
+}
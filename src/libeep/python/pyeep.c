@@ -10,12 +10,6 @@
 #endif
 // libeep
 #include <v4/eep.h>
-// PyMemoryView_FromMemory is part of stable ABI but the
-// flag constants (PyBUF_READ, etc.) are not.
-// https://github.com/python/cpython/issues/98680
-#ifndef PyBUF_READ
-#define PyBUF_READ 0x100
-#endif
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
@@ -29,14 +23,82 @@ pyeep_get_version(PyObject* self, PyObject* args) {
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
+pyeep_set_memory_accounting(PyObject* self, PyObject* args) {
+  int enable;
+
+  if(!PyArg_ParseTuple(args, "i", & enable)) {
+    return NULL;
+  }
+
+  libeep_set_memory_accounting(enable);
+  Py_RETURN_NONE;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_reset_memory_stats(PyObject* self, PyObject* args) {
+  if(!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+
+  libeep_reset_memory_stats();
+  Py_RETURN_NONE;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_memory_stats(PyObject* self, PyObject* args) {
+  struct libeep_memory_stats * statv = NULL;
+  int statc = 0;
+  int n, i;
+  PyObject * result;
+  PyObject * item;
+
+  if(!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+
+  // other threads may add entries in between, retry until they fit
+  while((n = libeep_get_memory_stats(statv, statc)) > statc) {
+    PyMem_Free(statv);
+    statc = n;
+    statv = (struct libeep_memory_stats *)PyMem_Malloc(sizeof(struct libeep_memory_stats) * statc);
+    if(statv == NULL) {
+      return PyErr_NoMemory();
+    }
+  }
+
+  result = PyList_New(n < 0 ? 0 : n);
+  for(i = 0; result != NULL && i < n; ++i) {
+    item = Py_BuildValue("ziKKKKKK",
+      statv[i].tag, statv[i].handle, statv[i].live_bytes, statv[i].peak_bytes,
+      statv[i].live_blocks, statv[i].allocations, statv[i].reallocations, statv[i].frees);
+    if(item == NULL) {
+      Py_CLEAR(result);
+      break;
+    }
+    PyList_SetItem(result, i, item);
+  }
+  PyMem_Free(statv);
+  return result;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
 pyeep_read(PyObject* self, PyObject* args) {
-  char * filename;
+  char      * filename;
+  cntfile_t   handle;
 
   if(!PyArg_ParseTuple(args, "s", & filename)) {
     return NULL;
   }
 
-  return Py_BuildValue("i", libeep_read_with_external_triggers(filename));
+  // opening decodes the first epoch and parses the trigger files
+  Py_BEGIN_ALLOW_THREADS
+  handle = libeep_read_with_external_triggers(filename);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", handle);
 }
 ///////////////////////////////////////////////////////////////////////////////
 static
@@ -46,12 +108,17 @@ pyeep_write_cnt(PyObject* self, PyObject* args) {
   int          rate;
   chaninfo_t   channel_info_handle;
   int          rf64;
+  int          epoch_length = 0;
 
-  if(!PyArg_ParseTuple(args, "siii", & filename, & rate, & channel_info_handle, & rf64)) {
+  if(!PyArg_ParseTuple(args, "siii|i", & filename, & rate, & channel_info_handle, & rf64, & epoch_length)) {
     return NULL;
   }
 
-  return Py_BuildValue("i", libeep_write_cnt(filename, rate, channel_info_handle, rf64));
+  if(epoch_length == 0) {
+    epoch_length = rate;
+  }
+
+  return Py_BuildValue("i", libeep_write_cnt_with_epoch_length(filename, rate, channel_info_handle, rf64, epoch_length));
 }
 ///////////////////////////////////////////////////////////////////////////////
 static
@@ -63,7 +130,10 @@ pyeep_close(PyObject* self, PyObject* args) {
     return NULL;
   }
 
+  // flushes the last epoch and the file tables when writing
+  Py_BEGIN_ALLOW_THREADS
   libeep_close(handle);
+  Py_END_ALLOW_THREADS
 
   return Py_BuildValue("");
 }
@@ -171,6 +241,60 @@ pyeep_get_channel_reference(PyObject* self, PyObject* args) {
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
+pyeep_get_channel_scale(PyObject* self, PyObject* args) {
+  int handle;
+  int index;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & index)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("d", (double)libeep_get_channel_scale(handle, index));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_channels(PyObject* self, PyObject* args) {
+  int                     handle;
+  int                     channel_count;
+  int                     c;
+  struct libeep_channel * channelv;
+  PyObject              * result;
+  PyObject              * item;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  channel_count = libeep_get_channels(handle, NULL, 0);
+  if(channel_count < 0) {
+    Py_RETURN_NONE;
+  }
+  channelv = (struct libeep_channel *)PyMem_Malloc(sizeof(struct libeep_channel) * (channel_count ? channel_count : 1));
+  if(channelv == NULL) {
+    return PyErr_NoMemory();
+  }
+  libeep_get_channels(handle, channelv, channel_count);
+
+  // one (label, unit, reference, status, type, scale) tuple per channel, y
+  // gives None for the strings that are not set
+  result = PyList_New(channel_count);
+  for(c = 0; result != NULL && c < channel_count; ++c) {
+    item = Py_BuildValue("yyyyyd",
+      channelv[c].label, channelv[c].unit, channelv[c].reference,
+      channelv[c].status, channelv[c].type, (double)channelv[c].scale);
+    if(item == NULL) {
+      Py_CLEAR(result);
+      break;
+    }
+    PyList_SetItem(result, c, item);
+  }
+  PyMem_Free(channelv);
+  return result;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
 pyeep_get_sample_frequency(PyObject* self, PyObject* args) {
   int handle;
 
@@ -195,18 +319,35 @@ pyeep_get_sample_count(PyObject* self, PyObject* args) {
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
+pyeep_get_epoch_length(PyObject* self, PyObject* args) {
+  int handle;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_get_epoch_length(handle));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
 pyeep_get_samples(PyObject* self, PyObject* args) {
   int handle;
   int fro;
   int to;
 
   Py_ssize_t i;
+  float * libeep_sample_data;
 
   if(!PyArg_ParseTuple(args, "iii", & handle, & fro, & to)) {
     return NULL;
   }
 
-  float * libeep_sample_data = libeep_get_samples(handle, fro, to);
+  // decode into an owned buffer: once the GIL is released another thread may
+  // read from the same handle and reuse its borrowed scratch memory
+  Py_BEGIN_ALLOW_THREADS
+  libeep_sample_data = libeep_get_samples(handle, fro, to);
+  Py_END_ALLOW_THREADS
   if(libeep_sample_data == NULL) {
     return NULL;
   }
@@ -214,12 +355,14 @@ pyeep_get_samples(PyObject* self, PyObject* args) {
   Py_ssize_t array_len = (to - fro) * libeep_get_channel_count(handle);
   PyObject * python_list = PyList_New(array_len);
   if(!python_list) {
+    libeep_free_samples(libeep_sample_data);
     return NULL;
   }
   for(i = 0; i < array_len; i++) {
     PyObject * num = PyFloat_FromDouble(libeep_sample_data[i]);
     if (!num) {
         Py_DECREF(python_list);
+        libeep_free_samples(libeep_sample_data);
         return NULL;
     }
     PyList_SetItem(python_list, i, num);   // reference to num stolen
@@ -234,20 +377,128 @@ pyeep_get_samples_as_buffer(PyObject* self, PyObject* args) {
   int handle;
   int fro;
   int to;
+  int channel_count;
+  int status;
+  PyObject * bytes;
 
   if(!PyArg_ParseTuple(args, "iii", & handle, & fro, & to)) {
     return NULL;
   }
 
-  float * libeep_sample_data = libeep_get_samples(handle, fro, to);
-  if(libeep_sample_data == NULL) {
+  channel_count = libeep_get_channel_count(handle);
+  if(channel_count < 0 || fro < 0 || to < fro) {
+    Py_RETURN_NONE;
+  }
+
+  // decode straight into a bytes object, its memory is released with it
+  bytes = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(to - fro) * channel_count * sizeof(float));
+  if(bytes == NULL) {
     return NULL;
   }
+  float * libeep_sample_data = (float *)PyBytes_AsString(bytes);
+
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_get_samples_into(handle, fro, to, libeep_sample_data);
+  Py_END_ALLOW_THREADS
+  if(status) {
+    Py_DECREF(bytes);
+    Py_RETURN_NONE;
+  }
 
-  Py_ssize_t array_len = (to - fro) * libeep_get_channel_count(handle);
+  return bytes;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_samples_into(PyObject* self, PyObject* args) {
+  int                handle;
+  int                fro;
+  int                to;
+  unsigned long long address;
+  Py_ssize_t         size;
+  int                channel_count;
+  int                status;
+
+  // the buffer is passed by address, the limited API of Python 3.9 has no
+  // access to the buffer protocol; the caller keeps it alive and writable
+  if(!PyArg_ParseTuple(args, "iiiKn", & handle, & fro, & to, & address, & size)) {
+    return NULL;
+  }
+
+  channel_count = libeep_get_channel_count(handle);
+  if(channel_count < 0 || fro < 0 || to < fro || address == 0
+     || size < (Py_ssize_t)(to - fro) * channel_count * (Py_ssize_t)sizeof(float)) {
+    return Py_BuildValue("i", -1);
+  }
 
-  PyObject * buf = PyMemoryView_FromMemory(libeep_sample_data, array_len * sizeof(*libeep_sample_data), PyBUF_READ);
-  return buf;
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_get_samples_into(handle, fro, to, (float *)(uintptr_t)address);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_raw_samples_into(PyObject* self, PyObject* args) {
+  int                handle;
+  int                fro;
+  int                to;
+  unsigned long long address;
+  Py_ssize_t         size;
+  int                channel_count;
+  int                status;
+
+  // same as get_samples_into for the unscaled int32 samples
+  if(!PyArg_ParseTuple(args, "iiiKn", & handle, & fro, & to, & address, & size)) {
+    return NULL;
+  }
+
+  channel_count = libeep_get_channel_count(handle);
+  if(channel_count < 0 || fro < 0 || to < fro || address == 0
+     || size < (Py_ssize_t)(to - fro) * channel_count * (Py_ssize_t)sizeof(int32_t)) {
+    return Py_BuildValue("i", -1);
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_get_raw_samples_into(handle, fro, to, (int32_t *)(uintptr_t)address);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_samples_picked(PyObject* self, PyObject* args) {
+  int                handle;
+  int                fro;
+  int                to;
+  unsigned long long picks;
+  int                pick_count;
+  unsigned long long scales;
+  unsigned long long address;
+  Py_ssize_t         size;
+  Py_ssize_t         stride;
+  int                status;
+
+  // picks (int), scales (double) and out (double) are passed by address, the
+  // caller keeps them alive and out writable over all its rows
+  if(!PyArg_ParseTuple(args, "iiiKiKKnn", & handle, & fro, & to, & picks, & pick_count, & scales, & address, & size, & stride)) {
+    return NULL;
+  }
+
+  if(fro < 0 || to < fro || pick_count < 0 || stride < (Py_ssize_t)(to - fro)
+     || (pick_count && (picks == 0 || address == 0
+         || size < ((Py_ssize_t)(pick_count - 1) * stride + (to - fro)) * (Py_ssize_t)sizeof(double)))) {
+    return Py_BuildValue("i", -1);
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_get_samples_picked(handle, fro, to, (const int *)(uintptr_t)picks, pick_count,
+                                     (const double *)(uintptr_t)scales, (double *)(uintptr_t)address, (long)stride);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
 }
 ///////////////////////////////////////////////////////////////////////////////
 static
@@ -268,7 +519,10 @@ pyeep_add_samples(PyObject* self, PyObject* args) {
   for(i=0;i<n;++i) {
     local_data[i]=PyFloat_AsDouble(PyList_GetItem(obj, i));
   }
+  // the samples are copied, encoding and writing do not need the GIL
+  Py_BEGIN_ALLOW_THREADS
   libeep_add_samples(handle, local_data, n / channel_count);
+  Py_END_ALLOW_THREADS
   free(local_data);
 
   return Py_BuildValue("");
@@ -276,6 +530,246 @@ pyeep_add_samples(PyObject* self, PyObject* args) {
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
+pyeep_add_samples_buffer(PyObject* self, PyObject* args) {
+  int                handle;
+  unsigned long long address;
+  int                sample_count;
+  Py_ssize_t         channel_stride;
+  Py_ssize_t         sample_stride;
+  int                kind;
+  int                status;
+
+  // the samples are passed by address with their strides in items, the
+  // limited API of Python 3.9 has no access to the buffer protocol; the caller
+  // keeps them alive and unchanged
+  if(!PyArg_ParseTuple(args, "iKinnC", & handle, & address, & sample_count, & channel_stride, & sample_stride, & kind)) {
+    return NULL;
+  }
+
+  if((address == 0 && sample_count > 0) || sample_count < 0) {
+    return Py_BuildValue("i", -1);
+  }
+
+  // interleaving, encoding and writing do not need the GIL
+  Py_BEGIN_ALLOW_THREADS
+  switch(kind) {
+    case 'f': status = libeep_add_samples_strided(handle, (const float *)(uintptr_t)address, sample_count, channel_stride, sample_stride); break;
+    case 'd': status = libeep_add_samples_double_strided(handle, (const double *)(uintptr_t)address, sample_count, channel_stride, sample_stride); break;
+    case 'i': status = libeep_add_raw_samples_strided(handle, (const int32_t *)(uintptr_t)address, sample_count, channel_stride, sample_stride); break;
+    default: status = -1;
+  }
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_write_buffering(PyObject* self, PyObject* args) {
+  int       handle;
+  long long buffer_size;
+  long long prealloc_size;
+
+  if(!PyArg_ParseTuple(args, "iLL", & handle, & buffer_size, & prealloc_size)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_write_buffering(handle, buffer_size, prealloc_size));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_channel_order_optimization(PyObject* self, PyObject* args) {
+  int handle;
+  int enable;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & enable)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_channel_order_optimization(handle, enable));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_compression_level(PyObject* self, PyObject* args) {
+  int handle;
+  int level;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & level)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_compression_level(handle, level));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_adaptive_coding(PyObject* self, PyObject* args) {
+  int handle;
+  int enable;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & enable)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_adaptive_coding(handle, enable));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_lpc_prediction(PyObject* self, PyObject* args) {
+  int handle;
+  int enable;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & enable)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_lpc_prediction(handle, enable));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_compression_stats(PyObject* self, PyObject* args) {
+  int handle;
+  int enable;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & enable)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_compression_stats(handle, enable));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_reset_compression_stats(PyObject* self, PyObject* args) {
+  int handle;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_reset_compression_stats(handle));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_compression_stats(PyObject* self, PyObject* args) {
+  int handle;
+  int channel;
+  uint64_t * m;
+  struct libeep_compression_stats cs;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & channel)) {
+    return NULL;
+  }
+
+  if(libeep_get_compression_stats(handle, channel, & cs)) {
+    Py_RETURN_NONE;
+  }
+
+  m = cs.methods;
+  return Py_BuildValue("KKK(KKKKKKKKKKKKKKKK)KKiiK",
+    cs.blocks, cs.samples, cs.bytes,
+    m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7],
+    m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15],
+    cs.nbits, cs.nexcbits, cs.nbits_max, cs.nexcbits_max, cs.exceptions);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_scan_compression_stats(PyObject* self, PyObject* args) {
+  int handle;
+  long epoch;
+  int status;
+
+  if(!PyArg_ParseTuple(args, "il", & handle, & epoch)) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_scan_compression_stats(handle, epoch);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_stats(PyObject* self, PyObject* args) {
+  int handle;
+  int bin;
+  struct libeep_stats st;
+  PyObject * read_hist;
+  PyObject * decode_hist;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  if(libeep_get_stats(handle, & st)) {
+    Py_RETURN_NONE;
+  }
+
+  read_hist = PyTuple_New(LIBEEP_STATS_BINS);
+  decode_hist = PyTuple_New(LIBEEP_STATS_BINS);
+  if(read_hist == NULL || decode_hist == NULL) {
+    Py_XDECREF(read_hist);
+    Py_XDECREF(decode_hist);
+    return NULL;
+  }
+  for(bin = 0; bin < LIBEEP_STATS_BINS; ++bin) {
+    PyTuple_SetItem(read_hist, bin, PyLong_FromUnsignedLongLong(st.read_hist[bin]));
+    PyTuple_SetItem(decode_hist, bin, PyLong_FromUnsignedLongLong(st.decode_hist[bin]));
+  }
+  // N steals the histogram references
+  return Py_BuildValue("KKKKKKKNN",
+    st.bytes_read, st.epochs_decoded, st.seeks, st.cache_hits,
+    st.read_ns, st.decode_ns, st.scale_ns, read_hist, decode_hist);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_reset_stats(PyObject* self, PyObject* args) {
+  int handle;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_reset_stats(handle));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_trace(PyObject* self, PyObject* args) {
+  int handle;
+  int max_events;
+
+  if(!PyArg_ParseTuple(args, "ii", & handle, & max_events)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_set_trace(handle, max_events));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_write_trace(PyObject* self, PyObject* args) {
+  int handle;
+  char * filename;
+
+  if(!PyArg_ParseTuple(args, "is", & handle, & filename)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_write_trace(handle, filename));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
 pyeep_get_trigger_count(PyObject* self, PyObject* args) {
   int handle;
 
@@ -304,6 +798,176 @@ pyeep_get_trigger(PyObject* self, PyObject* args) {
   return Py_BuildValue("siisss", trigger, sample, te.duration_in_samples, te.condition, te.description, te.impedances);
 }
 ///////////////////////////////////////////////////////////////////////////////
+/* str of value, NULL giving None, shared by all the triggers with this value */
+static
+PyObject *
+_pyeep_interned_string(PyObject * strings, const char * value) {
+  PyObject * key;
+  PyObject * item;
+
+  if(value == NULL) {
+    Py_RETURN_NONE;
+  }
+  key = PyBytes_FromString(value);
+  if(key == NULL) {
+    return NULL;
+  }
+  item = PyDict_GetItem(strings, key);
+  if(item != NULL) {
+    Py_INCREF(item);
+  } else {
+    item = PyUnicode_FromString(value);
+    if(item != NULL && PyDict_SetItem(strings, key, item)) {
+      Py_CLEAR(item);
+    }
+  }
+  Py_DECREF(key);
+  return item;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* list of the str of each value, see _pyeep_interned_string() */
+static
+PyObject *
+_pyeep_string_column(PyObject * strings, const char ** values, int count) {
+  PyObject * column;
+  PyObject * item;
+  int        i;
+
+  column = PyList_New(count);
+  for(i = 0; column != NULL && i < count; ++i) {
+    item = _pyeep_interned_string(strings, values[i]);
+    if(item == NULL) {
+      Py_CLEAR(column);
+      break;
+    }
+    PyList_SetItem(column, i, item);
+  }
+  return column;
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_get_triggers(PyObject* self, PyObject* args) {
+  int                           handle;
+  int                           count;
+  int                           impedance_count = 0;
+  int                           value_count = 0;
+  int                           i, k, n;
+  struct libeep_trigger_columns columns;
+  const char                 ** strv;
+  int32_t                     * impedance_index;
+  int32_t                     * impedance_sizes;
+  double                      * row;
+  PyObject                    * samples;
+  PyObject                    * durations;
+  PyObject                    * types;
+  PyObject                    * codes;
+  PyObject                    * index = NULL;
+  PyObject                    * sizes = NULL;
+  PyObject                    * impedances = NULL;
+  PyObject                    * strings = NULL;
+  PyObject                    * labels = NULL;
+  PyObject                    * conditions = NULL;
+  PyObject                    * descriptions = NULL;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  count = libeep_get_trigger_count(handle);
+  if(count < 0) {
+    Py_RETURN_NONE;
+  }
+  // the numeric columns are returned as bytes for numpy.frombuffer
+  samples = PyBytes_FromStringAndSize(NULL, sizeof(uint64_t) * count);
+  durations = PyBytes_FromStringAndSize(NULL, sizeof(uint64_t) * count);
+  types = PyBytes_FromStringAndSize(NULL, sizeof(int32_t) * count);
+  codes = PyBytes_FromStringAndSize(NULL, sizeof(int32_t) * count);
+  strv = (const char **)PyMem_Malloc(sizeof(const char *) * 4 * (count ? count : 1));
+  if(strv == NULL) {
+    PyErr_NoMemory();
+  }
+  if(samples == NULL || durations == NULL || types == NULL || codes == NULL || strv == NULL) {
+    goto fail;
+  }
+  columns.samples = (uint64_t *)PyBytes_AsString(samples);
+  columns.durations = (uint64_t *)PyBytes_AsString(durations);
+  columns.types = (int32_t *)PyBytes_AsString(types);
+  columns.codes = (int32_t *)PyBytes_AsString(codes);
+  columns.labels = strv;
+  columns.conditions = strv + count;
+  columns.descriptions = strv + 2 * count;
+  columns.impedances = strv + 3 * count;
+  libeep_get_triggers(handle, & columns, count);
+
+  // one row per trigger with impedances, as wide as the longest of them
+  for(i = 0; i < count; ++i) {
+    if(columns.impedances[i] != NULL) {
+      n = libeep_parse_impedances(columns.impedances[i], NULL, 0);
+      value_count = n > value_count ? n : value_count;
+      ++impedance_count;
+    }
+  }
+  index = PyBytes_FromStringAndSize(NULL, sizeof(int32_t) * impedance_count);
+  sizes = PyBytes_FromStringAndSize(NULL, sizeof(int32_t) * impedance_count);
+  impedances = PyBytes_FromStringAndSize(NULL, sizeof(double) * impedance_count * value_count);
+  if(index == NULL || sizes == NULL || impedances == NULL) {
+    goto fail;
+  }
+  impedance_index = (int32_t *)PyBytes_AsString(index);
+  impedance_sizes = (int32_t *)PyBytes_AsString(sizes);
+  row = (double *)PyBytes_AsString(impedances);
+  Py_BEGIN_ALLOW_THREADS
+  for(i = 0, k = 0; i < count; ++i) {
+    if(columns.impedances[i] == NULL) {
+      continue;
+    }
+    // missing values and rows that do not parse are NaN, the size tells them
+    // apart from parsed NaN and is -1 for the latter
+    n = libeep_parse_impedances(columns.impedances[i], row, value_count);
+    impedance_index[k] = i;
+    impedance_sizes[k++] = n;
+    for(n = n < 0 ? 0 : n; n < value_count; ++n) {
+      row[n] = NAN;
+    }
+    row += value_count;
+  }
+  Py_END_ALLOW_THREADS
+
+  strings = PyDict_New();
+  if(strings == NULL) {
+    goto fail;
+  }
+  labels = _pyeep_string_column(strings, columns.labels, count);
+  conditions = _pyeep_string_column(strings, columns.conditions, count);
+  descriptions = _pyeep_string_column(strings, columns.descriptions, count);
+  Py_CLEAR(strings);
+  PyMem_Free(strv);
+  strv = NULL;
+  if(labels == NULL || conditions == NULL || descriptions == NULL) {
+    goto fail;
+  }
+
+  // N steals the references
+  return Py_BuildValue("NNNNNNNNNNi", samples, durations, types, codes,
+    labels, conditions, descriptions, index, sizes, impedances, value_count);
+
+fail:
+  PyMem_Free(strv);
+  Py_XDECREF(samples);
+  Py_XDECREF(durations);
+  Py_XDECREF(types);
+  Py_XDECREF(codes);
+  Py_XDECREF(index);
+  Py_XDECREF(sizes);
+  Py_XDECREF(impedances);
+  Py_XDECREF(strings);
+  Py_XDECREF(labels);
+  Py_XDECREF(conditions);
+  Py_XDECREF(descriptions);
+  return NULL;
+}
+///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
 pyeep_get_start_time(PyObject* self, PyObject* args) {
@@ -462,6 +1126,233 @@ pyeep_get_date_of_birth(PyObject* self, PyObject* args) {
 ///////////////////////////////////////////////////////////////////////////////
 static
 PyObject *
+pyeep_get_recording(PyObject* self, PyObject* args) {
+  int                     handle;
+  struct libeep_recording rec;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  if(libeep_get_recording(handle, & rec)) {
+    Py_RETURN_NONE;
+  }
+
+  return Py_BuildValue("LddyyyyyyyyyyyyyCCiii",
+    (long long)rec.start_time, rec.start_date, rec.start_fraction,
+    rec.hospital, rec.test_name, rec.test_serial, rec.physician, rec.technician,
+    rec.machine_make, rec.machine_model, rec.machine_serial_number,
+    rec.patient_name, rec.patient_id, rec.patient_address, rec.patient_phone, rec.comment,
+    (int)rec.patient_sex, (int)rec.patient_handedness,
+    rec.date_of_birth_year, rec.date_of_birth_month, rec.date_of_birth_day);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_add_trigger(PyObject* self, PyObject* args) {
+  int                handle;
+  unsigned long long sample;
+  char             * code;
+
+  if(!PyArg_ParseTuple(args, "iKs", & handle, & sample, & code)) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_add_trigger(handle, sample, code));
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_add_triggers(PyObject* self, PyObject* args) {
+  int          handle;
+  PyObject   * samples;
+  PyObject   * codes;
+  PyObject   * code;
+  Py_ssize_t   i;
+  Py_ssize_t   n;
+  uint64_t     sample;
+  int          status = 0;
+
+  if(!PyArg_ParseTuple(args, "iO!O!", & handle, & PyList_Type, & samples, & PyList_Type, & codes)) {
+    return NULL;
+  }
+
+  n = PyList_Size(samples);
+  if(PyList_Size(codes) != n) {
+    return Py_BuildValue("i", -1);
+  }
+  for(i = 0; i < n && status == 0; ++i) {
+    sample = PyLong_AsUnsignedLongLong(PyList_GetItem(samples, i));
+    if(sample == (uint64_t)-1 && PyErr_Occurred()) {
+      return NULL;
+    }
+    code = PyUnicode_AsUTF8String(PyList_GetItem(codes, i));
+    if(code == NULL) {
+      return NULL;
+    }
+    // the number of triggers added, 0 for a duplicate, or -1
+    if(libeep_add_trigger(handle, sample, PyBytes_AsString(code)) == -1) {
+      status = -1;
+    }
+    Py_DECREF(code);
+  }
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_create_recinfo(PyObject* self, PyObject* args) {
+  if(!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+
+  return Py_BuildValue("i", libeep_create_recinfo());
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_close_recinfo(PyObject* self, PyObject* args) {
+  int handle;
+
+  if(!PyArg_ParseTuple(args, "i", & handle)) {
+    return NULL;
+  }
+
+  libeep_close_recinfo(handle);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_add_recording_info(PyObject* self, PyObject* args) {
+  int cnt_handle;
+  int recinfo_handle;
+
+  if(!PyArg_ParseTuple(args, "ii", & cnt_handle, & recinfo_handle)) {
+    return NULL;
+  }
+
+  libeep_add_recording_info(cnt_handle, recinfo_handle);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_start_date_and_fraction(PyObject* self, PyObject* args) {
+  int    handle;
+  double start_date;
+  double start_fraction;
+
+  if(!PyArg_ParseTuple(args, "idd", & handle, & start_date, & start_fraction)) {
+    return NULL;
+  }
+
+  libeep_set_start_date_and_fraction(handle, start_date, start_fraction);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+/* shared by the recording info string setters, the value is given as bytes */
+static
+PyObject *
+_pyeep_set_recinfo_string(PyObject* args, void (*setter)(recinfo_t, const char *)) {
+  int    handle;
+  char * value;
+
+  if(!PyArg_ParseTuple(args, "iy", & handle, & value)) {
+    return NULL;
+  }
+
+  setter(handle, value);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_hospital(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_hospital);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_physician(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_physician);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_technician(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_technician);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_machine_make(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_machine_make);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_machine_model(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_machine_model);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_machine_serial_number(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_machine_serial_number);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_patient_name(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_patient_name);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_patient_id(PyObject* self, PyObject* args) {
+  return _pyeep_set_recinfo_string(args, libeep_set_patient_id);
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_patient_sex(PyObject* self, PyObject* args) {
+  int handle;
+  int value;
+
+  if(!PyArg_ParseTuple(args, "iC", & handle, & value)) {
+    return NULL;
+  }
+
+  libeep_set_patient_sex(handle, (char)value);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_set_date_of_birth(PyObject* self, PyObject* args) {
+  int handle;
+  int year;
+  int month;
+  int day;
+
+  if(!PyArg_ParseTuple(args, "iiii", & handle, & year, & month, & day)) {
+    return NULL;
+  }
+
+  libeep_set_date_of_birth(handle, year, month, day);
+
+  return Py_BuildValue("");
+}
+///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
 pyeep_create_channel_info(PyObject* self, PyObject* args) {
   if(!PyArg_ParseTuple(args, "")) {
     return NULL;
@@ -501,8 +1392,31 @@ pyeep_add_channel(PyObject* self, PyObject* args) {
   return Py_BuildValue("");
 }
 ///////////////////////////////////////////////////////////////////////////////
+static
+PyObject *
+pyeep_write_synthetic(PyObject* self, PyObject* args) {
+  char                  * filename;
+  struct libeep_synthetic synthetic;
+  unsigned long long      seed;
+  int                     status;
+
+  if(!PyArg_ParseTuple(args, "siiddiiidK", & filename, & synthetic.channel_count, & synthetic.rate, & synthetic.duration, & synthetic.trigger_rate, & synthetic.segments, & synthetic.rf64, & synthetic.sidecars, & synthetic.line_frequency, & seed)) {
+    return NULL;
+  }
+  synthetic.seed = seed;
+
+  Py_BEGIN_ALLOW_THREADS
+  status = libeep_write_synthetic(filename, &synthetic);
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("i", status);
+}
+///////////////////////////////////////////////////////////////////////////////
 static PyMethodDef methods[] = {
   {"get_version",              pyeep_get_version,              METH_VARARGS, "get libeep version"},
+  {"set_memory_accounting",    pyeep_set_memory_accounting,    METH_VARARGS, "account allocations per tag and handle"},
+  {"reset_memory_stats",       pyeep_reset_memory_stats,       METH_VARARGS, "reset memory peaks and counts"},
+  {"get_memory_stats",         pyeep_get_memory_stats,         METH_VARARGS, "get memory accounting statistics"},
   {"read",                     pyeep_read,                     METH_VARARGS, "open libeep file for reading"},
   {"write_cnt",                pyeep_write_cnt,                METH_VARARGS, "open libeep cnt file for writing"},
   {"close",                    pyeep_close,                    METH_VARARGS, "close handle"},
@@ -512,42 +1426,62 @@ static PyMethodDef methods[] = {
   {"get_channel_type",         pyeep_get_channel_type,         METH_VARARGS, "get channel type"},
   {"get_channel_unit",         pyeep_get_channel_unit,         METH_VARARGS, "get channel unit"},
   {"get_channel_reference",    pyeep_get_channel_reference,    METH_VARARGS, "get channel reference"},
-// float libeep_get_channel_scale(cntfile_t handle, int index);
+  {"get_channel_scale",        pyeep_get_channel_scale,        METH_VARARGS, "get channel scale"},
+  {"get_channels",             pyeep_get_channels,             METH_VARARGS, "get the information of all the channels"},
 // int libeep_get_channel_index(cntfile_t handle, const char *label);
   {"get_sample_frequency",     pyeep_get_sample_frequency,     METH_VARARGS, "get sample frequency"},
   {"get_sample_count",         pyeep_get_sample_count,         METH_VARARGS, "get sample count"},
+  {"get_epoch_length",         pyeep_get_epoch_length,         METH_VARARGS, "get compression epoch length"},
   {"get_samples",              pyeep_get_samples,              METH_VARARGS, "get samples"},
   {"add_samples",              pyeep_add_samples,              METH_VARARGS, "add samples"},
-  {"get_samples_as_buffer",    pyeep_get_samples_as_buffer,    METH_VARARGS, "get samples as memoryview"},
+  {"add_samples_buffer",       pyeep_add_samples_buffer,       METH_VARARGS, "add float32, float64 or int32 samples from memory"},
+  {"get_samples_as_buffer",    pyeep_get_samples_as_buffer,    METH_VARARGS, "get samples as bytes"},
+  {"get_samples_into",         pyeep_get_samples_into,         METH_VARARGS, "get samples into a buffer"},
+  {"get_samples_picked",       pyeep_get_samples_picked,       METH_VARARGS, "get samples of some channels into a double buffer"},
+  {"get_raw_samples_into",     pyeep_get_raw_samples_into,     METH_VARARGS, "get unscaled int32 samples into a buffer"},
+  {"set_write_buffering",      pyeep_set_write_buffering,      METH_VARARGS, "set write buffer and preallocation size"},
+  {"set_channel_order_optimization", pyeep_set_channel_order_optimization, METH_VARARGS, "optimize channel sequence for compression"},
+  {"set_compression_level",    pyeep_set_compression_level,    METH_VARARGS, "set compression encoder effort"},
+  {"set_adaptive_coding",      pyeep_set_adaptive_coding,      METH_VARARGS, "use adaptive residual coding"},
+  {"set_lpc_prediction",       pyeep_set_lpc_prediction,       METH_VARARGS, "try linear prediction when compressing"},
+  {"set_compression_stats",    pyeep_set_compression_stats,    METH_VARARGS, "collect compression statistics"},
+  {"reset_compression_stats",  pyeep_reset_compression_stats,  METH_VARARGS, "reset compression statistics"},
+  {"get_compression_stats",    pyeep_get_compression_stats,    METH_VARARGS, "get compression statistics of a channel"},
+  {"scan_compression_stats",   pyeep_scan_compression_stats,   METH_VARARGS, "add an epoch to the compression statistics"},
+  {"get_stats",                pyeep_get_stats,                METH_VARARGS, "get read performance counters"},
+  {"reset_stats",              pyeep_reset_stats,              METH_VARARGS, "reset read performance counters"},
+  {"set_trace",                pyeep_set_trace,                METH_VARARGS, "record epoch read and decode spans"},
+  {"write_trace",              pyeep_write_trace,              METH_VARARGS, "write recorded spans as Chrome trace JSON"},
 // void libeep_add_raw_samples(cntfile_t handle, const int32_t *data, int n);
 // int32_t * libeep_get_raw_samples(cntfile_t handle, long from, long to);
 // void libeep_free_raw_samples(int32_t *data);
-// recinfo_t libeep_create_recinfo();
-// void libeep_add_recording_info(cntfile_t cnt_handle, recinfo_t recinfo_handle);
+  {"create_recinfo",           pyeep_create_recinfo,           METH_VARARGS, "create recording info handle"},
+  {"close_recinfo",            pyeep_close_recinfo,            METH_VARARGS, "close recording info handle"},
+  {"add_recording_info",       pyeep_add_recording_info,       METH_VARARGS, "add recording info to cnt handle"},
   {"get_start_time",           pyeep_get_start_time,           METH_VARARGS, "get start time in UNIX format"},
   {"get_start_date_and_fraction",     pyeep_get_start_date_and_fraction,    METH_VARARGS, "get start date and fraction in EXCEL format"},
 // void libeep_set_start_time(recinfo_t handle, time_t start_time);
-// void libeep_set_start_date_and_fraction(recinfo_t handle, double start_date, double start_fraction);
+  {"set_start_date_and_fraction",     pyeep_set_start_date_and_fraction,    METH_VARARGS, "set start date and fraction in EXCEL format"},
   {"get_hospital",            pyeep_get_hospital,              METH_VARARGS, "get hospital"},
-// void libeep_set_hospital(recinfo_t handle, const char *value);
+  {"set_hospital",             pyeep_set_hospital,              METH_VARARGS, "set hospital"},
 // const char *libeep_get_test_name(cntfile_t handle);
 // void libeep_set_test_name(recinfo_t handle, const char *value);
 // const char *libeep_get_test_serial(cntfile_t handle);
 // void libeep_set_test_serial(recinfo_t handle, const char *value);
 // const char *libeep_get_physician(cntfile_t handle);
-// void libeep_set_physician(recinfo_t handle, const char *value);
+  {"set_physician",            pyeep_set_physician,             METH_VARARGS, "set physician"},
 // const char *libeep_get_technician(cntfile_t handle);
-// void libeep_set_technician(recinfo_t handle, const char *value);
+  {"set_technician",           pyeep_set_technician,            METH_VARARGS, "set technician"},
   {"get_machine_make",          pyeep_get_machine_make,          METH_VARARGS, "get machine make"},
-// void libeep_set_machine_make(recinfo_t handle, const char *value);
+  {"set_machine_make",         pyeep_set_machine_make,          METH_VARARGS, "set machine make"},
   {"get_machine_model",         pyeep_get_machine_model,         METH_VARARGS, "get machine model"},
-// void libeep_set_machine_model(recinfo_t handle, const char *value);
+  {"set_machine_model",        pyeep_set_machine_model,         METH_VARARGS, "set machine model"},
   {"get_machine_serial_number", pyeep_get_machine_serial_number, METH_VARARGS, "get machine serial number"},
-// void libeep_set_machine_serial_number(recinfo_t handle, const char *value);
+  {"set_machine_serial_number", pyeep_set_machine_serial_number, METH_VARARGS, "set machine serial number"},
   {"get_patient_name",          pyeep_get_patient_name,          METH_VARARGS, "get patient name"},
-// void libeep_set_patient_name(recinfo_t handle, const char *value);
+  {"set_patient_name",         pyeep_set_patient_name,          METH_VARARGS, "set patient name"},
   {"get_patient_id",            pyeep_get_patient_id,            METH_VARARGS, "get patient ID"},
-// void libeep_set_patient_id(recinfo_t handle, const char *value);
+  {"set_patient_id",           pyeep_set_patient_id,            METH_VARARGS, "set patient ID"},
 // const char *libeep_get_patient_address(cntfile_t handle);
 // void libeep_set_patient_address(recinfo_t handle, const char *value);
 // const char *libeep_get_patient_phone(cntfile_t handle);
@@ -555,14 +1489,17 @@ static PyMethodDef methods[] = {
 // const char *libeep_get_comment(cntfile_t handle);
 // void libeep_set_comment(recinfo_t handle, const char *value);
   {"get_patient_sex",            pyeep_get_patient_sex,            METH_VARARGS, "get patient sex"},
-// void libeep_set_patient_sex(recinfo_t handle, char value);
+  {"set_patient_sex",            pyeep_set_patient_sex,            METH_VARARGS, "set patient sex"},
 // char libeep_get_patient_handedness(cntfile_t handle);
 // void libeep_set_patient_handedness(recinfo_t handle, char value);
   {"get_date_of_birth",          pyeep_get_date_of_birth,          METH_VARARGS, "get date of birth (yy/mm/dd)"},
-// void libeep_set_date_of_birth(recinfo_t handle, int year, int month, int day);
-// int libeep_add_trigger(cntfile_t handle, uint64_t sample, const char *code);
+  {"set_date_of_birth",          pyeep_set_date_of_birth,          METH_VARARGS, "set date of birth (yy/mm/dd)"},
+  {"get_recording",              pyeep_get_recording,              METH_VARARGS, "get all the recording information"},
+  {"add_trigger",              pyeep_add_trigger,              METH_VARARGS, "add trigger"},
+  {"add_triggers",             pyeep_add_triggers,             METH_VARARGS, "add triggers from lists of samples and codes"},
   {"get_trigger_count",        pyeep_get_trigger_count,        METH_VARARGS, "get trigger count"},
   {"get_trigger",              pyeep_get_trigger,              METH_VARARGS, "get triggers"},
+  {"get_triggers",             pyeep_get_triggers,             METH_VARARGS, "get all the triggers as columns"},
 // long libeep_get_zero_offset(cntfile_t handle);
 // const char * libeep_get_condition_label(cntfile_t handle);
 // const char * libeep_get_condition_color(cntfile_t handle);
@@ -571,6 +1508,7 @@ static PyMethodDef methods[] = {
   {"create_channel_info",      pyeep_create_channel_info,      METH_VARARGS, "create channel info handle"},
   {"close_channel_info",       pyeep_close_channel_info,       METH_VARARGS, "close channel info handle"},
   {"add_channel",              pyeep_add_channel,              METH_VARARGS, "add channel to channel info handle"},
+  {"write_synthetic",          pyeep_write_synthetic,          METH_VARARGS, "write a synthetic cnt file"},
   {NULL, NULL, 0, NULL}
 };
 ///////////////////////////////////////////////////////////////////////////////
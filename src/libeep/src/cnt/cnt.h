@@ -40,6 +40,7 @@
 #include <eep/stdint.h>
 #include <eep/eepmisc.h>
 #include <cnt/trg.h>
+#include <cnt/raw3.h>
 #include <eep/val.h>
 
 /*
@@ -412,6 +413,88 @@ void eep_set_comment(eeg_t *cnt, const char *value);
    be usable. Default = off */
 void           eep_set_keep_file_consistent(eeg_t *cnt, int enable);
 
+/* Large-block writing: compressed epochs are collected in an aligned buffer
+   of bufsize bytes and written in one go when it is full. If extent is
+   nonzero, disk space is reserved in steps of extent bytes ahead of the
+   writes; eep_finish_file() trims what was not used. With
+   keep_file_consistent, the file is made consistent at each buffer flush
+   instead of at each epoch. Call after eep_create_file(64) and before the
+   first sample is written. bufsize 0 disables. */
+int            eep_set_write_buffering(eeg_t *cnt, size_t bufsize, uint64_t extent);
+
+/* Let the writer choose the channel sequence used for RAW3 prediction by
+   neighbor from the first epoch, instead of the identity sequence given to
+   eep_prepare_to_write(). The sequence is stored in the chan chunk, so
+   readers need no support for this. Call before the first epoch is
+   complete. */
+int            eep_set_optimize_channel_order(eeg_t *cnt, int enable);
+
+/* RAW3 encoder effort when writing EEG data, one of the RAW3_LEVEL_...
+   values in raw3.h. Lower effort levels trade a little compression for
+   less CPU time; RAW3_LEVEL_EXHAUSTIVE (default) is the reference
+   encoder. Files are readable by every reader at all levels. */
+int            eep_set_compression_level(eeg_t *cnt, int level);
+
+/* Store EEG data in an 'arw3' list instead of 'raw3': channel blocks may
+   then be adaptive Rice coded when that is smaller (RAW3_CODEC_ADAPTIVE
+   in raw3.h). Readers without support for it see no EEG data rather than
+   failing on it. Call before the first epoch is complete. */
+int            eep_set_adaptive_coding(eeg_t *cnt, int enable);
+
+/* Let the RAW3 encoder also try linear predictors of order 3 to 8 per
+   channel block, stored where that is smaller. The file is then stamped
+   with file version 5.0 (cnt_version.h), which older readers refuse.
+   Costs several times the encoder CPU time. Call before the first epoch
+   is complete. */
+int            eep_set_lpc_prediction(eeg_t *cnt, int enable);
+
+/* Store the float channel blocks of AVERAGE, STDDEV and TIMEFREQ data
+   lossless compressed (XOR of successive values, packed without their
+   leading and trailing zero bits) where that is smaller. Applies to the
+   epochs written from now on. The file is then stamped with file version
+   5.0 (cnt_version.h), which older readers refuse. */
+void           eep_set_float_compression(eeg_t *cnt, int enable);
+
+/* RAW3 compression statistics (see raw3_chanstat_t in raw3.h), collected
+   per channel for every EEG epoch compressed or decompressed from now on.
+   Reading the same epoch twice counts it twice, and reading ahead loads
+   the next epoch; use eep_scan_compression_stats() for exact per-epoch
+   figures. eep_get_compression_stats() returns chanc
+   elements indexed by channel, or NULL when collection is disabled. */
+int            eep_set_compression_stats(eeg_t *cnt, int enable);
+const raw3_chanstat_t * eep_get_compression_stats(eeg_t *cnt);
+void           eep_reset_compression_stats(eeg_t *cnt);
+/* decode EEG epoch into the statistics only, the read position and the
+   buffered epoch are not changed */
+int            eep_scan_compression_stats(eeg_t *cnt, uint64_t epoch);
+
+/* Read performance counters, always collected per file. Times are taken
+   with eepio_clock_ns(); the histograms count epochs by the time their
+   read or decode took, bin k holding [2^k, 2^(k+1)) ns. */
+#define CNT_PERF_BINS 32
+typedef struct {
+  uint64_t bytes_read;                 /* stored epoch bytes read                    */
+  uint64_t epochs_decoded;
+  uint64_t seeks;                      /* eep_seek calls on RIFF files               */
+  uint64_t cache_hits;                 /* of these, within the buffered epoch        */
+  uint64_t read_ns;                    /* in riff_seek and riff_read of epochs       */
+  uint64_t decode_ns;                  /* in decompepoch_mux and the float decoders  */
+  uint64_t scale_ns;                   /* scaling to physical units, by the caller   */
+  uint64_t read_hist[CNT_PERF_BINS];
+  uint64_t decode_hist[CNT_PERF_BINS];
+} cnt_perf_t;
+
+/* the counters of a file, to read them or add scale_ns */
+cnt_perf_t   * eep_get_perf(eeg_t *cnt);
+/* zero the counters and drop the recorded spans */
+void           eep_reset_perf(eeg_t *cnt);
+/* record up to maxc read and decode spans of epochs from now on, for
+   eep_write_perf_trace(); 0 stops and discards them */
+int            eep_set_perf_trace(eeg_t *cnt, int maxc);
+/* write the recorded spans as Chrome trace event JSON (chrome://tracing,
+   Perfetto), with thread id tid */
+int            eep_write_perf_trace(eeg_t *cnt, FILE *f, int tid);
+
 int            eep_has_data_of_type(eeg_t *cnt, eep_datatype_e type);
 int            eep_get_epochl(eeg_t *cnt, eep_datatype_e type);
 short*         eep_get_chanseq(eeg_t *cnt, eep_datatype_e type);
@@ -35,6 +35,7 @@
 #include <eep/val.h>
 
 #define FOURCC_raw3 FOURCC('r', 'a', 'w', '3')
+#define FOURCC_arw3 FOURCC('a', 'r', 'w', '3') /* raw3 with adaptive Rice coded blocks */
 #define FOURCC_chan FOURCC('c', 'h', 'a', 'n')
 #define FOURCC_data FOURCC('d', 'a', 't', 'a')
 #define FOURCC_ep   FOURCC('e', 'p', ' ', ' ')
@@ -145,6 +146,25 @@ typedef struct {
 #endif
 } storage_t;
 
+/* Large-block writer state, see eep_set_write_buffering() */
+typedef struct {
+  char     * buf;       /* aligned staging buffer for compressed epochs  */
+  size_t     size;      /* capacity of buf                               */
+  size_t     fill;      /* staged bytes, accounted in ch_data but unwritten */
+  uint64_t   extent;    /* preallocation granularity, 0 = no preallocation */
+  uint64_t   reserved;  /* file size reserved so far                     */
+} cnt_wio_t;
+
+/* Span of an epoch read or decode, see eep_set_perf_trace() */
+typedef enum { CNT_SPAN_READ, CNT_SPAN_DECODE } cnt_span_e;
+typedef struct {
+  cnt_span_e kind;
+  uint64_t   epoch;
+  uint64_t   bytes;     /* stored size of the epoch */
+  uint64_t   start_ns;
+  uint64_t   dur_ns;
+} cnt_span_t;
+
 /* EEG informations; internal access control stuff */
 struct eeg_dummy_t {
   /* common members --------------------------------------- */
@@ -184,6 +204,17 @@ struct eeg_dummy_t {
   /* use members epochc, epochl, buf, bufepoch, readpos */
 
   int keep_consistent;
+  int optimize_chanseq;          /* pick the RAW3 channel sequence from the first epoch */
+  int compression_level;         /* RAW3 encoder effort, RAW3_LEVEL_...                 */
+  int lpc_prediction;            /* write RAW3 linear prediction blocks (version 5.0)   */
+  int float_compression;         /* write COMPR_FLOAT_32 float blocks (version 5.0)     */
+  raw3_chanstat_t *compr_statv;  /* RAW3 statistics per channel, NULL if not collected  */
+  cnt_perf_t perf;               /* read performance counters                           */
+  cnt_span_t *tracev;            /* recorded spans, NULL if not tracing                 */
+  int tracec;
+  int tracemax;
+
+  cnt_wio_t wio;
 };
 
 #endif
@@ -27,13 +27,21 @@
 
  #ifndef CNT_VERSION_H
 
-#define CNTVERSION_MAJOR 4
-#define CNTVERSION_MINOR 1
+#define CNTVERSION_MAJOR 5
+#define CNTVERSION_MINOR 0
+
+/* version written to files which use no 5.0 features */
+#define CNTVERSION_COMPAT_MAJOR 4
+#define CNTVERSION_COMPAT_MINOR 1
 
 /* Versioning information:
    4.0 - introduction of file versioning. We start at 4.0 to avoid confusion
          with existing (implicit) version numbers.
    4.1 - 64-bit chunk sizes for large files
+   5.0 - RAW3 linear prediction blocks (eep_set_lpc_prediction) and
+         compressed float blocks (eep_set_float_compression). Only files
+         written with them are stamped 5.0, so that 4.x readers refuse
+         these and keep reading all others.
 */
 
 #endif /* ifndef CNT_VERSION_H */
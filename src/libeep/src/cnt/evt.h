@@ -97,6 +97,8 @@ void           libeep_evt_delete(libeep_evt_t *);
  * evt io
  ********************************************************************************/
 libeep_evt_t * libeep_evt_read(const char *);
+/* writes every event as an event marker in a version 104 file, returns 0 on success */
+int            libeep_evt_write(const char *, const libeep_evt_t *);
 
 /********************************************************************************
  * print stuff
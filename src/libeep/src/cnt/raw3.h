@@ -42,6 +42,24 @@ typedef struct {
   sraw_t *res;
 } raw3res_t;
 
+/*
+  compression statistics of one channel, accumulated over all epochs
+  compressed or decompressed while attached (see raw3_set_stats)
+*/
+typedef struct {
+  uint64_t blockc;        /* compressed channel blocks seen           */
+  uint64_t samplec;       /* samples in these blocks                  */
+  uint64_t bytes;         /* compressed size of these blocks          */
+  uint64_t methodc[16];   /* blocks per method code (RAW3_COPY etc.),
+                             bit 3 set for the 32 bit variants, 12 for
+                             linear prediction                        */
+  uint64_t nbits;         /* sum of residual bit widths (not copies)  */
+  uint64_t nexcbits;      /* sum of exception bit widths (not copies) */
+  int      nbits_max;     /* largest residual bit width               */
+  int      nexcbits_max;  /* largest exception bit width              */
+  uint64_t excc;          /* residuals stored as exceptions           */
+} raw3_chanstat_t;
+
 typedef struct {
   short chanc;       /* channel sequence */
   short *chanv;
@@ -49,11 +67,57 @@ typedef struct {
   raw3res_t rc[RAW3_METHODC];    /* some working buffers */
   sraw_t    *last;
   sraw_t    *cur;
+  uint64_t  length;  /* samples per block the buffers hold */
+
+  int       level;   /* encoder effort, RAW3_LEVEL_... */
+  int       epochc;  /* epochs compressed at this level */
+  int       *methodv;/* last residual method per channel (RAW3_LEVEL_REUSE) */
+  int       codec;   /* residual coding, RAW3_CODEC_... */
+  int       lpc;     /* try linear prediction blocks (raw3_set_lpc) */
+  sraw_t    *lpcres[2]; /* residuals of the current and the best predictor */
+  char      *lpcout; /* linear prediction block under construction */
+  int       verbose; /* report critical blocks on stderr (raw3_set_verbose) */
+  int       errflags;/* critical blocks decoded, RAW3_ERR_... */
+
+  raw3_chanstat_t *statv; /* optional statistics, indexed by channel */
 } raw3_t;
 
-/* set Verbose on for raw3 error checking (use with care!) */
+/*
+  encoder effort levels, all produce valid RAW3 data for every reader
+    EXHAUSTIVE: try all residual methods on all samples (default, the
+                reference output)
+    SAMPLED:    rank the methods on a subsample, compute only the winner
+    REUSE:      keep each channels method of the previous epochs, all
+                methods are tried again every RAW3_REUSE_EPOCHS epochs
+*/
+#define RAW3_LEVEL_EXHAUSTIVE 0
+#define RAW3_LEVEL_SAMPLED    1
+#define RAW3_LEVEL_REUSE      2
+#define RAW3_REUSE_EPOCHS     16
+
+/*
+  residual coding of the compressed channel blocks
+    FIXED:    fixed width packing with an exception escape (RAW3, readable
+              by every reader)
+    ADAPTIVE: in addition adaptive Rice coding, chosen per channel block
+              when it is smaller; needs a reader which knows these blocks,
+              so it is only stored in the 'arw3' data chunk list
+*/
+#define RAW3_CODEC_FIXED    0
+#define RAW3_CODEC_ADAPTIVE 1
+
+/*
+  critical compression methods seen while decoding, collected per decoder
+    16:   a 16 bit block with 16 bit residuals (nbit coded as zero)
+    COPY: an uncompressed 16 bit block
+*/
+#define RAW3_ERR_16   1
+#define RAW3_ERR_COPY 2
+
+/* set Verbose on for raw3 error checking (use with care!), this is the
+   default of the decoders created afterwards */
 void raw3_setVerbose(int onoff);
-/* for each epoch, the ERR_FLAG_EPOCH can be set */
+/* for each epoch, the ERR_FLAG_EPOCH can be set (per thread) */
 short raw3_get_ERR_FLAG_EPOCH();
 /* therefore, reset using the following function */
 void  raw3_set_ERR_FLAG_EPOCH(short);
@@ -65,6 +129,29 @@ void  raw3_set_ERR_FLAG_EPOCH(short);
 
 raw3_t *raw3_init(int chanc, short *chanv, uint64_t length);
 void    raw3_free(raw3_t *raw3);
+void    raw3_set_level(raw3_t *raw3, int level);
+void    raw3_set_codec(raw3_t *raw3, int codec);
+
+/*
+  also try linear predictors of order 3 to 8 on the first deviations of
+  each channel block, stored when smaller (method code 12); readers before
+  file version 5.0 (cnt_version.h) don't know these blocks; the predictor
+  buffers are allocated on the first enable, returns nonzero if that fails
+*/
+int     raw3_set_lpc(raw3_t *raw3, int enable);
+
+/* verbosity and critical method flags (RAW3_ERR_...) of one decoder */
+void    raw3_set_verbose(raw3_t *raw3, int onoff);
+int     raw3_get_errflags(raw3_t *raw3);
+void    raw3_clear_errflags(raw3_t *raw3);
+
+/*
+  collect compression statistics in statv (chanc elements, indexed by
+  channel number, not by sequence position) for each epoch passed to
+  compepoch_mux or decompepoch_mux; the caller owns statv and resets it
+  as needed; NULL stops collecting
+*/
+void    raw3_set_stats(raw3_t *raw3, raw3_chanstat_t *statv);
 
 /*
   compress a raw sample matrix to an output buffer
@@ -100,4 +187,14 @@ int decompepoch_mux(raw3_t *raw3, char *in, int length, sraw_t *out);
 void compchanv_mux(sraw_t *buf, int length, 
                     short chanc, short *chanv);
 
+/*
+  the same job, fast enough to run while recording: neighbors are ranked by
+  the distance of their first deviations (what RAW3_CHAN encodes), measured
+  on at most maxsamples samples (0 = all); the identity order if memory
+  runs out
+  cost is O(chanc^2 * maxsamples) instead of O(chanc^2 * length)
+*/
+void compchanv_mux_sampled(sraw_t *buf, int length,
+                           short chanc, short *chanv, int maxsamples);
+
 #endif
@@ -41,6 +41,7 @@ typedef struct {
 typedef struct {
   int        c;           /* rejection epoch count */
   rejentry_t *v;          /* rejection epoch vector */
+  int        cursor;      /* last entry looked up by is_rejected */
 } rej_t;
 
 rej_t *rej_init(void);
@@ -24,6 +24,7 @@ typedef struct libeep_seg libeep_seg_t;
  *
  */
 libeep_seg_t * libeep_seg_read(const char *);
+int            libeep_seg_write(const char *, const libeep_seg_t *);
 void           libeep_seg_delete(libeep_seg_t *);
 
 #endif
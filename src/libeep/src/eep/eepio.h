@@ -110,6 +110,23 @@ size_t     eepio_fwrite(const void *, size_t, size_t, FILE *);
 int        eepio_fseek(FILE *, uint64_t, int);
 uint64_t   eepio_ftell(FILE *);
 
+/*
+ * large-block writer support
+ *   eepio_aligned_malloc: buffer aligned to 'alignment' (power of two), release
+ *                         with eepio_aligned_free
+ *   eepio_freserve:       reserve disk space for [offset, offset+len) without
+ *                         writing it (no-op where the platform cannot do this)
+ *   eepio_ftruncate:      flush and cut the file to 'length' bytes
+ * return: 0 on success
+ */
+void     * eepio_aligned_malloc(size_t size, size_t alignment);
+void       eepio_aligned_free(void *);
+int        eepio_freserve(FILE *, uint64_t offset, uint64_t len);
+int        eepio_ftruncate(FILE *, uint64_t length);
+
+/* monotonic clock in nanoseconds, for timing only */
+uint64_t   eepio_clock_ns(void);
+
 /* A function to print a text wrapped at len characters */
 void eep_print_wrap(FILE* out, const char* text, int len);
 
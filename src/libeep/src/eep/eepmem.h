@@ -37,7 +37,51 @@ void *v_realloc(void *ptr, size_t size, const char *mtypefrag);
 
 #define v_new(type) (type *) v_malloc(sizeof(type), "v_new")
 
-#define v_free(ptr)   if((ptr) != NULL) { free(ptr); (ptr) = NULL; } 
+#define v_free(ptr)   if((ptr) != NULL) { v_release(ptr); (ptr) = NULL; } 
+
+/*
+  free a block and drop it from the allocation accounting, use v_free
+*/
+void v_release(void *ptr);
+
+/*
+  allocation accounting (off by default)
+
+  While enabled, the blocks of v_malloc, v_calloc and v_realloc are counted
+  under their mtypefrag tag and the owner set for the calling thread until
+  they are released by v_free. A reallocated block keeps its tag and owner.
+  Rows with a NULL tag sum all tags of an owner, rows of V_MEM_ALL_OWNERS
+  sum all owners of a tag, so their peaks are peaks of the sums; the row
+  (NULL, V_MEM_ALL_OWNERS) is the grand total.
+  Blocks released with plain free() stay counted as live.
+*/
+#define V_MEM_NO_OWNER   -1
+#define V_MEM_ALL_OWNERS -2
+
+typedef struct {
+  const char *tag;            /* mtypefrag, NULL for all tags */
+  int         owner;
+  size_t      live_bytes;
+  size_t      peak_bytes;
+  size_t      live_blocks;
+  size_t      allocations;
+  size_t      reallocations;
+  size_t      frees;
+} v_mem_stat_t;
+
+/* enable (again) with empty statistics, or disable and discard them */
+void v_mem_set_accounting(int enable);
+/* owner of the blocks the calling thread allocates from now on,
+   returns the previous one */
+int  v_mem_set_owner(int owner);
+/* account a block that was not allocated by v_malloc, v_calloc or
+   v_realloc, and drop it again before freeing it */
+void v_mem_track(const void *ptr, size_t size, const char *mtypefrag);
+void v_mem_untrack(const void *ptr);
+/* copy up to statc rows to statv, returns the number of rows */
+int  v_mem_get_stats(v_mem_stat_t *statv, int statc);
+/* set the peaks to the live sizes and the counts to zero */
+void v_mem_reset_stats(void);
 
 
 #define v_extend(ptr, num, type, extnum) \
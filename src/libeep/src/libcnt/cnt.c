@@ -83,7 +83,7 @@ char RCS_cnt_c[] = "$RCSfile: cnt.c,v $ $Revision: 2415 $";
 #define OFS_CALIB         71
 
 #define UNCOMPR_FLOAT_32 12 /* Store uncompressed FLOAT32 values */
-#define RESERVED_FOR_COMPR_FLOAT_32 13 /* Store compressed FLOAT32s - not implemented */
+#define COMPR_FLOAT_32   13 /* Store XOR-delta compressed FLOAT32s (file version 5.0) */
 
 #define TF_CBUF_SIZE(cnt, n) ( (cnt)->eep_header.chanc * (cnt)->tf_header.componentc * (n) * sizeof(float) + (cnt)->eep_header.chanc * (cnt)->tf_header.componentc)
 #define FLOAT_CBUF_SIZE(cnt, n) ( (cnt)->eep_header.chanc * sizeof(float) * (n) + (cnt)->eep_header.chanc )
@@ -192,7 +192,10 @@ int eep_seek_impl(eeg_t *cnt, eep_datatype_e type, uint64_t s, int rel)
       newpos < 0)
     return CNTERR_RANGE;
 
-  if (newpos  / store->epochs.epochl != store->data.bufepoch)
+  cnt->perf.seeks++;
+  if (newpos  / store->epochs.epochl == store->data.bufepoch)
+    cnt->perf.cache_hits++;
+  else
     RET_ON_CNTERROR(getepoch_impl(cnt, type, newpos / store->epochs.epochl));
   store->data.readpos = newpos % store->epochs.epochl;
   return CNTERR_NONE;
@@ -344,7 +347,10 @@ int writehead_RAW3(eeg_t *EEG, var_string buf)
 
   char line[100];
 
-  sprintf(line, "[File Version]\n%d.%d\n", CNTVERSION_MAJOR, CNTVERSION_MINOR);
+  if (EEG->lpc_prediction || EEG->float_compression)
+    sprintf(line, "[File Version]\n%d.%d\n", CNTVERSION_MAJOR, CNTVERSION_MINOR);
+  else
+    sprintf(line, "[File Version]\n%d.%d\n", CNTVERSION_COMPAT_MAJOR, CNTVERSION_COMPAT_MINOR);
   varstr_set(buf, line);
   sprintf(line, "[Sampling Rate]\n%.10f\n", (1000.0 / EEG->eep_header.period) * 0.001 );
   varstr_append(buf, line);
@@ -421,10 +427,41 @@ int writehead_RAW3(eeg_t *EEG, var_string buf)
   return CNTERR_NONE;
 }
 
-int getepoch_impl(eeg_t *cnt, eep_datatype_e type, uint64_t epoch)
+/* account a read or decode of an epoch that started at t0 */
+static void perf_span(eeg_t *cnt, cnt_span_e kind, uint64_t epoch, uint64_t bytes, uint64_t t0)
 {
-  uint64_t insize, insamples, got, samples_to_read;
-  char *inbuf;
+  uint64_t dur = eepio_clock_ns() - t0;
+  uint64_t *hist;
+  int bin;
+  cnt_span_t *span;
+
+  if (CNT_SPAN_READ == kind) {
+    cnt->perf.bytes_read += bytes;
+    cnt->perf.read_ns += dur;
+    hist = cnt->perf.read_hist;
+  } else {
+    cnt->perf.epochs_decoded++;
+    cnt->perf.decode_ns += dur;
+    hist = cnt->perf.decode_hist;
+  }
+  for (bin = 0; bin < CNT_PERF_BINS - 1 && (dur >> (bin + 1)); bin++);
+  hist[bin]++;
+
+  if (cnt->tracec < cnt->tracemax) {
+    span = &cnt->tracev[cnt->tracec++];
+    span->kind = kind;
+    span->epoch = epoch;
+    span->bytes = bytes;
+    span->start_ns = t0;
+    span->dur_ns = dur;
+  }
+}
+
+/* size in bytes and samples of a stored epoch */
+static int epoch_extent(eeg_t *cnt, eep_datatype_e type, uint64_t epoch,
+                        uint64_t *insize, uint64_t *insamples)
+{
+  uint64_t samples_to_read;
   storage_t *store = &cnt->store[type];
 
   uint64_t totsamples = 0;
@@ -450,32 +487,52 @@ int getepoch_impl(eeg_t *cnt, eep_datatype_e type, uint64_t epoch)
 	if(totsamples < epoch * store->epochs.epochl)
 		return CNTERR_BADREQ;
 
-    insize = store->ch_data.size - store->epochs.epochv[epoch];
+    *insize = store->ch_data.size - store->epochs.epochv[epoch];
     samples_to_read = totsamples - epoch * store->epochs.epochl;
-	insamples = (samples_to_read < store->epochs.epochl) ? samples_to_read : store->epochs.epochl;
+	*insamples = (samples_to_read < store->epochs.epochl) ? samples_to_read : store->epochs.epochl;
   }
   else {
-    insize = store->epochs.epochv[epoch + 1] - store->epochs.epochv[epoch];
-    insamples = store->epochs.epochl;
+    *insize = store->epochs.epochv[epoch + 1] - store->epochs.epochv[epoch];
+    *insamples = store->epochs.epochl;
   }
+  return CNTERR_NONE;
+}
 
+/* make the stored bytes of an epoch available in *inbuf, read to cbuf if needed */
+static int epoch_fetch(eeg_t *cnt, storage_t *store, uint64_t epoch, uint64_t insize,
+                       char *cbuf, char **inbuf)
+{
+  uint64_t t0 = eepio_clock_ns();
 #ifdef CNT_MMAP
-  inbuf = store->data_map + store->map_offset + store->epochs.epochv[epoch];
+  *inbuf = store->data_map + store->map_offset + store->epochs.epochv[epoch];
 #else
   /* seek/read source file */
   if(cnt->mode==CNT_RIFF) {
     RET_ON_RIFFERROR(riff_seek(cnt->f, store->epochs.epochv[epoch], SEEK_SET, store->ch_data), CNTERR_FILE);
-    RET_ON_RIFFERROR(riff_read(store->data.cbuf, sizeof(char), insize, cnt->f, store->ch_data), CNTERR_FILE);
+    RET_ON_RIFFERROR(riff_read(cbuf, sizeof(char), insize, cnt->f, store->ch_data), CNTERR_FILE);
   } else {
     RET_ON_RIFFERROR(riff64_seek(cnt->f, store->epochs.epochv[epoch], SEEK_SET, store->ch_data), CNTERR_FILE);
-    RET_ON_RIFFERROR(riff64_read(store->data.cbuf, sizeof(char), insize, cnt->f, store->ch_data), CNTERR_FILE);
+    RET_ON_RIFFERROR(riff64_read(cbuf, sizeof(char), insize, cnt->f, store->ch_data), CNTERR_FILE);
   }
 
-  inbuf=store->data.cbuf;
+  *inbuf=cbuf;
 #endif
+  perf_span(cnt, CNT_SPAN_READ, epoch, insize, t0);
+  return CNTERR_NONE;
+}
+
+int getepoch_impl(eeg_t *cnt, eep_datatype_e type, uint64_t epoch)
+{
+  uint64_t insize, insamples, got, t0;
+  char *inbuf;
+  storage_t *store = &cnt->store[type];
+
+  RET_ON_CNTERROR(epoch_extent(cnt, type, epoch, &insize, &insamples));
+  RET_ON_CNTERROR(epoch_fetch(cnt, store, epoch, insize, store->data.cbuf, &inbuf));
   store->data.bufepoch = epoch;
   store->data.readpos = 0;
 
+  t0 = eepio_clock_ns();
   switch (type)
   {
     case DATATYPE_EEG: /* Read 'normal' EEG data, using RAW3 compression, INT format */
@@ -500,6 +557,269 @@ int getepoch_impl(eeg_t *cnt, eep_datatype_e type, uint64_t epoch)
       return CNTERR_DATA;
       break;
   }
+  perf_span(cnt, CNT_SPAN_DECODE, epoch, insize, t0);
+  return CNTERR_NONE;
+}
+
+/* alignment of the large-block writer buffer, matches common disk sectors/pages */
+#define CNT_WIO_ALIGN 4096
+
+/* reserve disk space in whole extents before n more bytes are appended */
+static void wio_reserve(eeg_t *cnt, uint64_t n)
+{
+  cnt_wio_t *wio = &cnt->wio;
+  uint64_t end, want;
+
+  if (0 == wio->extent)
+    return;
+  end = eepio_ftell(cnt->f) + n;
+  if (end <= wio->reserved)
+    return;
+  want = ((end + wio->extent - 1) / wio->extent) * wio->extent;
+  /* reservation is only an optimization, failure is not an error */
+  if (!eepio_freserve(cnt->f, wio->reserved, want - wio->reserved))
+    wio->reserved = want;
+}
+
+/* write the epochs staged by the large-block writer to file */
+static int wio_flush(eeg_t *cnt)
+{
+  cnt_wio_t *wio = &cnt->wio;
+
+  if (0 == wio->fill)
+    return CNTERR_NONE;
+  wio_reserve(cnt, wio->fill);
+  if (eepio_fwrite(wio->buf, 1, wio->fill, cnt->f) != wio->fill)
+    return CNTERR_FILE;
+  wio->fill = 0;
+  return CNTERR_NONE;
+}
+
+int eep_set_write_buffering(eeg_t *cnt, size_t bufsize, uint64_t extent)
+{
+  if (cnt->wio.fill)
+    return CNTERR_BADREQ;
+
+  if (cnt->wio.buf)
+    eepio_aligned_free(cnt->wio.buf);
+  cnt->wio.buf = NULL;
+  cnt->wio.size = 0;
+  cnt->wio.extent = extent;
+
+  if (bufsize) {
+    cnt->wio.buf = (char *) eepio_aligned_malloc(bufsize, CNT_WIO_ALIGN);
+    if (NULL == cnt->wio.buf)
+      return CNTERR_MEM;
+    cnt->wio.size = bufsize;
+  }
+  return CNTERR_NONE;
+}
+
+/* number of samples of the first epoch used to rank channel neighbors */
+#define CNT_CHANSEQ_SAMPLES 512
+
+int eep_set_optimize_channel_order(eeg_t *cnt, int enable)
+{
+  if (cnt->store[DATATYPE_EEG].epochs.epochc)
+    return CNTERR_BADREQ;
+  cnt->optimize_chanseq = enable;
+  return CNTERR_NONE;
+}
+
+int eep_set_compression_level(eeg_t *cnt, int level)
+{
+  if (level < RAW3_LEVEL_EXHAUSTIVE || level > RAW3_LEVEL_REUSE)
+    return CNTERR_BADREQ;
+  cnt->compression_level = level;
+  if (cnt->r3)
+    raw3_set_level(cnt->r3, level);
+  return CNTERR_NONE;
+}
+
+int eep_set_adaptive_coding(eeg_t *cnt, int enable)
+{
+  storage_t *store = &cnt->store[DATATYPE_EEG];
+  fourcc_t fourcc = enable ? FOURCC_arw3 : FOURCC_raw3;
+  uint64_t filepos;
+  char id[4];
+
+  if (store->epochs.epochc)
+    return CNTERR_BADREQ;
+
+  /* the data list is already started, rename it in place */
+  if (store->data.writeflag && fourcc != store->fourcc) {
+    id[0] = (char) (fourcc & 0xff);
+    id[1] = (char) ((fourcc >> 8) & 0xff);
+    id[2] = (char) ((fourcc >> 16) & 0xff);
+    id[3] = (char) ((fourcc >> 24) & 0xff);
+    filepos = eepio_ftell(cnt->f);
+    if (   eepio_fseek(cnt->f, store->ch_toplevel.start + (CNT_RIFF == cnt->mode ? 8 : 12), SEEK_SET)
+        || eepio_fwrite(id, 1, 4, cnt->f) != 4
+        || eepio_fseek(cnt->f, filepos, SEEK_SET))
+      return CNTERR_FILE;
+  }
+  store->fourcc = fourcc;
+  if (cnt->r3)
+    raw3_set_codec(cnt->r3, enable ? RAW3_CODEC_ADAPTIVE : RAW3_CODEC_FIXED);
+  return CNTERR_NONE;
+}
+
+int eep_set_lpc_prediction(eeg_t *cnt, int enable)
+{
+  if (cnt->store[DATATYPE_EEG].epochs.epochc)
+    return CNTERR_BADREQ;
+  if (cnt->r3 && raw3_set_lpc(cnt->r3, enable))
+    return CNTERR_MEM;
+  cnt->lpc_prediction = enable;
+  return CNTERR_NONE;
+}
+
+void eep_set_float_compression(eeg_t *cnt, int enable)
+{
+  cnt->float_compression = enable;
+}
+
+int eep_set_compression_stats(eeg_t *cnt, int enable)
+{
+  if (cnt->r3)
+    raw3_set_stats(cnt->r3, NULL);
+  v_free(cnt->compr_statv);
+  cnt->compr_statv = NULL;
+
+  if (enable) {
+    cnt->compr_statv = (raw3_chanstat_t *)
+      v_malloc(cnt->eep_header.chanc * sizeof(raw3_chanstat_t), "compr_statv");
+    if (NULL == cnt->compr_statv)
+      return CNTERR_MEM;
+    eep_reset_compression_stats(cnt);
+    if (cnt->r3)
+      raw3_set_stats(cnt->r3, cnt->compr_statv);
+  }
+  return CNTERR_NONE;
+}
+
+const raw3_chanstat_t * eep_get_compression_stats(eeg_t *cnt)
+{
+  return cnt->compr_statv;
+}
+
+void eep_reset_compression_stats(eeg_t *cnt)
+{
+  if (cnt->compr_statv)
+    memset(cnt->compr_statv, 0, cnt->eep_header.chanc * sizeof(raw3_chanstat_t));
+}
+
+int eep_scan_compression_stats(eeg_t *cnt, uint64_t epoch)
+{
+  uint64_t insize, insamples, got, t0;
+  char *inbuf, *cbuf;
+  sraw_t *buf;
+  storage_t *store = &cnt->store[DATATYPE_EEG];
+  int status;
+
+  if (NULL == cnt->compr_statv || NULL == cnt->r3 || epoch >= store->epochs.epochc)
+    return CNTERR_BADREQ;
+  RET_ON_CNTERROR(epoch_extent(cnt, DATATYPE_EEG, epoch, &insize, &insamples));
+
+  /* decode aside, the buffered epoch and the read position stay as they are */
+  cbuf = (char *) v_malloc((size_t) insize, "scan_cbuf");
+  buf = (sraw_t *) v_malloc((size_t) CNTBUF_SIZE(cnt, insamples), "scan_buf");
+  if (NULL == cbuf || NULL == buf) {
+    v_free(cbuf);
+    v_free(buf);
+    return CNTERR_MEM;
+  }
+  status = epoch_fetch(cnt, store, epoch, insize, cbuf, &inbuf);
+  if (CNTERR_NONE == status) {
+    t0 = eepio_clock_ns();
+    got = decompepoch_mux(cnt->r3, inbuf, (int) insamples, buf);
+    perf_span(cnt, CNT_SPAN_DECODE, epoch, insize, t0);
+    if (got != insize)
+      status = CNTERR_DATA;
+  }
+  v_free(cbuf);
+  v_free(buf);
+  return status;
+}
+
+cnt_perf_t * eep_get_perf(eeg_t *cnt)
+{
+  return &cnt->perf;
+}
+
+void eep_reset_perf(eeg_t *cnt)
+{
+  memset(&cnt->perf, 0, sizeof(cnt_perf_t));
+  cnt->tracec = 0;
+}
+
+int eep_set_perf_trace(eeg_t *cnt, int maxc)
+{
+  v_free(cnt->tracev);
+  cnt->tracec = 0;
+  cnt->tracemax = 0;
+
+  if (maxc < 0)
+    return CNTERR_BADREQ;
+  if (maxc > 0) {
+    cnt->tracev = (cnt_span_t *) v_malloc((size_t) maxc * sizeof(cnt_span_t), "tracev");
+    if (NULL == cnt->tracev)
+      return CNTERR_MEM;
+    cnt->tracemax = maxc;
+  }
+  return CNTERR_NONE;
+}
+
+int eep_write_perf_trace(eeg_t *cnt, FILE *f, int tid)
+{
+  const cnt_span_t *span;
+  int i;
+
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (i = 0; i < cnt->tracec; i++) {
+    span = &cnt->tracev[i];
+    /* complete events, times in microseconds */
+    fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+               "\"ts\":%" PRIu64 ".%03d,\"dur\":%" PRIu64 ".%03d,"
+               "\"args\":{\"epoch\":%" PRIu64 ",\"bytes\":%" PRIu64 "}}",
+            i ? "," : "",
+            CNT_SPAN_READ == span->kind ? "read" : "decode",
+            CNT_SPAN_READ == span->kind ? "io" : "cpu",
+            tid,
+            span->start_ns / 1000, (int) (span->start_ns % 1000),
+            span->dur_ns / 1000, (int) (span->dur_ns % 1000),
+            span->epoch, span->bytes);
+  }
+  fprintf(f, "\n]}\n");
+  return ferror(f) ? CNTERR_FILE : CNTERR_NONE;
+}
+
+/* derive the channel sequence from the pending epoch and store it in
+   the (already written, fixed size) chan chunk */
+static int optimize_chanseq(eeg_t *cnt, storage_t *store)
+{
+  short chanc = cnt->eep_header.chanc;
+  uint64_t filepos;
+  char *outchan;
+  short chan;
+
+  compchanv_mux_sampled(store->data.buf_int, (int) store->data.writepos,
+                        chanc, store->chanseq, CNT_CHANSEQ_SAMPLES);
+  memcpy(cnt->r3->chanv, store->chanseq, chanc * sizeof(short));
+
+  outchan = (char *) v_malloc(chanc * 2, "chanseq");
+  for (chan = 0; chan < chanc; chan++)
+    swrite_s16(&outchan[2 * chan], store->chanseq[chan]);
+
+  filepos = eepio_ftell(cnt->f);
+  if (   eepio_fseek(cnt->f, store->ch_chan.start + (CNT_RIFF == cnt->mode ? 8 : 12), SEEK_SET)
+      || eepio_fwrite(outchan, 2, chanc, cnt->f) != (size_t) chanc
+      || eepio_fseek(cnt->f, filepos, SEEK_SET))
+  {
+    v_free(outchan);
+    return CNTERR_FILE;
+  }
+  v_free(outchan);
   return CNTERR_NONE;
 }
 
@@ -508,6 +828,7 @@ int putepoch_impl(eeg_t *cnt)
   // int smp = 0;
   uint64_t to_write;
   storage_t *store;
+  int flushed = 1;
 
   if ((DATATYPE_UNDEFINED == cnt->current_datachunk) ||
       (!cnt->store[cnt->current_datachunk].initialized))
@@ -521,6 +842,8 @@ int putepoch_impl(eeg_t *cnt)
     switch (cnt->current_datachunk)
     {
       case DATATYPE_EEG:
+        if (cnt->optimize_chanseq && 0 == store->epochs.epochc)
+          RET_ON_CNTERROR(optimize_chanseq(cnt, store));
         to_write = compepoch_mux(cnt->r3, store->data.buf_int, (int) store->data.writepos, store->data.cbuf);
         break;
 
@@ -537,11 +860,24 @@ int putepoch_impl(eeg_t *cnt)
         return CNTERR_BADREQ; /* Invalid mode, this should not happen */
     }
 
-    /* write the filled buffers to file, reset buffers */
-    if(cnt->mode==CNT_RIFF) {
-      RET_ON_RIFFERROR(riff_write(store->data.cbuf, sizeof(char), to_write, cnt->f, &store->ch_data), CNTERR_FILE);
+    /* write the filled buffers to file (or stage them), reset buffers */
+    if (NULL != cnt->wio.buf && to_write <= cnt->wio.size) {
+      flushed = 0;
+      if (cnt->wio.fill + to_write > cnt->wio.size) {
+        RET_ON_CNTERROR(wio_flush(cnt));
+        flushed = 1;
+      }
+      memcpy(cnt->wio.buf + cnt->wio.fill, store->data.cbuf, (size_t) to_write);
+      cnt->wio.fill += (size_t) to_write;
+      store->ch_data.size += to_write; /* the accounting riff_write does */
     } else {
-      RET_ON_RIFFERROR(riff64_write(store->data.cbuf, sizeof(char), to_write, cnt->f, &store->ch_data), CNTERR_FILE);
+      RET_ON_CNTERROR(wio_flush(cnt));
+      wio_reserve(cnt, to_write);
+      if(cnt->mode==CNT_RIFF) {
+        RET_ON_RIFFERROR(riff_write(store->data.cbuf, sizeof(char), to_write, cnt->f, &store->ch_data), CNTERR_FILE);
+      } else {
+        RET_ON_RIFFERROR(riff64_write(store->data.cbuf, sizeof(char), to_write, cnt->f, &store->ch_data), CNTERR_FILE);
+      }
     }
 
     if (DATATYPE_TIMEFREQ == cnt->current_datachunk )
@@ -559,7 +895,8 @@ int putepoch_impl(eeg_t *cnt)
     /* prepare registering next buffer */
     store->epochs.epvbuf += to_write;
   }
-  if (cnt->keep_consistent)
+  /* with write buffering, staged epochs only become consistent at a flush */
+  if (cnt->keep_consistent && flushed)
     make_partial_output_consistent(cnt, 0 /* No finalize */);
   return CNTERR_NONE;
 }
@@ -733,6 +1070,169 @@ int writehead_TFH(tf_header_t* tf_header, var_string buf)
   return CNTERR_NONE;
 }
 
+/* --------------------------------------------------------------------
+  COMPR_FLOAT_32 channel blocks: | flag | x[0] | code x[1] .. code x[n-1]
+                                     8     32
+  each value (IEEE bit pattern) is XORed with its predecessor, the codes are
+    0                         same value as before
+    1 0 bits                  the XOR fits the bit window of the last new one
+    1 1 lead len-1 bits       new window: 5 bit leading zeros, 5 bit length - 1
+  bits are stored most significant first, the block is padded to whole bytes
+*/
+
+static int floatc_clz(uint32_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_clz(x);
+#else
+  int n = 0;
+  while (!(x & 0x80000000)) { x <<= 1; n++; }
+  return n;
+#endif
+}
+
+static int floatc_ctz(uint32_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz(x);
+#else
+  int n = 0;
+  while (!(x & 1)) { x >>= 1; n++; }
+  return n;
+#endif
+}
+
+/* append the nbits (<= 32) low bits of x to the output */
+#define FLOATC_PUT(x, nbits) \
+  do { \
+    acc = (acc << (nbits)) | ((uint64_t) (x) & (((uint64_t) 1 << (nbits)) - 1)); \
+    nacc += (nbits); \
+    while (nacc >= 8) { \
+      nacc -= 8; \
+      out[nout++] = (unsigned char) (acc >> nacc); \
+    } \
+  } while (0)
+
+/* take the next nbits (<= 32) bits of the input */
+#define FLOATC_GET(x, nbits) \
+  do { \
+    while (nacc < (nbits)) { \
+      acc = (acc << 8) | in[nin++]; \
+      nacc += 8; \
+    } \
+    nacc -= (nbits); \
+    (x) = (uint32_t) ((acc >> nacc) & (((uint64_t) 1 << (nbits)) - 1)); \
+  } while (0)
+
+/*
+  code the n values in[0], in[step] ... to out, using at most max bytes
+  return: number of bytes used, -1 if they don't fit
+*/
+static long floatc_encode(const float *in, uint64_t step, int n, unsigned char *out, long max)
+{
+  uint64_t acc = 0;
+  int nacc = 0, smp, lead, trail, len, wlead = -1, wtrail = 0;
+  long nout = 0;
+  uint32_t prev, cur, x;
+
+  if (max < 5)
+    return -1;
+  memcpy(&prev, &in[0], sizeof(uint32_t));
+  FLOATC_PUT(prev, 32);
+
+  for (smp = 1; smp < n; smp++) {
+    /* a code takes at most 44 bits */
+    if (nout + 6 > max)
+      return -1;
+    memcpy(&cur, &in[smp * step], sizeof(uint32_t));
+    x = cur ^ prev;
+    prev = cur;
+    if (!x) {
+      FLOATC_PUT(0, 1);
+      continue;
+    }
+    lead = floatc_clz(x);
+    trail = floatc_ctz(x);
+    if (wlead >= 0 && lead >= wlead && trail >= wtrail) {
+      FLOATC_PUT(2, 2);
+      FLOATC_PUT(x >> wtrail, 32 - wlead - wtrail);
+    }
+    else {
+      len = 32 - lead - trail;
+      FLOATC_PUT(3, 2);
+      FLOATC_PUT(lead, 5);
+      FLOATC_PUT(len - 1, 5);
+      FLOATC_PUT(x >> trail, len);
+      wlead = lead;
+      wtrail = trail;
+    }
+  }
+
+  /* don't forget to write the last bits */
+  if (nacc) {
+    if (nout + 1 > max)
+      return -1;
+    out[nout++] = (unsigned char) (acc << (8 - nacc));
+  }
+  return nout;
+}
+
+/*
+  decode n values to out[0], out[step] ...
+  return: number of bytes used
+*/
+static long floatc_decode(const unsigned char *in, float *out, uint64_t step, int n)
+{
+  uint64_t acc = 0;
+  int nacc = 0, smp, wlead = 0, wtrail = 0, len;
+  long nin = 0;
+  uint32_t cur, bits, x;
+
+  FLOATC_GET(cur, 32);
+  memcpy(&out[0], &cur, sizeof(float));
+
+  for (smp = 1; smp < n; smp++) {
+    FLOATC_GET(bits, 1);
+    if (bits) {
+      FLOATC_GET(bits, 1);
+      if (bits) {
+        FLOATC_GET(wlead, 5);
+        FLOATC_GET(len, 5);
+        len++;
+        wtrail = 32 - wlead - len;
+      }
+      else
+        len = 32 - wlead - wtrail;
+      FLOATC_GET(x, len);
+      cur ^= x << wtrail;
+    }
+    memcpy(&out[smp * step], &cur, sizeof(float));
+  }
+  return nin;
+}
+
+/*
+  write one channel block, compressed if enabled and smaller, never larger
+  than the uncompressed one
+  return: number of bytes written
+*/
+static long float_block_write(eeg_t *cnt, float *in, uint64_t step, int length, char *out)
+{
+  long size = -1;
+  int smp;
+
+  if (cnt->float_compression)
+    size = floatc_encode(in, step, length, (unsigned char *) &out[1], length * sizeof(float) - 1);
+  if (size >= 0) {
+    out[0] = COMPR_FLOAT_32;
+    return size + 1;
+  }
+  out[0] = UNCOMPR_FLOAT_32;
+  for (smp = 0; smp < length; smp++)
+    swrite_f32(&out[sizeof(float)*smp+1], in[smp * step]);
+  return length * sizeof(float) + 1;
+}
+
 int tf_convert_for_read(eeg_t *cnt, char *in, float* out, int length)
 {
   char *inbase;
@@ -740,17 +1240,20 @@ int tf_convert_for_read(eeg_t *cnt, char *in, float* out, int length)
   uint64_t comp, chan, smpstep, smp, seq_id;
 
   smpstep = cnt->tf_header.componentc * cnt->eep_header.chanc;
+  inbase = in;
   for (seq_id = 0; seq_id < cnt->tf_header.componentc * cnt->eep_header.chanc; seq_id++)
   {
     comp = cnt->store[DATATYPE_TIMEFREQ].chanseq[2*seq_id];
     chan = cnt->store[DATATYPE_TIMEFREQ].chanseq[2*seq_id+1];
-    inbase = &in[seq_id * (length*sizeof(float)+1)];
     outbase = &out[comp * cnt->eep_header.chanc + chan];
     if (UNCOMPR_FLOAT_32 == inbase[0])
     {
       for (smp = 0; smp < length; smp++)
         sread_f32(&inbase[sizeof(float)*smp+1], &outbase[smp * smpstep]);
+      inbase += length*sizeof(float)+1;
     }
+    else if (COMPR_FLOAT_32 == inbase[0])
+      inbase += floatc_decode((unsigned char *) &inbase[1], outbase, smpstep, length) + 1;
     else
       return CNTERR_DATA;
   }
@@ -761,20 +1264,18 @@ long tf_convert_for_write(eeg_t *cnt, float *in, char* out, int length)
 {
   float *inbase;
   char *outbase;
-  uint64_t comp, chan, smpstep, smp, seq_id;
+  uint64_t comp, chan, smpstep, seq_id;
 
   smpstep = cnt->tf_header.componentc * cnt->eep_header.chanc;
+  outbase = out;
   for (seq_id = 0; seq_id < cnt->tf_header.componentc * cnt->eep_header.chanc; seq_id++)
   {
     comp = cnt->store[DATATYPE_TIMEFREQ].chanseq[2*seq_id];
     chan = cnt->store[DATATYPE_TIMEFREQ].chanseq[2*seq_id+1];
     inbase = &in[comp * cnt->eep_header.chanc + chan];
-    outbase = &out[seq_id * (sizeof(float)*length + 1)];
-    outbase[0] = UNCOMPR_FLOAT_32;
-    for (smp = 0; smp < length; smp++)
-      swrite_f32(&outbase[sizeof(float)*smp+1], inbase[smp * smpstep]);
+    outbase += float_block_write(cnt, inbase, smpstep, length, outbase);
   }
-  return TF_CBUF_SIZE(cnt, length);
+  return (long) (outbase - out);
 }
 
 int rawf_convert_for_read(eeg_t *cnt, char *in, float* out, int length)
@@ -784,15 +1285,18 @@ int rawf_convert_for_read(eeg_t *cnt, char *in, float* out, int length)
   uint64_t smpstep, smp, seq_id;
 
   smpstep = cnt->eep_header.chanc;
+  inbase = in;
   for (seq_id = 0; seq_id < cnt->eep_header.chanc; seq_id++)
   {
-    inbase = &in[seq_id * (length*sizeof(float)+1)];
     outbase = &out[cnt->store[DATATYPE_AVERAGE].chanseq[seq_id]];
     if (UNCOMPR_FLOAT_32 == inbase[0])
     {
       for (smp = 0; smp < length; smp++)
         sread_f32(&inbase[sizeof(float)*smp+1], &outbase[smp * smpstep]);
+      inbase += length*sizeof(float)+1;
     }
+    else if (COMPR_FLOAT_32 == inbase[0])
+      inbase += floatc_decode((unsigned char *) &inbase[1], outbase, smpstep, length) + 1;
     else
       return CNTERR_DATA;
   }
@@ -803,18 +1307,16 @@ long rawf_convert_for_write(eeg_t *cnt, float *in, char* out, int length)
 {
   float *inbase;
   char *outbase;
-  uint64_t smpstep, smp, seq_id;
+  uint64_t smpstep, seq_id;
 
   smpstep = cnt->eep_header.chanc;
+  outbase = out;
   for (seq_id = 0; seq_id < cnt->eep_header.chanc; seq_id++)
   {
     inbase = &in[cnt->store[DATATYPE_AVERAGE].chanseq[seq_id]];
-    outbase = &out[seq_id * (sizeof(float)*length + 1)];
-    outbase[0] = UNCOMPR_FLOAT_32;
-    for (smp = 0; smp < length; smp++)
-      swrite_f32(&outbase[sizeof(float)*smp+1], inbase[smp * smpstep]);
+    outbase += float_block_write(cnt, inbase, smpstep, length, outbase);
   }
-  return FLOAT_CBUF_SIZE(cnt, length);
+  return (long) (outbase - out);
 }
 
 /* general constructor/destructor ------------------------------- */
@@ -876,6 +1378,13 @@ void eep_free(eeg_t *cnt)
 
   v_free(cnt->fname);
 
+  v_free(cnt->compr_statv);
+  v_free(cnt->tracev);
+
+  /* Free large-block writer buffer */
+  if (cnt->wio.buf)
+    eepio_aligned_free(cnt->wio.buf);
+
   /* Free history */
   varstr_destruct(cnt->history);
 
@@ -1368,6 +1877,15 @@ int cnt_create_raw3_compr_buffer(eeg_t *EEG)
 {
   storage_t *store = &EEG->store[DATATYPE_EEG];
   EEG->r3 = raw3_init(EEG->eep_header.chanc, store->chanseq, store->epochs.epochl);
+  if (EEG->r3) {
+    raw3_set_level(EEG->r3, EEG->compression_level);
+    raw3_set_codec(EEG->r3, FOURCC_arw3 == store->fourcc ? RAW3_CODEC_ADAPTIVE : RAW3_CODEC_FIXED);
+    raw3_set_stats(EEG->r3, EEG->compr_statv);
+    if (raw3_set_lpc(EEG->r3, EEG->lpc_prediction)) {
+      raw3_free(EEG->r3);
+      EEG->r3 = NULL;
+    }
+  }
   store->data.buf_int = (sraw_t *)
     v_malloc((size_t) store->epochs.epochl * EEG->eep_header.chanc * sizeof(sraw_t), "buf");
   store->data.cbuf = (char *)
@@ -1718,6 +2236,7 @@ int eep_finish_file(eeg_t *EEG)
   uint64_t sample;
   int flag, oldflag;
   unsigned long  pos;
+  int status = CNTERR_NONE;
 
   if (!EEG)
     return CNTERR_NONE;
@@ -1779,13 +2298,19 @@ int eep_finish_file(eeg_t *EEG)
             make_partial_output_consistent(EEG, 1 /* Finalize data */);
             break;
           }
+      /* give back space reserved beyond the end of the RIFF tree */
+      if (EEG->wio.reserved) {
+        uint64_t end = EEG->cnt.start + EEG->cnt.size + (CNT_RIFF == EEG->mode ? 8 : 12);
+        if (end < EEG->wio.reserved && eepio_ftruncate(f, end))
+          status = CNTERR_FILE;
+      }
       break;
 
     default:
       return CNTERR_DATA;
   }
   eep_free(EEG);
-  return CNTERR_NONE;
+  return status;
 
 }
 
@@ -1855,10 +2380,14 @@ int init_data_store(eeg_t *cnt, eep_datatype_e type)
   if (DATATYPE_TIMEFREQ == type)
     chanseq_len *= 2 * cnt->tf_header.componentc;
 
-  /* Open top-level chunk */
+  /* Open top-level chunk, EEG is stored in raw3 or in its adaptive coded variant */
   if(cnt->mode==CNT_RIFF) {
+    if (DATATYPE_EEG == type && riff_list_open(cnt->f, &dummychunk, store->fourcc, cnt->cnt))
+      store->fourcc = FOURCC_arw3;
     RET_ON_RIFFERROR(riff_list_open(cnt->f, &dummychunk, store->fourcc, cnt->cnt), CNTERR_FILE);
   } else {
+    if (DATATYPE_EEG == type && riff64_list_open(cnt->f, &dummychunk64, store->fourcc, cnt->cnt))
+      store->fourcc = FOURCC_arw3;
     RET_ON_RIFFERROR(riff64_list_open(cnt->f, &dummychunk64, store->fourcc, cnt->cnt), CNTERR_FILE);
   }
 
@@ -2630,6 +3159,7 @@ int close_data_chunk(eeg_t *cnt, int finalize, storage_t *store /*, chunk_mode_e
 {
     if (finalize)
       RET_ON_CNTERROR(putepoch_impl(cnt));
+    RET_ON_CNTERROR(wio_flush(cnt));
     if(cnt->mode==CNT_RIFF) {
       RET_ON_RIFFERROR(riff_close(cnt->f, store->ch_data), CNTERR_FILE);
     } else {
@@ -2692,9 +3222,13 @@ int make_partial_output_consistent(eeg_t *cnt, int finalize)
   FILE* f = cnt->f;
 
   uint64_t file_offset;
+  uint64_t filepos;
+
+  /* Staged epochs go to file first, the positions below depend on it */
+  RET_ON_CNTERROR(wio_flush(cnt));
 
   /* Remember the current file position */
-  uint64_t filepos = eepio_ftell(f);
+  filepos = eepio_ftell(f);
 
   /* Do everything that eep_finish_file() normally takes care of, such as closing the
     active data chunk, writing the corresponding EPochs chunk, the header, etc.
@@ -3593,7 +4127,7 @@ int gethead_AVR(eeg_t *EEG)
   }
   EEG->store[DATATYPE_AVERAGE].initialized = 1;
 
-  free(v);
+  v_free(v);
   avrclose(&avr);
 
   return ferror(f);
@@ -3926,7 +4460,7 @@ int saveold_RAW3(eeg_t *dst, eeg_t *src, unsigned long delmask)
               || ((id == FOURCC_evt)  && (delmask & FORGET_evt))
               || ((id == FOURCC_eeph) && (delmask & FORGET_eeph))
               || ((id == FOURCC_tfh)  && (delmask & FORGET_tfh))
-              || ((id == FOURCC_LIST && listid == FOURCC_raw3)
+              || ((id == FOURCC_LIST && (listid == FOURCC_raw3 || listid == FOURCC_arw3))
                                       && (delmask & FORGET_raw))
               || (( id == FOURCC_LIST && listid == FOURCC_rawf)
                                       && (delmask & FORGET_rawf))
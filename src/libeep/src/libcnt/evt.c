@@ -773,3 +773,183 @@ libeep_evt_read(const char * filename) {
 
   return rv;
 }
+/******************************************************************************
+ * internal function; write string
+ *****************************************************************************/
+static
+void
+_libeep_evt_write_string(FILE * f, const char * s) {
+  size_t   length = s == NULL ? 0 : strlen(s);
+  uint8_t  byte;
+  uint16_t word;
+  uint32_t dword;
+
+  /* same escalation as _libeep_evt_read_string */
+  if(length < 0xFF) {
+    byte = (uint8_t)length;
+    fwrite(&byte, sizeof(uint8_t), 1, f);
+  } else {
+    byte = 0xFF;
+    fwrite(&byte, sizeof(uint8_t), 1, f);
+    if(length < 0xFFFF) {
+      word = (uint16_t)length;
+      fwrite(&word, sizeof(uint16_t), 1, f);
+    } else {
+      word = 0xFFFF;
+      dword = (uint32_t)length;
+      fwrite(&word, sizeof(uint16_t), 1, f);
+      fwrite(&dword, sizeof(uint32_t), 1, f);
+    }
+  }
+  if(length) {
+    fwrite(s, length, 1, f);
+  }
+}
+/******************************************************************************
+ * internal function; write wstring, characters are written as their low byte
+ *****************************************************************************/
+static
+void
+_libeep_evt_write_wstring(FILE * f, const char * s) {
+  int32_t     bytes = (int32_t)(2 * strlen(s));
+  char_pair_t cp;
+
+  fwrite(&bytes, sizeof(int32_t), 1, f);
+  cp.hi = 0;
+  for(; *s; ++s) {
+    cp.lo = *s;
+    fwrite(&cp, sizeof(char_pair_t), 1, f);
+  }
+}
+/******************************************************************************
+ * internal function; write class, NULL for an anonymous class
+ *****************************************************************************/
+static
+void
+_libeep_evt_write_class(FILE * f, const char * name) {
+  int32_t tag = name == NULL ? 0 : -1;
+
+  fwrite(&tag, sizeof(int32_t), 1, f);
+  if(name != NULL) {
+    _libeep_evt_write_string(f, name);
+  }
+}
+/******************************************************************************
+ * internal function; write the epoch descriptors of an event
+ *****************************************************************************/
+static
+void
+_libeep_evt_write_epoch_descriptors(FILE * f, const libeep_evt_event_t * ev) {
+  int32_t      size;
+  int16_t      type;
+  float        value = 0;
+  uint32_t     n = 0;
+  char       * end;
+  const char * p;
+
+  if(ev->impedances != NULL) {
+    /* one array of floats in kOhm, an array of variants holding r4 values */
+    size = 1;
+    fwrite(&size, sizeof(int32_t), 1, f);
+    _libeep_evt_write_string(f, "Impedance");
+    type = vt_array | 12;
+    fwrite(&type, sizeof(int16_t), 1, f);
+    type = vt_r4;
+    fwrite(&type, sizeof(int16_t), 1, f);
+    fwrite(&value, sizeof(float), 1, f);
+    for(p = ev->impedances; ; p = end) {
+      strtof(p, &end);
+      if(end == p) {
+        break;
+      }
+      ++n;
+    }
+    fwrite(&n, sizeof(uint32_t), 1, f);
+    for(p = ev->impedances; n--; p = end) {
+      value = strtof(p, &end);
+      fwrite(&value, sizeof(float), 1, f);
+    }
+    _libeep_evt_write_string(f, "kOhm");
+    return;
+  }
+
+  size = ev->condition == NULL ? 1 : 2;
+  fwrite(&size, sizeof(int32_t), 1, f);
+  _libeep_evt_write_string(f, "EventCode");
+  type = vt_i4;
+  fwrite(&type, sizeof(int16_t), 1, f);
+  fwrite(&ev->code, sizeof(int32_t), 1, f);
+  _libeep_evt_write_string(f, NULL);
+  if(ev->condition != NULL) {
+    _libeep_evt_write_string(f, "Condition");
+    type = vt_bstr;
+    fwrite(&type, sizeof(int16_t), 1, f);
+    _libeep_evt_write_wstring(f, ev->condition);
+    _libeep_evt_write_string(f, NULL);
+  }
+}
+/******************************************************************************
+ * internal function; write event marker, the layout of version 104
+ *****************************************************************************/
+static
+void
+_libeep_evt_write_event_marker(FILE * f, const libeep_evt_event_t * ev) {
+  libeep_evt_GUID_t guid;
+  int32_t           show_amplitude = 0;
+  int8_t            show_duration = 0;
+
+  memset(&guid, 0, sizeof(libeep_evt_GUID_t));
+
+  _libeep_evt_write_class(f, "class dcEventMarker_c");
+  fwrite(&ev->visible_id, sizeof(int32_t), 1, f);
+  fwrite(ev->guid != NULL ? ev->guid : &guid, sizeof(libeep_evt_GUID_t), 1, f);
+  _libeep_evt_write_class(f, NULL);
+  _libeep_evt_write_string(f, ev->unused_name != NULL ? ev->unused_name : "Event Marker");
+  _libeep_evt_write_string(f, ev->unused_user_visible_name);
+  fwrite(&ev->type, sizeof(int32_t), 1, f);
+  fwrite(&ev->state, sizeof(int32_t), 1, f);
+  fwrite(&ev->original, sizeof(int8_t), 1, f);
+  fwrite(&ev->duration, sizeof(double), 1, f);
+  fwrite(&ev->duration_offset, sizeof(double), 1, f);
+  fwrite(&ev->time_stamp.date, sizeof(double), 1, f);
+  fwrite(&ev->time_stamp.fraction, sizeof(double), 1, f);
+  _libeep_evt_write_epoch_descriptors(f, ev);
+  /* channel info */
+  _libeep_evt_write_string(f, NULL);
+  _libeep_evt_write_string(f, NULL);
+  _libeep_evt_write_string(f, ev->description);
+  fwrite(&show_amplitude, sizeof(int32_t), 1, f);
+  fwrite(&show_duration, sizeof(int8_t), 1, f);
+}
+/*****************************************************************************/
+int
+libeep_evt_write(const char * filename, const libeep_evt_t * e) {
+  libeep_evt_header_t  header = e->header;
+  libeep_evt_event_t * ev;
+  uint32_t             length = 0;
+  int                  status;
+  FILE               * f;
+
+  f = fopen(filename, "wb");
+  if(f == NULL) {
+    return -1;
+  }
+
+  header.version = 104;
+  fwrite(&header, sizeof(libeep_evt_header_t), 1, f);
+  _libeep_evt_write_class(f, "class dcEventsLibrary_c");
+  _libeep_evt_write_string(f, NULL);
+  for(ev = e->evt_list_first; ev != NULL; ev = ev->next_event) {
+    ++length;
+  }
+  fwrite(&length, sizeof(uint32_t), 1, f);
+  for(ev = e->evt_list_first; ev != NULL; ev = ev->next_event) {
+    _libeep_evt_write_event_marker(f, ev);
+  }
+
+  status = ferror(f) ? -1 : 0;
+  if(fclose(f)) {
+    status = -1;
+  }
+  return status;
+}
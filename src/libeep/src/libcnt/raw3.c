@@ -39,12 +39,20 @@ char RCS_raw3_h[] = RCS_RAW3_H;
 char RCS_raw3_c[] = "$RCSfile: raw3.c,v $ $Revision: 2415 $";
 #endif
 
-/* #ifdef RAW3_CHECK obsolete */
-/* indicator flags for the citical compression methods */
-short ERR_FLAG_16 = 0;
-short ERR_FLAG_0  = 0;
-short ERR_FLAG_EPOCH = 0;
-/* #endif */
+/*
+  the legacy indicator flags for the critical compression methods, kept per
+  thread so that concurrent decoders don't interfere; the flags of a single
+  decoder are in raw3_t (raw3_get_errflags)
+*/
+#if defined(_MSC_VER)
+#define RAW3_THREAD_LOCAL __declspec(thread)
+#else
+#define RAW3_THREAD_LOCAL __thread
+#endif
+
+static RAW3_THREAD_LOCAL short ERR_FLAG_16 = 0;
+static RAW3_THREAD_LOCAL short ERR_FLAG_0  = 0;
+static RAW3_THREAD_LOCAL short ERR_FLAG_EPOCH = 0;
 
 void    raw3_set_ERR_FLAG_16(short n) { ERR_FLAG_16 = n; }
 short   raw3_get_ERR_FLAG_16()        { return ERR_FLAG_16; }
@@ -53,7 +61,8 @@ short   raw3_get_ERR_FLAG_0()        { return ERR_FLAG_0; }
 void    raw3_set_ERR_FLAG_EPOCH(short n) { ERR_FLAG_EPOCH = n; }
 short   raw3_get_ERR_FLAG_EPOCH()        { return ERR_FLAG_EPOCH; }
 
-unsigned char CheckVerbose = 0;
+/* default verbosity of new decoders, set once before creating any */
+static unsigned char CheckVerbose = 0;
 void raw3_setVerbose(int onoff)
 {
     assert(onoff == 0 || onoff == 1);
@@ -76,12 +85,20 @@ void raw3_setVerbose(int onoff)
 #define RAW3_TIME2_32 10
 #define RAW3_CHAN_32  11
 
+#define RAW3_RICE      4  /* flag: residuals adaptive Rice coded (RAW3_CODEC_ADAPTIVE) */
+#define RAW3_TIME_RICE   5
+#define RAW3_TIME2_RICE  6
+#define RAW3_CHAN_RICE   7
+
+#define RAW3_LPC      12  /* linear prediction of the first deviation (file version 5.0) */
+
 /*
   find the number of bits needed to store the passed (signed!) value
 */
 
 int bitc(sraw_t x)
 {
+#if !defined(__GNUC__)
   static int nbits[128] = {
 /*  0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 */
 
@@ -95,12 +112,17 @@ int bitc(sraw_t x)
     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8
   };
+#endif
 
   register int y = x;
 
   /* positive number which needs the same number of bits */
   if (y < 0) y = -(y+1);
 
+#if defined(__GNUC__)
+  /* magnitude bits + sign bit, same result as the table */
+  return y ? 33 - __builtin_clz((unsigned int) y) : 1;
+#else
   if (y < 0x00000080)
     return nbits[y];
   else if (y < 0x00008000)
@@ -109,6 +131,7 @@ int bitc(sraw_t x)
     return nbits[y >> 16] + 16;
   else
     return  nbits[y >> 24] + 24;
+#endif
 }
 
 int huffman_size(int *bitfreq, int n, int *nbits, int *nexcbits)
@@ -327,7 +350,7 @@ int huffman(sraw_t *in, int n, int method, int nbits, int nexcbits,
   return nout;
 }
 
-int dehuffman16(unsigned char *in, int n, int *method, sraw_t *out)
+int dehuffman16(raw3_t *raw3, unsigned char *in, int n, int *method, sraw_t *out)
 {
   int  nin = 0, nout = 0;
   int  nbit, nbit_1, nexcbit, nexcbit_1, check_exc;
@@ -381,10 +404,11 @@ int dehuffman16(unsigned char *in, int n, int *method, sraw_t *out)
     /* using 4-bit coding nbit=16 is coded as zero */
     if (nbit == 0) {
       nbit = 16;
-      if( CheckVerbose ) {
+      if( raw3->verbose ) {
          fprintf(stderr,"\nlibeep: critical compression method encountered "
                      "(method %d, 16 bit)\n", *method);
        }
+      raw3->errflags |= RAW3_ERR_16;
       raw3_set_ERR_FLAG_16(1); 	 		
     } 		
     nbit_1 = nbit - 1;
@@ -493,10 +517,11 @@ int dehuffman16(unsigned char *in, int n, int *method, sraw_t *out)
   }
   /* RAW3_COPY mode */
   else {
-    if( CheckVerbose ) {	
+    if( raw3->verbose ) {	
          fprintf(stderr,"\nlibeep: critical compression method encountered "
                    "(method 0 RAW3_COPY)\n");	
      }	
+    raw3->errflags |= RAW3_ERR_COPY;
     raw3_set_ERR_FLAG_0(0);
     nin = 1;
     for (nout = 0; nout < n; nout++) {
@@ -653,15 +678,479 @@ int dehuffman32(unsigned char *in, int n, int *method, sraw_t *out)
   return nin;
 }
 
-int dehuffman(unsigned char *in, int n, int *method, sraw_t *out)
+/* --------------------------------------------------------------------
+  adaptive Rice coded data vectors (RAW3_CODEC_ADAPTIVE only)
+
+  ..._RICE:       | method | dummy | k0 | x[0] | x[1] .. x[n-1]
+                      4        4      8    32    adaptive Rice codes
+
+  residuals are mapped to unsigned (zigzag) and stored as u >> k in unary
+  (ones, terminated by a zero) followed by the k low bits of u; k follows
+  the running mean of u, which starts at 2^k0 and is halved every
+  RAW3_RICE_WINDOW values. A unary part of RAW3_RICE_QMAX ones is an
+  escape, u follows in 32 bits.
+*/
+
+#define RAW3_RICE_QMAX   24
+#define RAW3_RICE_WINDOW 16
+
+typedef struct {
+  uint64_t sum;   /* running sum of u        */
+  uint32_t cnt;   /* values in the sum       */
+  int      k;     /* current Rice parameter  */
+} rice_state_t;
+
+static void rice_init(rice_state_t *st, int k0)
+{
+  st->sum = (uint64_t) 1 << k0;
+  st->cnt = 1;
+  st->k = k0;
+}
+
+static void rice_update(rice_state_t *st, uint32_t u)
+{
+  int k = 0;
+
+  st->sum += u;
+  if (++st->cnt >= RAW3_RICE_WINDOW) {
+    st->sum >>= 1;
+    st->cnt >>= 1;
+  }
+  /* smallest k with cnt * 2^k >= sum */
+  while (((uint64_t) st->cnt << k) < st->sum && k < 31)
+    k++;
+  st->k = k;
+}
+
+#define RAW3_ZIGZAG(r)   (((uint32_t) (r) << 1) ^ (uint32_t) ((r) >> 31))
+#define RAW3_UNZIGZAG(u) ((sraw_t) (((u) >> 1) ^ (0U - ((u) & 1))))
+
+/* compressed size in bytes of residuals res[1..n-1], the start k0 is returned */
+static int rice_size(sraw_t *res, int n, int *k0)
+{
+  rice_state_t st;
+  uint64_t sum = 0, bits = 0;
+  uint32_t u, q;
+  int sample;
+
+  for (sample = 1; sample < n; sample++)
+    sum += RAW3_ZIGZAG(res[sample]);
+  for (*k0 = 0; ((uint64_t) (n - 1) << *k0) < sum && *k0 < 31; (*k0)++)
+    ;
+
+  rice_init(&st, *k0);
+  for (sample = 1; sample < n; sample++) {
+    u = RAW3_ZIGZAG(res[sample]);
+    q = u >> st.k;
+    bits += q < RAW3_RICE_QMAX ? q + 1 + st.k : RAW3_RICE_QMAX + 32;
+    rice_update(&st, u);
+  }
+
+  return 6 + (int) ((bits + 7) >> 3);
+}
+
+/* append the nbits (<= 32) low bits of x to the output */
+#define RICE_PUT(x, nbits) \
+  do { \
+    acc = (acc << (nbits)) | ((uint64_t) (x) & (((uint64_t) 1 << (nbits)) - 1)); \
+    nacc += (nbits); \
+    while (nacc >= 8) { \
+      nacc -= 8; \
+      out[nout++] = (unsigned char) (acc >> nacc); \
+    } \
+  } while (0)
+
+static int huffman_rice(sraw_t *in, int n, int method, int k0, unsigned char *out)
+{
+  rice_state_t st;
+  uint64_t acc = 0;
+  int nacc = 0, nout, nin;
+  uint32_t u, q;
+
+  out[0] = (unsigned char) ((RAW3_RICE | (method & 0x03)) << 4);
+  out[1] = (unsigned char) k0;
+  out[2] = in[0] >> 24;
+  out[3] = in[0] >> 16;
+  out[4] = in[0] >>  8;
+  out[5] = in[0];
+  nout = 6;
+
+  rice_init(&st, k0);
+  for (nin = 1; nin < n; nin++) {
+    u = RAW3_ZIGZAG(in[nin]);
+    q = u >> st.k;
+    if (q < RAW3_RICE_QMAX) {
+      RICE_PUT(((1U << q) - 1) << 1, q + 1);
+      if (st.k)
+        RICE_PUT(u, st.k);
+    }
+    else {
+      RICE_PUT((1U << RAW3_RICE_QMAX) - 1, RAW3_RICE_QMAX);
+      RICE_PUT(u, 32);
+    }
+    rice_update(&st, u);
+  }
+
+  /* don't forget to write the last bits */
+  if (nacc)
+    out[nout++] = (unsigned char) (acc << (8 - nacc));
+
+  return nout;
+}
+
+/* take the next nbits (<= 32) bits of the input */
+#define RICE_GET(x, nbits) \
+  do { \
+    while (nacc < (nbits)) { \
+      acc = (acc << 8) | in[nin++]; \
+      nacc += 8; \
+    } \
+    nacc -= (nbits); \
+    (x) = (uint32_t) ((acc >> nacc) & (((uint64_t) 1 << (nbits)) - 1)); \
+  } while (0)
+
+static int dehuffman_rice(unsigned char *in, int n, int *method, sraw_t *out)
 {
-  /* method bit 3 indicates 16 or 32 bit compression */
-  if (in[0] & (unsigned char) 0x80) {
+  rice_state_t st;
+  uint64_t acc = 0;
+  int nacc = 0, nin, nout;
+  uint32_t u, q, bit;
+
+  *method = (in[0] >> 4) & 0x03;
+  rice_init(&st, in[1] & 0x1f);
+  out[0] =   ((sraw_t) in[2] << 24)
+           | ((sraw_t) in[3] << 16)
+           | ((sraw_t) in[4] <<  8)
+           | ((sraw_t) in[5]);
+  nin = 6;
+
+  for (nout = 1; nout < n; nout++) {
+    for (q = 0; q < RAW3_RICE_QMAX; q++) {
+      RICE_GET(bit, 1);
+      if (!bit)
+        break;
+    }
+    if (q < RAW3_RICE_QMAX) {
+      u = q << st.k;
+      if (st.k) {
+        RICE_GET(bit, st.k);
+        u |= bit;
+      }
+    }
+    else {
+      RICE_GET(u, 32);
+    }
+    out[nout] = RAW3_UNZIGZAG(u);
+    rice_update(&st, u);
+  }
+
+  return nin;
+}
+
+/*
+  replace the block at out (length bytes) by the adaptive Rice coded
+  residuals of method index mfirst..mlast if one of them is smaller
+  return: the resulting block length
+*/
+static int compchan_rice(raw3_t *raw3, int n, int mfirst, int mlast, char *out, int length)
+{
+  int mi, size, k0, best = -1, bestk0 = 0;
+
+  for (mi = mfirst; mi <= mlast; mi++) {
+    size = rice_size(raw3->rc[mi].res, n, &k0);
+    if (size < length) {
+      length = size;
+      best = mi;
+      bestk0 = k0;
+    }
+  }
+  if (best >= 0)
+    huffman_rice(raw3->rc[best].res, n, raw3->rc[best].method, bestk0,
+                 (unsigned char *) out);
+
+  return length;
+}
+
+int dehuffman(raw3_t *raw3, unsigned char *in, int n, int *method, sraw_t *out)
+{
+  /* method bit 3 indicates 16 or 32 bit compression, bit 2 Rice coding */
+  if ((in[0] & (unsigned char) 0xc0) == (RAW3_RICE << 4)) {
+    return dehuffman_rice(in, n, method, out);
+  }
+  else if (in[0] & (unsigned char) 0x80) {
     return dehuffman32(in, n, method, out);
   }
   else {
-    return dehuffman16(in, n, method, out);
+    return dehuffman16(raw3, in, n, method, out);
+  }
+}
+
+/* --------------------------------------------------------------------
+  linear prediction data vectors (file version 5.0, see cnt_version.h)
+
+  LPC:            | method | order | shift | c[1] .. c[order] | block
+                      4        4       8      16 each          TIME, TIME_32 or TIME_RICE
+
+  the first deviations d[i] = x[i] - x[i-1] are predicted by
+  (c[1] d[i-1] + .. + c[order] d[i-order] + 2^(shift-1)) >> shift;
+  block is a complete residual vector of its own method, it starts with
+  x[0] and the first order residuals are plain first deviations
+*/
+
+#define RAW3_LPC_ORDER_MIN 3
+#define RAW3_LPC_ORDER_MAX 8
+#define RAW3_LPC_SHIFT_MAX 14
+#define RAW3_LPC_HEADER(order) (2 + 2 * (order))
+
+/* predicted first deviation at x[0], from the deviations before it */
+static int64_t lpc_predict(const short *coef, int order, int shift, const sraw_t *x)
+{
+  int64_t acc = shift ? (int64_t) 1 << (shift - 1) : 0;
+  int j;
+
+  for (j = 1; j <= order; j++)
+    acc += coef[j - 1] * ((int64_t) x[-j] - x[-j - 1]);
+
+  return acc >> shift;
+}
+
+/* residuals (modulo 2^32, like the decoder) and their bit distribution */
+static void lpc_residuals(const short *coef, int order, int shift,
+                          const sraw_t *cur, int n, sraw_t *res, int *hst)
+{
+  int sample;
+
+  memset(hst, 0, 33 * sizeof(int));
+  res[0] = cur[0];
+  for (sample = 1; sample <= order; sample++)
+    hst[bitc(res[sample] = (sraw_t) ((uint32_t) cur[sample] - (uint32_t) cur[sample - 1]))]++;
+  for (; sample < n; sample++)
+    hst[bitc(res[sample] = (sraw_t) (uint32_t) ((int64_t) cur[sample] - cur[sample - 1]
+                           - lpc_predict(coef, order, shift, &cur[sample])))]++;
+}
+
+/*
+  replace the block at out (length bytes) by a linear prediction block if
+  one of the orders RAW3_LPC_ORDER_MIN..RAW3_LPC_ORDER_MAX makes it smaller;
+  *res is set to its residuals then
+  return: the resulting block length
+*/
+static int compchan_lpc(raw3_t *raw3, sraw_t *cur, int n, char *out, int length, sraw_t **res)
+{
+  double r[RAW3_LPC_ORDER_MAX + 1], a[RAW3_LPC_ORDER_MAX + 1], tmp[RAW3_LPC_ORDER_MAX + 1];
+  double err, k, amax;
+  short coef[RAW3_LPC_ORDER_MAX], bestcoef[RAW3_LPC_ORDER_MAX];
+  int hst[33];
+  int order, shift, sample, j, size, nbits, nexcbits, k0, wide;
+  int bestorder = 0, bestshift = 0, bestnbits = 0, bestnexcbits = 0, bestk0 = -1, bestwide = 0;
+  int bestsize = length;
+  unsigned char *block = (unsigned char *) raw3->lpcout;
+  sraw_t *swap;
+
+  if (n <= 2 * RAW3_LPC_ORDER_MAX)
+    return length;
+
+  /* autocorrelation of the first deviations */
+  for (j = 0; j <= RAW3_LPC_ORDER_MAX; j++) {
+    r[j] = 0;
+    for (sample = j + 1; sample < n; sample++)
+      r[j] += ((double) cur[sample] - cur[sample - 1])
+            * ((double) cur[sample - j] - cur[sample - j - 1]);
+  }
+  if (r[0] <= 0)
+    return length;
+
+  /* Levinson-Durbin recursion, a[1..order] is the predictor of each order */
+  err = r[0];
+  for (order = 1; order <= RAW3_LPC_ORDER_MAX; order++) {
+    k = r[order];
+    for (j = 1; j < order; j++)
+      k -= a[j] * r[order - j];
+    k /= err;
+    for (j = 1; j < order; j++)
+      tmp[j] = a[j] - k * a[order - j];
+    for (j = 1; j < order; j++)
+      a[j] = tmp[j];
+    a[order] = k;
+    err *= 1 - k * k;
+    if (err <= 0)
+      break;
+    if (order < RAW3_LPC_ORDER_MIN)
+      continue;
+
+    /* quantize with the finest step that fits 16 bits */
+    amax = 0;
+    for (j = 1; j <= order; j++)
+      if (fabs(a[j]) > amax)
+        amax = fabs(a[j]);
+    for (shift = RAW3_LPC_SHIFT_MAX; shift > 0 && amax * (1 << shift) > 32767; shift--)
+      ;
+    if (amax * (1 << shift) > 32767)
+      break;
+    for (j = 1; j <= order; j++)
+      coef[j - 1] = (short) floor(a[j] * (1 << shift) + 0.5);
+
+    lpc_residuals(coef, order, shift, cur, n, raw3->lpcres[0], hst);
+    size = huffman_size(hst, n - 1, &nbits, &nexcbits);
+    if (nbits >= 32)
+      continue;
+    wide = nexcbits >= 16 || raw3->lpcres[0][0] < -32768 || raw3->lpcres[0][0] >= 32768;
+    size += RAW3_LPC_HEADER(order) + (wide ? 6 : 3);
+    k0 = -1;
+    if (RAW3_CODEC_ADAPTIVE == raw3->codec) {
+      j = RAW3_LPC_HEADER(order) + rice_size(raw3->lpcres[0], n, &k0);
+      if (j < size)
+        size = j;
+      else
+        k0 = -1;
+    }
+
+    if (size < bestsize) {
+      bestsize = size;
+      bestorder = order;
+      bestshift = shift;
+      bestnbits = nbits;
+      bestnexcbits = nexcbits;
+      bestk0 = k0;
+      bestwide = wide;
+      memcpy(bestcoef, coef, order * sizeof(short));
+      swap = raw3->lpcres[0]; raw3->lpcres[0] = raw3->lpcres[1]; raw3->lpcres[1] = swap;
+    }
+  }
+  if (!bestorder)
+    return length;
+
+  /* the sizes were estimated, build the block aside and check */
+  block[0] = (unsigned char) ((RAW3_LPC << 4) | bestorder);
+  block[1] = (unsigned char) bestshift;
+  for (j = 0; j < bestorder; j++) {
+    block[2 + 2 * j] = (unsigned char) (bestcoef[j] >> 8);
+    block[3 + 2 * j] = (unsigned char) bestcoef[j];
+  }
+  size = RAW3_LPC_HEADER(bestorder);
+  if (bestk0 >= 0)
+    size += huffman_rice(raw3->lpcres[1], n, RAW3_TIME, bestk0, &block[size]);
+  else
+    size += huffman(raw3->lpcres[1], n, bestwide ? RAW3_TIME_32 : RAW3_TIME,
+                    bestnbits, bestnexcbits, &block[size]);
+  if (size >= length)
+    return length;
+
+  memcpy(out, block, size);
+  *res = raw3->lpcres[1];
+  return size;
+}
+
+static int decompchan_lpc(raw3_t *raw3, sraw_t *cur, int n, unsigned char *in)
+{
+  short coef[15];
+  int order = in[0] & 0x0f, shift = in[1] & 0x1f;
+  int method, sample, j, length;
+  sraw_t *res = raw3->rc[0].res;
+
+  for (j = 0; j < order; j++)
+    coef[j] = (short) ((in[2 + 2 * j] << 8) | in[3 + 2 * j]);
+  length = RAW3_LPC_HEADER(order);
+  length += dehuffman(raw3, &in[length], n, &method, res);
+
+  cur[0] = res[0];
+  for (sample = 1; sample < n && sample <= order; sample++)
+    cur[sample] = (sraw_t) ((uint32_t) cur[sample - 1] + (uint32_t) res[sample]);
+  for (; sample < n; sample++)
+    cur[sample] = (sraw_t) ((uint32_t) cur[sample - 1] + (uint32_t) res[sample]
+                            + (uint32_t) lpc_predict(coef, order, shift, &cur[sample]));
+
+  return length;
+}
+
+/*
+  store the residuals of the selected method, or the raw values if that
+  is not worth it
+*/
+static int compchan_emit(raw3res_t *rc, sraw_t *cur, int n, int lmin, char *out)
+{
+  int short_method = RAW3_COPY;
+
+  /* need 32 bit storage ? */
+  if (rc->nexcbits >= 16 || rc->res[0] < -32768 || rc->res[0] >= 32768 )
+  {
+    rc->method |= 0x08;
+    short_method = RAW3_COPY_32;
+  }
+  /* is the best compression better than store only ? */
+  if (rc->nbits < 32 && lmin + 3 < n * 4)
+    return huffman(rc->res, n, rc->method, rc->nbits, rc->nexcbits,
+                   (unsigned char *) out);
+  else
+    return huffman(cur, n, short_method, 0, 0,
+                   (unsigned char *) out);
+}
+
+/*
+  residual of sample (>= 1) for residual method index mi (0: TIME,
+  1: TIME2, 2: CHAN), same arithmetic as compchan
+*/
+#define RAW3_RESIDUAL(mi, last, cur, sample) \
+  ((mi) == 0 ? (cur)[sample] - (cur)[(sample) - 1] : \
+   (mi) == 1 ? ((sample) == 1 ? (cur)[1] - (cur)[0] : \
+                (cur)[sample] - (cur)[(sample) - 1] - ((cur)[(sample) - 1] - (cur)[(sample) - 2])) : \
+               (cur)[sample] - (cur)[(sample) - 1] - (last)[sample] + (last)[(sample) - 1])
+
+static const int raw3_methods[RAW3_METHODC] = { RAW3_TIME, RAW3_TIME2, RAW3_CHAN };
+
+/*
+  reduced effort variant of compchan: the method index *mi is either taken
+  as it is (>= 0) or estimated from every RAW3_FAST_STRIDE'th residual
+  (< 0); only the residuals of that method are calculated in full
+*/
+#define RAW3_FAST_STRIDE 8
+
+static int compchan_fast(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *out, int *mi)
+{
+  int m, sample, count, lmin, nbits, nexcbits;
+  int hst[33];
+  raw3res_t *rc;
+  sraw_t *res;
+
+  if (*mi < 0) {
+    lmin = 1000000000;
+    for (m = 0; m < RAW3_METHODC; m++) {
+      memset(hst, 0, 33 * sizeof(int));
+      count = 0;
+      for (sample = 1; sample < n; sample += RAW3_FAST_STRIDE) {
+        hst[bitc(RAW3_RESIDUAL(m, last, cur, sample))]++;
+        count++;
+      }
+      count = huffman_size(hst, count, &nbits, &nexcbits);
+      if (count < lmin) {
+        lmin = count;
+        *mi = m;
+      }
+    }
+  }
+
+  rc = &raw3->rc[*mi];
+  res = rc->res;
+  rc->method = raw3_methods[*mi];
+  memset(rc->hst, 0, 33 * sizeof(int));
+  res[0] = cur[0];
+  switch (*mi) {
+    case 0:
+      for (sample = 1; sample < n; sample++)
+        rc->hst[bitc(res[sample] = RAW3_RESIDUAL(0, last, cur, sample))]++;
+      break;
+    case 1:
+      for (sample = 1; sample < n; sample++)
+        rc->hst[bitc(res[sample] = RAW3_RESIDUAL(1, last, cur, sample))]++;
+      break;
+    default:
+      for (sample = 1; sample < n; sample++)
+        rc->hst[bitc(res[sample] = RAW3_RESIDUAL(2, last, cur, sample))]++;
+      break;
   }
+  rc->length = huffman_size(rc->hst, n - 1, &rc->nbits, &rc->nexcbits);
+
+  return compchan_emit(rc, cur, n, rc->length, out);
 }
 
 /* ---------------------------------------------------------------------
@@ -670,9 +1159,17 @@ int dehuffman(unsigned char *in, int n, int *method, sraw_t *out)
   find the best among them and compress
   write the compressed output to buffer
 */
+static int compchan_all(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *out, int *imin_out);
+
 int compchan(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *out)
 {
-  int i, imin, mi, short_method = RAW3_COPY;
+  int imin;
+  return compchan_all(raw3, last, cur, n, out, &imin);
+}
+
+static int compchan_all(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *out, int *imin_out)
+{
+  int i, imin = 0, mi, short_method = RAW3_COPY;
   int sample;
   int lmin, length;
   raw3res_t *rc;
@@ -752,24 +1249,9 @@ int compchan(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *out)
       }
     }
     rc = &raw3->rc[imin];
-
-    /* need 32 bit storage ? */
-    if (rc->nexcbits >= 16 || rc->res[0] < -32768 || rc->res[0] >= 32768 )
-    {
-      rc->method |= 0x08;
-      short_method = RAW3_COPY_32;
-    }
-    /* is the best compression better than store only ? */
-    if (rc->nbits < 32 && lmin + 3 < n * 4) {
-      length = huffman(rc->res, n, rc->method, rc->nbits, rc->nexcbits,
-        	        (unsigned char *) out);
-      short_method = -1;
-     }
-    else
-      length = huffman(cur, n, short_method, 0, 0,
-        	        (unsigned char *) out);
-
+    length = compchan_emit(rc, cur, n, lmin, out);
   }
+  *imin_out = imin;
 
  /*
   if(short_method < 0)
@@ -787,9 +1269,13 @@ int decompchan(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *in)
   int length;
   sraw_t *res = raw3->rc[0].res;
 
+  /* linear prediction restores the values itself */
+  if (((unsigned char) in[0] >> 4) == RAW3_LPC)
+    return decompchan_lpc(raw3, cur, n, (unsigned char *) in);
+
   /* restore the residuals */
 
-  length = dehuffman((unsigned char *) in, n, &method, res);
+  length = dehuffman(raw3, (unsigned char *) in, n, &method, res);
 
   /* build the values using residuals and method */
 
@@ -839,6 +1325,65 @@ int decompchan(raw3_t *raw3, sraw_t *last, sraw_t *cur, int n, char *in)
   return length;
 }
 
+/*
+  account one compressed channel block (header as written by huffman)
+  res are the residuals of the block, exceptions are counted from them
+*/
+static void raw3_stat_block(raw3_chanstat_t *st, unsigned char *block,
+                            int n, int length, sraw_t *res)
+{
+  int method = (block[0] >> 4) & 0x0f;
+  int nbits, nexcbits, sample;
+  sraw_t loval, hival;
+
+  st->blockc++;
+  st->samplec += n;
+  st->bytes += length;
+  st->methodc[method]++;
+
+  /* linear prediction, the residuals follow as a block of their own */
+  if (method == RAW3_LPC) {
+    block += RAW3_LPC_HEADER(block[0] & 0x0f);
+    method = (block[0] >> 4) & 0x0f;
+  }
+
+  if (method == RAW3_COPY || method == RAW3_COPY_32)
+    return;
+
+  /* Rice coded, nbits is the start parameter, there are no exceptions */
+  if ((method & 0x0c) == RAW3_RICE) {
+    nbits = block[1] & 0x1f;
+    st->nbits += nbits;
+    if (nbits > st->nbits_max) st->nbits_max = nbits;
+    return;
+  }
+
+  if (method & 0x08) {
+    nbits = ((block[0] << 2) & 0x3c) | ((block[1] >> 6) & 0x03);
+    nexcbits = block[1] & 0x3f;
+  }
+  else {
+    /* 4-bit coding, 16 is coded as zero */
+    nbits = block[0] & 0x0f;
+    if (nbits == 0) nbits = 16;
+    nexcbits = (block[1] >> 4) & 0x0f;
+    if (nexcbits == 0) nexcbits = 16;
+  }
+  st->nbits += nbits;
+  st->nexcbits += nexcbits;
+  if (nbits > st->nbits_max) st->nbits_max = nbits;
+  if (nexcbits > st->nexcbits_max) st->nexcbits_max = nexcbits;
+
+  /* same range check as huffman */
+  if (nbits != nexcbits && nbits < 32) {
+    hival = (sraw_t) 1 << (nbits - 1);
+    loval = -hival;
+    for (sample = 1; sample < n; sample++)
+      if (res[sample] <= loval || res[sample] >= hival)
+        st->excc++;
+  }
+}
+
 int compepoch_mux(raw3_t *raw3, sraw_t *in, int length, char *out)
 {
   int chan;
@@ -847,10 +1392,17 @@ int compepoch_mux(raw3_t *raw3, sraw_t *in, int length, char *out)
   int samplepos;
   int outsize = 0, outsizealt;
 
+  int mi, refresh;
+  sraw_t *res;
+
   cur = raw3->cur;
   last = raw3->last;
   memset(last, 0, length * sizeof(sraw_t));
 
+  /* with RAW3_LEVEL_REUSE the choice is renewed every RAW3_REUSE_EPOCHS */
+  refresh = raw3->level != RAW3_LEVEL_REUSE || raw3->epochc % RAW3_REUSE_EPOCHS == 0;
+  raw3->epochc++;
+
   for (chan = 0; chan < raw3->chanc; chan++) {
 
     /* extract one vector from MUX buffer */
@@ -862,8 +1414,40 @@ int compepoch_mux(raw3_t *raw3, sraw_t *in, int length, char *out)
     }
     /* calculate compression and its statistics */
     outsizealt = outsize;
-    outsize += compchan(raw3, last, cur, length, &out[outsize]);
-    decompchan(raw3,last,cur,length,&out[outsizealt]);
+    if (RAW3_LEVEL_EXHAUSTIVE == raw3->level) {
+      outsize += compchan(raw3, last, cur, length, &out[outsize]);
+      if (RAW3_CODEC_ADAPTIVE == raw3->codec && length >= 8)
+        outsize = outsizealt + compchan_rice(raw3, length, 0, RAW3_METHODC - 1,
+                                             &out[outsizealt], outsize - outsizealt);
+      decompchan(raw3,last,cur,length,&out[outsizealt]);
+      res = raw3->rc[0].res;
+    }
+    else if (length < 8) {
+      outsize += compchan(raw3, last, cur, length, &out[outsize]);
+      res = cur;
+    }
+    else if (refresh && RAW3_LEVEL_REUSE == raw3->level) {
+      outsize += compchan_all(raw3, last, cur, length, &out[outsize], &mi);
+      raw3->methodv[chan] = mi;
+      res = raw3->rc[mi].res;
+      if (RAW3_CODEC_ADAPTIVE == raw3->codec)
+        outsize = outsizealt + compchan_rice(raw3, length, 0, RAW3_METHODC - 1,
+                                             &out[outsizealt], outsize - outsizealt);
+    }
+    else {
+      mi = RAW3_LEVEL_REUSE == raw3->level ? raw3->methodv[chan] : -1;
+      outsize += compchan_fast(raw3, last, cur, length, &out[outsize], &mi);
+      res = raw3->rc[mi].res;
+      if (RAW3_CODEC_ADAPTIVE == raw3->codec)
+        outsize = outsizealt + compchan_rice(raw3, length, mi, mi,
+                                             &out[outsizealt], outsize - outsizealt);
+    }
+    if (raw3->lpc)
+      outsize = outsizealt + compchan_lpc(raw3, cur, length, &out[outsizealt],
+                                          outsize - outsizealt, &res);
+    if (raw3->statv)
+      raw3_stat_block(&raw3->statv[raw3->chanv[chan]], (unsigned char *) &out[outsizealt],
+                      length, outsize - outsizealt, res);
     /* prepare for reading next channel */
     tmp = cur; cur = last; last = tmp;
   }
@@ -877,7 +1461,7 @@ int decompepoch_mux(raw3_t *raw3, char *in, int length, sraw_t *out)
   int sample;
   sraw_t *tmp, *chanbase, *last, *cur;
   int samplepos;
-  int insize = 0;
+  int insize = 0, insizealt;
 
   cur = raw3->cur;
   last = raw3->last;
@@ -886,7 +1470,11 @@ int decompepoch_mux(raw3_t *raw3, char *in, int length, sraw_t *out)
   for (chan = 0; chan < raw3->chanc; chan++) {
 
     /* uncompress */
+    insizealt = insize;
     insize += decompchan(raw3, last, cur, length, &in[insize]);
+    if (raw3->statv)
+      raw3_stat_block(&raw3->statv[raw3->chanv[chan]], (unsigned char *) &in[insizealt],
+                      length, insize - insizealt, raw3->rc[0].res);
 
     /* mangle into MUX buffer */
     chanbase = &out[raw3->chanv[chan]];
@@ -971,6 +1559,79 @@ void compchanv_mux(sraw_t *buf, int length,
   free((char *) rvv);
 }
 
+void compchanv_mux_sampled(sraw_t *buf, int length,
+                           short chanc, short *chanv, int maxsamples)
+{
+  int chan, i, j, jmin, k, m;
+  double *dv, *norm, *di, *dj, dot, d, dmin;
+  char *used;
+
+  if (length < 2 || chanc < 2) {
+    for (chan = 0; chan < chanc; chan++)
+      chanv[chan] = chan;
+    return;
+  }
+
+  /* RAW3_CHAN predicts the first deviation from the neighbors one,
+     so compare channels by the distance of their first deviations;
+     a subsample of them is enough to rank the neighbors */
+  m = length - 1;
+  if (maxsamples > 0 && m > maxsamples)
+    m = maxsamples;
+
+  /* first deviations in channel major order, contiguous for the dot products */
+  dv = (double *) malloc((size_t) chanc * m * sizeof(double));
+  norm = (double *) malloc(chanc * sizeof(double));
+  used = (char *) calloc(chanc, 1);
+  if (!dv || !norm || !used) {
+    /* the channel order only affects the file size, keep it unchanged */
+    for (chan = 0; chan < chanc; chan++)
+      chanv[chan] = chan;
+    free(used);
+    free(norm);
+    free(dv);
+    return;
+  }
+  for (i = 0; i < chanc; i++) {
+    di = &dv[(size_t) i * m];
+    norm[i] = 0.0;
+    for (k = 0; k < m; k++) {
+      j = 1 + (int) ((double) k * (length - 1) / m);
+      di[k] = (double) buf[i + chanc * j] - (double) buf[i + chanc * (j - 1)];
+      norm[i] += di[k] * di[k];
+    }
+  }
+
+  /* greedy path, always continue with the closest unused channel */
+  chanv[0] = 0;
+  used[0] = 1;
+  for (chan = 1; chan < chanc; chan++) {
+    i = chanv[chan - 1];
+    di = &dv[(size_t) i * m];
+    dmin = -1.0;
+    jmin = 0;
+    for (j = 0; j < chanc; j++) {
+      if (used[j])
+        continue;
+      dj = &dv[(size_t) j * m];
+      dot = 0.0;
+      for (k = 0; k < m; k++)
+        dot += di[k] * dj[k];
+      d = norm[i] + norm[j] - 2.0 * dot;
+      if (dmin < 0.0 || d < dmin) {
+        dmin = d;
+        jmin = j;
+      }
+    }
+    chanv[chan] = jmin;
+    used[jmin] = 1;
+  }
+
+  free(used);
+  free(norm);
+  free(dv);
+}
+
 raw3_t *raw3_init(int chanc, short *chanv, uint64_t length)
 {
   int i;
@@ -981,13 +1642,25 @@ raw3_t *raw3_init(int chanc, short *chanv, uint64_t length)
 
   raw3->chanc = chanc;
   raw3->chanv = (short *) malloc(chanc * sizeof(sraw_t));
+  raw3->level = RAW3_LEVEL_EXHAUSTIVE;
+  raw3->epochc = 0;
+  raw3->methodv = (int *) calloc(chanc, sizeof(int));
+  raw3->statv = NULL;
+  raw3->codec = RAW3_CODEC_FIXED;
+  raw3->lpc = 0;
+  raw3->verbose = CheckVerbose;
+  raw3->errflags = 0;
 
   for (i = 0; i < 3; i++)
     raw3->rc[i].res = (sraw_t *) malloc(length * sizeof(sraw_t));
   raw3->last = (sraw_t *) malloc(length * sizeof(sraw_t));
   raw3->cur = (sraw_t *) malloc(length * sizeof(sraw_t));
+  raw3->length = length;
+  /* allocated by raw3_set_lpc, only encoders trying predictors need them */
+  raw3->lpcres[0] = raw3->lpcres[1] = NULL;
+  raw3->lpcout = NULL;
 
-  if (!raw3->cur || !raw3->last || !raw3->chanv) {
+  if (!raw3->cur || !raw3->last || !raw3->chanv || !raw3->methodv) {
     raw3_free(raw3);
     return NULL;
   }
@@ -996,16 +1669,71 @@ raw3_t *raw3_init(int chanc, short *chanv, uint64_t length)
   return raw3;
 }
 
+void raw3_set_level(raw3_t *raw3, int level)
+{
+  raw3->level = level;
+  raw3->epochc = 0;
+}
+
+void raw3_set_codec(raw3_t *raw3, int codec)
+{
+  raw3->codec = codec;
+}
+
+void raw3_set_verbose(raw3_t *raw3, int onoff)
+{
+  raw3->verbose = onoff;
+}
+
+int raw3_get_errflags(raw3_t *raw3)
+{
+  return raw3->errflags;
+}
+
+void raw3_clear_errflags(raw3_t *raw3)
+{
+  raw3->errflags = 0;
+}
+
+int raw3_set_lpc(raw3_t *raw3, int enable)
+{
+  int i;
+
+  if (enable && !raw3->lpcout) {
+    for (i = 0; i < 2; i++)
+      if (!raw3->lpcres[i])
+        raw3->lpcres[i] = (sraw_t *) malloc(raw3->length * sizeof(sraw_t));
+    /* a block can exceed the estimate, up to 64 bits per sample with exceptions */
+    if (raw3->lpcres[0] && raw3->lpcres[1])
+      raw3->lpcout = (char *) malloc(8 * raw3->length + RAW3_LPC_HEADER(RAW3_LPC_ORDER_MAX) + 8);
+    if (!raw3->lpcout) {
+      raw3->lpc = 0;
+      return 1;
+    }
+  }
+  raw3->lpc = enable;
+  return 0;
+}
+
+void raw3_set_stats(raw3_t *raw3, raw3_chanstat_t *statv)
+{
+  raw3->statv = statv;
+}
+
 void    raw3_free(raw3_t *raw3)
 {
   int i;
 
   if (raw3) {
     if (raw3->chanv) free(raw3->chanv);
+    if (raw3->methodv) free(raw3->methodv);
     for (i = 0; i < 3; i++)
       if (raw3->rc[i].res) free(raw3->rc[i].res);
     if (raw3->last) free(raw3->last);
     if (raw3->cur) free(raw3->cur);
+    for (i = 0; i < 2; i++)
+      if (raw3->lpcres[i]) free(raw3->lpcres[i]);
+    if (raw3->lpcout) free(raw3->lpcout);
     free(raw3);
   }
 }
@@ -132,6 +132,7 @@ rej_t *rej_init(void)
   rej_t *rej = (rej_t *) v_malloc(sizeof(rej_t), "rej");
   rej->v = NULL;
   rej->c = 0;
+  rej->cursor = 0;
   return rej;
 }
 
@@ -262,11 +263,11 @@ void rej_get(rej_t *rej, int i, uint64_t *start, uint64_t *length)
 int is_rejected(rej_t *rej, uint64_t sample)
 {
   int r = 0;
-  static int i = 0;
+  int i = rej->cursor;
   int rejc =   rej->c;
   rejentry_t *rejv = rej->v;
   
-  /* have to rewind the static counter ? */
+  /* have to rewind the counter ? */
   if (i >= rejc) 
     i=0;   /* added M.G.*/
   
@@ -281,6 +282,7 @@ int is_rejected(rej_t *rej, uint64_t sample)
   if (i < rejc && rejv[i].start <= sample)
     r = 1;
   
+  rej->cursor = i;
   return r;
 }
 
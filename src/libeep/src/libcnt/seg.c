@@ -38,6 +38,24 @@ libeep_seg_t * libeep_seg_read(const char * filename) {
   }
   return rv;
 }
+/*
+ * count is one less than the number of segments, the first one starts with
+ * the recording
+ */
+int libeep_seg_write(const char * filename, const libeep_seg_t * s) {
+  FILE * f;
+  int    i;
+
+  f=fopen(filename, "wb");
+  if(f == NULL) {
+    return -1;
+  }
+  fprintf(f, "NumberSegments=%7i\r\n", s->count + 1);
+  for(i=0;i<s->count;++i) {
+    fprintf(f, "%.20e %.20e %u\r\n", s->array[i].date, s->array[i].fraction, s->array[i].sample_count);
+  }
+  return fclose(f) ? -1 : 0;
+}
 /*
  *
  */
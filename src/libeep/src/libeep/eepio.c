@@ -40,6 +40,17 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+
+#if WIN32
+#include <io.h>
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 #include <eep/eepio.h>
 #include <eep/eepmem.h>
@@ -404,6 +415,60 @@ uint64_t eepio_ftell(FILE *stream) {
   return rv;
 }
 
+void * eepio_aligned_malloc(size_t size, size_t alignment) {
+  void *p = NULL;
+#if WIN32
+  p = _aligned_malloc(size, alignment);
+#else
+  if (posix_memalign(&p, alignment, size)) {
+    p = NULL;
+  }
+#endif
+  return p;
+}
+void eepio_aligned_free(void *ptr) {
+#if WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+int eepio_freserve(FILE *stream, uint64_t offset, uint64_t len) {
+#if defined(__linux__)
+  /* only reserve blocks, the data is written later through the stream */
+  return posix_fallocate(fileno(stream), (off_t) offset, (off_t) len);
+#else
+  return 0;
+#endif
+}
+int eepio_ftruncate(FILE *stream, uint64_t length) {
+  if (fflush(stream)) {
+    return -1;
+  }
+#if WIN32
+  return _chsize_s(_fileno(stream), (__int64) length);
+#else
+  return ftruncate(fileno(stream), (off_t) length);
+#endif
+}
+
+uint64_t eepio_clock_ns(void) {
+#if WIN32
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER count;
+  if (freq.QuadPart == 0) {
+    QueryPerformanceFrequency(&freq);
+  }
+  QueryPerformanceCounter(&count);
+  return (uint64_t) (count.QuadPart / freq.QuadPart) * 1000000000
+       + (uint64_t) (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#endif
+}
+
 void eep_print_wrap(FILE* out, const char* text, int len)
 {
   int count;
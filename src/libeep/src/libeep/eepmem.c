@@ -36,6 +36,308 @@ char RCS_eepmem_h[] = RCS_EEPMEM_H;
 char RCS_eepmem_c[] = "$RCSFile: eepmem.c,v $ $Revision: 2415 $";
 #endif
 
+/*
+  allocation accounting: live blocks are kept in an open addressed table
+  keyed by address, each one pointing to the row of its tag and owner.
+  Every (tag, owner) row has three aggregate parent rows, see eepmem.h.
+  All of it is guarded by one lock, which v_release also takes. Disabling
+  the accounting drops every entry, so while it is off the allocation
+  functions read v_mem_enabled without taking the lock and skip it.
+*/
+#if defined(WIN32) && !defined(__CYGWIN__)
+#include <windows.h>
+static SRWLOCK v_mem_lock_ = SRWLOCK_INIT;
+#define v_mem_lock()   AcquireSRWLockExclusive(&v_mem_lock_)
+#define v_mem_unlock() ReleaseSRWLockExclusive(&v_mem_lock_)
+#else
+#include <pthread.h>
+static pthread_mutex_t v_mem_lock_ = PTHREAD_MUTEX_INITIALIZER;
+#define v_mem_lock()   pthread_mutex_lock(&v_mem_lock_)
+#define v_mem_unlock() pthread_mutex_unlock(&v_mem_lock_)
+#endif
+
+#if defined(_MSC_VER)
+#define V_MEM_THREAD_LOCAL __declspec(thread)
+#else
+#define V_MEM_THREAD_LOCAL __thread
+#endif
+
+typedef enum { V_MEM_ALLOC, V_MEM_REALLOC, V_MEM_FREE } v_mem_event_e;
+
+typedef struct {
+  v_mem_stat_t s;
+  int          parent[3];    /* (tag, all), (all, owner), (all, all); -1 for aggregates */
+} v_mem_row_t;
+
+typedef struct {
+  const void *ptr;           /* NULL if the entry is empty */
+  size_t      size;
+  int         row;
+} v_mem_block_t;
+
+static volatile int   v_mem_enabled = 0;
+static unsigned       v_mem_generation = 0; /* bumped when the tables are dropped */
+static v_mem_row_t   *v_mem_rowv = NULL;
+static int            v_mem_rowc = 0;
+static int            v_mem_rowmax = 0;
+static int           *v_mem_rowidx = NULL;  /* row index table, -1 if empty */
+static int            v_mem_rowidxc = 0;    /* power of two */
+static v_mem_block_t *v_mem_blockv = NULL;
+static size_t         v_mem_blockc = 0;
+static size_t         v_mem_blockmax = 0;   /* power of two */
+static V_MEM_THREAD_LOCAL int v_mem_owner = V_MEM_NO_OWNER;
+
+static size_t v_mem_hash_row(const char *tag, int owner)
+{
+  size_t h = 2166136261u;
+
+  if (tag != NULL) {
+    for (; *tag; tag++)
+      h = (h ^ (unsigned char) *tag) * 16777619u;
+  }
+  return (h ^ (size_t) (owner + 2)) * 2654435761u;
+}
+
+static size_t v_mem_hash_ptr(const void *ptr)
+{
+  size_t h = (size_t) ptr;
+  return (h ^ (h >> 17)) * 2654435761u;
+}
+
+static int v_mem_row_is(const v_mem_row_t *row, const char *tag, int owner)
+{
+  if (row->s.owner != owner) return 0;
+  if (row->s.tag == NULL || tag == NULL) return row->s.tag == tag;
+  return !strcmp(row->s.tag, tag);
+}
+
+/* the row of tag and owner, added if new; -1 if out of memory */
+static int v_mem_find_row(const char *tag, int owner)
+{
+  size_t mask, i;
+  int r;
+
+  if (2 * (v_mem_rowc + 1) > v_mem_rowidxc) {
+    int  idxc = v_mem_rowidxc ? 2 * v_mem_rowidxc : 64;
+    int *idx = (int *) malloc(idxc * sizeof(int));
+    if (idx == NULL) return -1;
+    memset(idx, -1, idxc * sizeof(int));
+    for (r = 0; r < v_mem_rowc; r++) {
+      i = v_mem_hash_row(v_mem_rowv[r].s.tag, v_mem_rowv[r].s.owner) & (idxc - 1);
+      while (idx[i] != -1) i = (i + 1) & (idxc - 1);
+      idx[i] = r;
+    }
+    free(v_mem_rowidx);
+    v_mem_rowidx = idx;
+    v_mem_rowidxc = idxc;
+  }
+  mask = v_mem_rowidxc - 1;
+  for (i = v_mem_hash_row(tag, owner) & mask; (r = v_mem_rowidx[i]) != -1; i = (i + 1) & mask) {
+    if (v_mem_row_is(&v_mem_rowv[r], tag, owner)) return r;
+  }
+
+  if (v_mem_rowc == v_mem_rowmax) {
+    int rowmax = v_mem_rowmax ? 2 * v_mem_rowmax : 32;
+    v_mem_row_t *rowv = (v_mem_row_t *) realloc(v_mem_rowv, rowmax * sizeof(v_mem_row_t));
+    if (rowv == NULL) return -1;
+    v_mem_rowv = rowv;
+    v_mem_rowmax = rowmax;
+  }
+  r = v_mem_rowc++;
+  memset(&v_mem_rowv[r], 0, sizeof(v_mem_row_t));
+  v_mem_rowv[r].s.tag = tag;
+  v_mem_rowv[r].s.owner = owner;
+  v_mem_rowv[r].parent[0] = v_mem_rowv[r].parent[1] = v_mem_rowv[r].parent[2] = -1;
+  v_mem_rowidx[i] = r;
+  return r;
+}
+
+/* the row of a block, with its parent rows */
+static int v_mem_block_row(const char *tag, int owner)
+{
+  int r, p0, p1, p2;
+
+  if (tag == NULL) tag = "?";
+  r = v_mem_find_row(tag, owner);
+  if (r == -1 || v_mem_rowv[r].parent[0] != -1) return r;
+  p0 = v_mem_find_row(tag, V_MEM_ALL_OWNERS);
+  p1 = v_mem_find_row(NULL, owner);
+  p2 = v_mem_find_row(NULL, V_MEM_ALL_OWNERS);
+  if (p0 == -1 || p1 == -1 || p2 == -1) return -1;
+  v_mem_rowv[r].parent[0] = p0;
+  v_mem_rowv[r].parent[1] = p1;
+  v_mem_rowv[r].parent[2] = p2;
+  return r;
+}
+
+static void v_mem_update(int row, size_t oldsize, size_t newsize, v_mem_event_e event)
+{
+  v_mem_stat_t *s;
+  int i;
+
+  for (i = -1; i < 3; i++) {
+    s = &v_mem_rowv[i < 0 ? row : v_mem_rowv[row].parent[i]].s;
+    s->live_bytes = s->live_bytes - oldsize + newsize;
+    if (s->peak_bytes < s->live_bytes) s->peak_bytes = s->live_bytes;
+    switch (event) {
+      case V_MEM_ALLOC:   s->allocations++; s->live_blocks++; break;
+      case V_MEM_REALLOC: s->reallocations++; break;
+      case V_MEM_FREE:    s->frees++; s->live_blocks--; break;
+    }
+  }
+}
+
+static v_mem_block_t *v_mem_find_block(const void *ptr)
+{
+  size_t mask = v_mem_blockmax - 1, i;
+
+  if (v_mem_blockc == 0) return NULL;
+  for (i = v_mem_hash_ptr(ptr) & mask; v_mem_blockv[i].ptr != NULL; i = (i + 1) & mask) {
+    if (v_mem_blockv[i].ptr == ptr) return &v_mem_blockv[i];
+  }
+  return NULL;
+}
+
+/* returns 0, or -1 if out of memory */
+static int v_mem_insert_block(const void *ptr, size_t size, int row)
+{
+  size_t mask, i, j;
+
+  if (2 * (v_mem_blockc + 1) > v_mem_blockmax) {
+    size_t blockmax = v_mem_blockmax ? 2 * v_mem_blockmax : 256;
+    v_mem_block_t *blockv = (v_mem_block_t *) calloc(blockmax, sizeof(v_mem_block_t));
+    if (blockv == NULL) return -1;
+    for (j = 0; j < v_mem_blockmax; j++) {
+      if (v_mem_blockv[j].ptr == NULL) continue;
+      i = v_mem_hash_ptr(v_mem_blockv[j].ptr) & (blockmax - 1);
+      while (blockv[i].ptr != NULL) i = (i + 1) & (blockmax - 1);
+      blockv[i] = v_mem_blockv[j];
+    }
+    free(v_mem_blockv);
+    v_mem_blockv = blockv;
+    v_mem_blockmax = blockmax;
+  }
+  mask = v_mem_blockmax - 1;
+  for (i = v_mem_hash_ptr(ptr) & mask; v_mem_blockv[i].ptr != NULL; i = (i + 1) & mask);
+  v_mem_blockv[i].ptr = ptr;
+  v_mem_blockv[i].size = size;
+  v_mem_blockv[i].row = row;
+  v_mem_blockc++;
+  return 0;
+}
+
+/* empty the entry and move the following ones of its cluster back */
+static void v_mem_remove_block(v_mem_block_t *block)
+{
+  size_t mask = v_mem_blockmax - 1;
+  size_t i = block - v_mem_blockv, j = i, home;
+
+  for (;;) {
+    v_mem_blockv[i].ptr = NULL;
+    for (;;) {
+      j = (j + 1) & mask;
+      if (v_mem_blockv[j].ptr == NULL) {
+        v_mem_blockc--;
+        return;
+      }
+      home = v_mem_hash_ptr(v_mem_blockv[j].ptr) & mask;
+      /* move j to i unless its home lies cyclically in (i, j] */
+      if (i <= j ? (home <= i || j < home) : (home <= i && j < home)) break;
+    }
+    v_mem_blockv[i] = v_mem_blockv[j];
+    i = j;
+  }
+}
+
+/* account a new block */
+static void v_mem_allocated(void *ptr, size_t size, const char *mtypefrag)
+{
+  int row;
+
+  if (!v_mem_enabled) return;
+  v_mem_lock();
+  if (v_mem_enabled) {
+    row = v_mem_block_row(mtypefrag, v_mem_owner);
+    if (row != -1 && !v_mem_insert_block(ptr, size, row))
+      v_mem_update(row, 0, size, V_MEM_ALLOC);
+  }
+  v_mem_unlock();
+}
+
+void v_mem_untrack(const void *ptr)
+{
+  v_mem_block_t *block;
+
+  if (!v_mem_enabled) return;
+  v_mem_lock();
+  block = v_mem_find_block(ptr);
+  if (block != NULL) {
+    v_mem_update(block->row, block->size, 0, V_MEM_FREE);
+    v_mem_remove_block(block);
+  }
+  v_mem_unlock();
+}
+
+void v_mem_track(const void *ptr, size_t size, const char *mtypefrag)
+{
+  if (ptr != NULL) v_mem_allocated((void *) ptr, size, mtypefrag);
+}
+
+void v_release(void *ptr)
+{
+  v_mem_untrack(ptr);
+  free(ptr);
+}
+
+void v_mem_set_accounting(int enable)
+{
+  v_mem_lock();
+  free(v_mem_rowv);
+  free(v_mem_rowidx);
+  free(v_mem_blockv);
+  v_mem_rowv = NULL;
+  v_mem_rowidx = NULL;
+  v_mem_blockv = NULL;
+  v_mem_rowc = v_mem_rowmax = v_mem_rowidxc = 0;
+  v_mem_blockc = v_mem_blockmax = 0;
+  v_mem_generation++;
+  v_mem_enabled = enable != 0;
+  v_mem_unlock();
+}
+
+int v_mem_set_owner(int owner)
+{
+  int previous = v_mem_owner;
+  v_mem_owner = owner;
+  return previous;
+}
+
+int v_mem_get_stats(v_mem_stat_t *statv, int statc)
+{
+  int r, rowc;
+
+  v_mem_lock();
+  rowc = v_mem_rowc;
+  for (r = 0; r < rowc && r < statc; r++)
+    statv[r] = v_mem_rowv[r].s;
+  v_mem_unlock();
+  return rowc;
+}
+
+void v_mem_reset_stats(void)
+{
+  v_mem_stat_t *s;
+  int r;
+
+  v_mem_lock();
+  for (r = 0; r < v_mem_rowc; r++) {
+    s = &v_mem_rowv[r].s;
+    s->peak_bytes = s->live_bytes;
+    s->allocations = s->reallocations = s->frees = 0;
+  }
+  v_mem_unlock();
+}
+
 #ifdef BYPASS_V_FUNCTIONS
 void *v_calloc(size_t nmemb, size_t size, const char *mtypefrag) {
   // fprintf(stderr, "%s, %s\n", __FUNCTION__, mtypefrag);
@@ -59,6 +361,8 @@ void *v_calloc(size_t nmemb, size_t size, const char *mtypefrag)
   if (p == NULL) 
     eeperror("libeep: failed to callocate %s memory (%ld bytes)!\n", 
             mtypefrag, (unsigned long) size * nmemb);
+  else
+    v_mem_allocated(p, nmemb * size, mtypefrag);
   return p;
 }
 
@@ -71,25 +375,61 @@ void *v_malloc(size_t size, const char *mtypefrag)
   if (p == NULL) 
     eeperror("libeep: failed to mallocate %s memory (%ld bytes)!\n", 
             mtypefrag, (unsigned long) size);
+  else
+    v_mem_allocated(p, size, mtypefrag);
   return p;
 }
 
 void *v_realloc(void *ptr, size_t size, const char *mtypefrag)
 {
-  void *p = NULL;
-  
-  if (ptr == NULL && size != 0) {
-    p = (void *) malloc(size);
+  v_mem_block_t *block;
+  void *p;
+  size_t oldsize = 0;
+  unsigned generation = 0;
+  int row = -1;
+
+  if (size == 0) {
+    v_release(ptr);
+    return NULL;
   }
-  if (ptr != NULL) { 
-    p = (void *) realloc((char *) ptr, size);
+  /*
+    the entry of ptr is taken out before realloc frees it, once it is freed
+    another thread may be given the same address
+  */
+  if (ptr != NULL && v_mem_enabled) {
+    v_mem_lock();
+    block = v_mem_find_block(ptr);
+    if (block != NULL) {
+      oldsize = block->size;
+      row = block->row;
+      v_mem_remove_block(block);
+    }
+    generation = v_mem_generation;
+    v_mem_unlock();
   }
-  
-  if (p == NULL && size != 0) 
-    eeperror("libeep: failed to reallocate %s memory (%ld bytes)!\n", 
+
+  p = (void *) realloc((char *) ptr, size);
+  if (p == NULL)
+    eeperror("libeep: failed to reallocate %s memory (%ld bytes)!\n",
             mtypefrag, (unsigned long) size);
 
-  if (size == 0) p = NULL;
+  if (row == -1) {
+    if (p != NULL) v_mem_allocated(p, size, mtypefrag);
+    return p;
+  }
+  v_mem_lock();
+  /* the rows are gone if the accounting was reset in between */
+  if (generation == v_mem_generation) {
+    if (p == NULL) {
+      if (v_mem_insert_block(ptr, oldsize, row))
+        v_mem_update(row, oldsize, 0, V_MEM_FREE);
+    } else {
+      v_mem_update(row, oldsize, size, V_MEM_REALLOC);
+      if (v_mem_insert_block(p, size, row))
+        v_mem_update(row, size, 0, V_MEM_FREE);
+    }
+  }
+  v_mem_unlock();
   return p;
 }
 
@@ -1,4 +1,6 @@
 // system
+#include <ctype.h>
+#include <locale.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +8,11 @@
 #include <string.h>
 #include <string.h>
 #include <time.h>
+#if defined(WIN32) && !defined(__CYGWIN__)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 // libeep
 #include <v4/eep.h>
 #include <cnt/evt.h>
@@ -13,6 +20,7 @@
 #include <cnt/cnt.h>
 #include <cnt/trg.h>
 #include <eep/eepio.h> // for the definition of eepio_fopen
+#include <eep/eepmem.h> // for the allocation accounting
 #include <cnt/cnt_private.h> // for the definition of eegchan_s
 ///////////////////////////////////////////////////////////////////////////////
 #define SCALING_FACTOR 128
@@ -35,12 +43,38 @@ struct _processed_trigger {
   struct _libeep_trigger_extension_mutable   te;
 };
 ///////////////////////////////////////////////////////////////////////////////
+// reusable scratch memory of a handle, 64 byte aligned, grows by doubling
+#define _LIBEEP_ARENA_ALIGNMENT 64
+#define _LIBEEP_ARENA_MIN_SIZE  4096
+struct _libeep_arena {
+  void   * data;
+  size_t   size;
+};
+///////////////////////////////////////////////////////////////////////////////
+// serializes the sample, trigger and statistics calls on one handle
+#if defined(WIN32) && !defined(__CYGWIN__)
+typedef SRWLOCK _libeep_handle_lock_t;
+#define _libeep_handle_lock_init(l)    InitializeSRWLock(l)
+#define _libeep_handle_lock_destroy(l) ((void)(l))
+#define _libeep_handle_lock(l)         AcquireSRWLockExclusive(l)
+#define _libeep_handle_unlock(l)       ReleaseSRWLockExclusive(l)
+#else
+typedef pthread_mutex_t _libeep_handle_lock_t;
+#define _libeep_handle_lock_init(l)    pthread_mutex_init(l, NULL)
+#define _libeep_handle_lock_destroy(l) pthread_mutex_destroy(l)
+#define _libeep_handle_lock(l)         pthread_mutex_lock(l)
+#define _libeep_handle_unlock(l)       pthread_mutex_unlock(l)
+#endif
+///////////////////////////////////////////////////////////////////////////////
 struct _libeep_entry {
+  _libeep_handle_lock_t lock;
   FILE      * file;
   eeg_t     * eep;
   data_type   data_type;
   open_mode   open_mode;
   float     * scales;
+  // borrowed sample buffers and conversion on write
+  struct _libeep_arena arena;
   // processed trigger data
   int                         processed_trigger_count;
   struct _processed_trigger * processed_trigger_data;
@@ -51,242 +85,330 @@ struct _libeep_channels {
   short count;
 };
 
-static struct _libeep_entry ** _libeep_entry_map;
-static struct record_info_s ** _libeep_recinfo_map;
-static struct _libeep_channels ** _libeep_channel_map;
+#if defined(WIN32) && !defined(__CYGWIN__)
+#define _libeep_aligned_free(p) _aligned_free(p)
+static void *
+_libeep_aligned_alloc(size_t size) {
+  return _aligned_malloc(size, _LIBEEP_ARENA_ALIGNMENT);
+}
+#else
+#define _libeep_aligned_free(p) free(p)
+static void *
+_libeep_aligned_alloc(size_t size) {
+  void * p;
+  if(posix_memalign(&p, _LIBEEP_ARENA_ALIGNMENT, size)) {
+    return NULL;
+  }
+  return p;
+}
+#endif
+///////////////////////////////////////////////////////////////////////////////
+static void
+_libeep_arena_free(struct _libeep_arena * a) {
+  if(a->data != NULL) {
+    v_mem_untrack(a->data);
+  }
+  _libeep_aligned_free(a->data);
+  a->data = NULL;
+  a->size = 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* scratch memory of at least size bytes, the previous contents are lost */
+static void *
+_libeep_arena_reserve(struct _libeep_arena * a, size_t size) {
+  size_t capacity;
+  void * data;
+  // empty blocks are valid, they still get memory to point to
+  if(size == 0) {
+    size = 1;
+  }
+  if(size <= a->size) {
+    return a->data;
+  }
+  capacity = a->size ? a->size : _LIBEEP_ARENA_MIN_SIZE;
+  while(capacity < size) {
+    capacity *= 2;
+  }
+  data = _libeep_aligned_alloc(capacity);
+  if(data == NULL) {
+    return NULL;
+  }
+  _libeep_arena_free(a);
+  v_mem_track(data, capacity, "arena");
+  a->data = data;
+  a->size = capacity;
+  return data;
+}
+///////////////////////////////////////////////////////////////////////////////
+/*
+  handle registries: a handle is (generation << _LIBEEP_SLOT_BITS) | slot.
+  Freed slots go on a free list and are reused with the next generation, so
+  open, close and lookup are O(1) and a stale handle does not reach the
+  object now living in its slot. The slot table doubles when it is full.
+*/
+#define _LIBEEP_SLOT_BITS       20
+#define _LIBEEP_SLOT_MASK       ((1 << _LIBEEP_SLOT_BITS) - 1)
+#define _LIBEEP_GENERATION_MASK ((1 << (31 - _LIBEEP_SLOT_BITS)) - 1)
+
+struct _libeep_slot {
+  void * object;     // NULL if the slot is free
+  int    generation;
+  int    next_free;  // next slot on the free list, -1 at the end
+};
+
+struct _libeep_registry {
+  const char          * name;      // kind of handle, for messages
+  struct _libeep_slot * slots;
+  int                   size;      // slots handed out so far
+  int                   capacity;
+  int                   free_head; // first free slot, -1 if none
+};
 
-static int _libeep_entry_size;
-static int _libeep_recinfo_size;
-static int _libeep_channel_size;
+static struct _libeep_registry _libeep_entries = { "cnt", NULL, 0, 0, -1 };
+static struct _libeep_registry _libeep_recinfos = { "recording info", NULL, 0, 0, -1 };
+static struct _libeep_registry _libeep_channel_infos = { "channel info", NULL, 0, 0, -1 };
+///////////////////////////////////////////////////////////////////////////////
+/* the registries are guarded by one lock; the objects they point to stay
+   where they are when a slot table grows, so they are used without it */
+#if defined(WIN32) && !defined(__CYGWIN__)
+static SRWLOCK _libeep_registry_lock = SRWLOCK_INIT;
+#define _libeep_lock()   AcquireSRWLockExclusive(&_libeep_registry_lock)
+#define _libeep_unlock() ReleaseSRWLockExclusive(&_libeep_registry_lock)
+#else
+static pthread_mutex_t _libeep_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+#define _libeep_lock()   pthread_mutex_lock(&_libeep_registry_lock)
+#define _libeep_unlock() pthread_mutex_unlock(&_libeep_registry_lock)
+#endif
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_entry_map and _libeep_entry_size */
-static cntfile_t
-_libeep_allocate() {
-  struct _libeep_entry **new_entry_map = NULL;
-  new_entry_map = realloc(_libeep_entry_map, sizeof(struct _libeep_entry *) * (_libeep_entry_size + 1));
-  if (new_entry_map == NULL) {
-    return -1;
+/* store object in a free slot, returns its handle or -1 */
+static int
+_libeep_registry_add(struct _libeep_registry * r, void * object) {
+  struct _libeep_slot * slots;
+  int slot, capacity, handle;
+  _libeep_lock();
+  if(r->free_head == -1) {
+    if(r->size == r->capacity) {
+      capacity = r->capacity ? 2 * r->capacity : 16;
+      if(capacity > _LIBEEP_SLOT_MASK + 1) {
+        capacity = _LIBEEP_SLOT_MASK + 1;
+      }
+      if(capacity == r->capacity) {
+        _libeep_unlock();
+        fprintf(stderr, "libeep: too many open %s handles\n", r->name);
+        return -1;
+      }
+      slots = (struct _libeep_slot *)realloc(r->slots, sizeof(struct _libeep_slot) * capacity);
+      if(slots == NULL) {
+        _libeep_unlock();
+        return -1;
+      }
+      r->slots = slots;
+      r->capacity = capacity;
+    }
+    slot = r->size++;
+    r->slots[slot].generation = 0;
+  } else {
+    slot = r->free_head;
+    r->free_head = r->slots[slot].next_free;
   }
-  _libeep_entry_map = new_entry_map;
-  _libeep_entry_map[_libeep_entry_size]=(struct _libeep_entry *)malloc(sizeof(struct _libeep_entry));
-  if (_libeep_entry_map[_libeep_entry_size] == NULL) {
+  r->slots[slot].object = object;
+  r->slots[slot].next_free = -1;
+  handle = (r->slots[slot].generation << _LIBEEP_SLOT_BITS) | slot;
+  _libeep_unlock();
+  return handle;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* slot of a live handle, or -1; call with the lock held */
+static int
+_libeep_registry_slot(const struct _libeep_registry * r, int handle) {
+  int slot = handle & _LIBEEP_SLOT_MASK;
+  if(handle < 0 || slot >= r->size || r->slots[slot].object == NULL
+     || r->slots[slot].generation != (handle >> _LIBEEP_SLOT_BITS)) {
     return -1;
   }
-  _libeep_entry_map[_libeep_entry_size]->open_mode=om_none;
-  _libeep_entry_map[_libeep_entry_size]->data_type=dt_none;
-  _libeep_entry_size += 1;
-  return _libeep_entry_size - 1;
+  return slot;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_entry_map and _libeep_entry_size */
-static void
-_libeep_free(cntfile_t handle) {
-  if(_libeep_entry_map[handle]==NULL) {
-    fprintf(stderr, "libeep: cannot free cnt handle %i\n", handle);
-    return;
+/* object of a handle, or NULL if the handle is not valid */
+static void *
+_libeep_registry_get(struct _libeep_registry * r, int handle) {
+  void * object = NULL;
+  int slot;
+  _libeep_lock();
+  slot = _libeep_registry_slot(r, handle);
+  if(slot != -1) {
+    object = r->slots[slot].object;
   }
-  // close handle
-  free(_libeep_entry_map[handle]);
-  // set null
-  _libeep_entry_map[handle]=NULL;
+  _libeep_unlock();
+  if(object == NULL) {
+    fprintf(stderr, "libeep: invalid %s handle %i\n", r->name, handle);
+  }
+  return object;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_entry_map and _libeep_entry_size */
-static void
-_libeep_free_map() {
-  int i;
-  for (i = 0; i < _libeep_entry_size; ++i) {
-    if (_libeep_entry_map[i] != NULL) {
-      _libeep_free(i); // TODO: or use libeep_close?
-    }
+/* invalidate a handle and free its slot, returns its object or NULL */
+static void *
+_libeep_registry_remove(struct _libeep_registry * r, int handle) {
+  void * object = NULL;
+  int slot;
+  _libeep_lock();
+  slot = _libeep_registry_slot(r, handle);
+  if(slot != -1) {
+    object = r->slots[slot].object;
+    r->slots[slot].object = NULL;
+    r->slots[slot].generation = (r->slots[slot].generation + 1) & _LIBEEP_GENERATION_MASK;
+    r->slots[slot].next_free = r->free_head;
+    r->free_head = slot;
   }
-  if (_libeep_entry_map != NULL) {
-    free(_libeep_entry_map);
+  _libeep_unlock();
+  if(object == NULL) {
+    fprintf(stderr, "libeep: cannot free %s handle %i\n", r->name, handle);
   }
-  _libeep_entry_map = NULL;
-  _libeep_entry_size = 0;
+  return object;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_entry_map and _libeep_entry_size */
-static struct _libeep_entry *
-_libeep_get_object(cntfile_t handle, open_mode om) {
-  struct _libeep_entry *rv = NULL;
-  if (handle < 0) {
-    fprintf(stderr, "libeep: invalid cnt handle %i\n", handle);
-    exit(-1);
+/* dispose all objects left in a registry and release its slots */
+static void
+_libeep_registry_clear(struct _libeep_registry * r, void (*dispose)(void *)) {
+  int slot;
+  _libeep_lock();
+  for(slot = 0; slot < r->size; ++slot) {
+    if(r->slots[slot].object != NULL) {
+      dispose(r->slots[slot].object);
+    }
   }
-  if (_libeep_entry_map==NULL) {
-    fprintf(stderr, "libeep: cnt entry map not initialized\n");
-    exit(-1);
+  free(r->slots);
+  r->slots = NULL;
+  r->size = 0;
+  r->capacity = 0;
+  r->free_head = -1;
+  _libeep_unlock();
+}
+///////////////////////////////////////////////////////////////////////////////
+/* local helper for manipulating _libeep_entries */
+static void
+_libeep_entry_dispose(void * obj) {
+  _libeep_handle_lock_destroy(&((struct _libeep_entry *)obj)->lock);
+  free(obj);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* local helper for manipulating _libeep_entries */
+static cntfile_t
+_libeep_allocate() {
+  struct _libeep_entry * obj;
+  cntfile_t handle;
+  obj = (struct _libeep_entry *)malloc(sizeof(struct _libeep_entry));
+  if(obj == NULL) {
+    return -1;
   }
-  if (handle >= _libeep_entry_size) {
-    fprintf(stderr, "libeep: invalid cnt handle %i\n", handle);
-    exit(-1);
+  obj->open_mode=om_none;
+  obj->data_type=dt_none;
+  obj->arena.data=NULL;
+  obj->arena.size=0;
+  _libeep_handle_lock_init(&obj->lock);
+  handle = _libeep_registry_add(&_libeep_entries, obj);
+  if(handle == -1) {
+    _libeep_entry_dispose(obj);
   }
-  rv = _libeep_entry_map[handle];
-  // check valid handle
-  if(rv==NULL) {
-    fprintf(stderr, "libeep: invalid cnt handle %i\n", handle);
-    exit(-1);
+  return handle;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* local helper for manipulating _libeep_entries */
+static void
+_libeep_free(cntfile_t handle) {
+  void * obj = _libeep_registry_remove(&_libeep_entries, handle);
+  if(obj != NULL) {
+    _libeep_entry_dispose(obj);
   }
+}
+///////////////////////////////////////////////////////////////////////////////
+/* local helper for manipulating _libeep_entries */
+static struct _libeep_entry *
+_libeep_get_object(cntfile_t handle, open_mode om) {
+  struct _libeep_entry *rv = (struct _libeep_entry *)_libeep_registry_get(&_libeep_entries, handle);
   // check valid open mode
-  if(om != om_none && rv->open_mode != om) {
+  if(rv != NULL && om != om_none && rv->open_mode != om) {
     fprintf(stderr, "libeep: invalid mode on cnt handle %i\n", handle);
-    exit(-1);
+    return NULL;
+  }
+  // charge what this thread allocates from now on to the handle
+  if(rv != NULL) {
+    v_mem_set_owner(handle);
   }
-
   return rv;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_recinfo_map and _libeep_recinfo_size */
+/* local helper for manipulating _libeep_recinfos */
 static recinfo_t
 _libeep_recinfo_allocate() {
-  struct record_info_s ** new_recinfo_map = NULL;
-  new_recinfo_map = realloc(_libeep_recinfo_map, sizeof(struct record_info_s *) * (_libeep_recinfo_size + 1));
-  if (new_recinfo_map == NULL) {
-    return -1;
-  }
-  _libeep_recinfo_map = new_recinfo_map;
-  _libeep_recinfo_map[_libeep_recinfo_size] = (struct record_info_s *)malloc(sizeof(struct record_info_s));
-  if (_libeep_recinfo_map[_libeep_recinfo_size] == NULL) {
+  struct record_info_s * obj;
+  recinfo_t handle;
+  obj = (struct record_info_s *)malloc(sizeof(struct record_info_s));
+  if(obj == NULL) {
     return -1;
   }
-  memset(_libeep_recinfo_map[_libeep_recinfo_size], 0, sizeof(struct record_info_s));
+  memset(obj, 0, sizeof(struct record_info_s));
   // set default values to prevent recording info line corruption
-  _libeep_recinfo_map[_libeep_recinfo_size]->m_chSex = ' ';
-  _libeep_recinfo_map[_libeep_recinfo_size]->m_chHandedness = ' ';
-  _libeep_recinfo_size += 1;
-  return _libeep_recinfo_size - 1;
+  obj->m_chSex = ' ';
+  obj->m_chHandedness = ' ';
+  handle = _libeep_registry_add(&_libeep_recinfos, obj);
+  if(handle == -1) {
+    free(obj);
+  }
+  return handle;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_recinfo_map and _libeep_recinfo_size */
+/* local helper for manipulating _libeep_recinfos */
 static void
 _libeep_recinfo_free(recinfo_t handle) {
-  if (_libeep_recinfo_map[handle] == NULL) {
-    fprintf(stderr, "libeep: cannot free recording info handle %i\n", handle);
-    return;
-  }
-  // close handle
-  free(_libeep_recinfo_map[handle]);
-  // set null
-  _libeep_recinfo_map[handle] = NULL;
+  free(_libeep_registry_remove(&_libeep_recinfos, handle));
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_recinfo_map and _libeep_recinfo_size */
+/* local helper for manipulating _libeep_recinfos */
 static struct record_info_s *
 _libeep_get_recinfo(recinfo_t handle) {
-  struct record_info_s *rv = NULL;
-  if (handle < 0) {
-    fprintf(stderr, "libeep: invalid recording info handle %i\n", handle);
-    exit(-1);
-  }
-  if (_libeep_recinfo_map == NULL) {
-    fprintf(stderr, "libeep: recording info map not initialized\n");
-    exit(-1);
-  }
-  if (handle >= _libeep_recinfo_size) {
-    fprintf(stderr, "libeep: invalid recording info handle %i\n", handle);
-    exit(-1);
-  }
-  rv = _libeep_recinfo_map[handle];
-  // check valid handle
-  if (rv == NULL) {
-    fprintf(stderr, "libeep: invalid recording info handle %i\n", handle);
-    exit(-1);
-  }
-  return rv;
-}
-///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_recinfo_map and _libeep_recinfo_size */
-static void
-_libeep_free_recinfo_map() {
-  int i;
-  for (i = 0; i < _libeep_recinfo_size; ++i) {
-    if (_libeep_recinfo_map[i] != NULL) {
-      _libeep_recinfo_free(i);
-    }
-  }
-  if (_libeep_recinfo_map != NULL) {
-    free(_libeep_recinfo_map);
-  }
-  _libeep_recinfo_map = NULL;
-  _libeep_recinfo_size = 0;
+  return (struct record_info_s *)_libeep_registry_get(&_libeep_recinfos, handle);
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_channel_map and _libeep_channel_size */
+/* local helper for manipulating _libeep_channel_infos */
 static chaninfo_t
 _libeep_channels_allocate() {
-  struct _libeep_channels ** new_channel_map = NULL;
-  new_channel_map = realloc(_libeep_channel_map, sizeof(struct _libeep_channels *) * (_libeep_channel_size + 1));
-  if (new_channel_map == NULL) {
+  struct _libeep_channels * obj;
+  chaninfo_t handle;
+  obj = (struct _libeep_channels *)malloc(sizeof(struct _libeep_channels));
+  if(obj == NULL) {
     return -1;
   }
-  _libeep_channel_map = new_channel_map;
-  _libeep_channel_map[_libeep_channel_size] = (struct _libeep_channels *)malloc(sizeof(struct _libeep_channels));
-  if (_libeep_channel_map[_libeep_channel_size] == NULL) {
-    return -1;
+  obj->channels = NULL;
+  obj->count = 0;
+  handle = _libeep_registry_add(&_libeep_channel_infos, obj);
+  if(handle == -1) {
+    free(obj);
   }
-  _libeep_channel_map[_libeep_channel_size]->channels = NULL;
-  _libeep_channel_map[_libeep_channel_size]->count = 0;
-  _libeep_channel_size += 1;
-  return _libeep_channel_size - 1;
+  return handle;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* local helper for manipulating _libeep_channel_infos */
+static void
+_libeep_channels_dispose(void * object) {
+  struct _libeep_channels * obj = (struct _libeep_channels *)object;
+  free(obj->channels);
+  free(obj);
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_channel_map and _libeep_channel_size */
+/* local helper for manipulating _libeep_channel_infos */
 static void
 _libeep_channels_free(chaninfo_t handle) {
-  if (_libeep_channel_map[handle] == NULL) {
-    fprintf(stderr, "libeep: cannot free channel info handle %i\n", handle);
-    return;
-  }
-  if (_libeep_channel_map[handle]->channels != NULL) {
-    free(_libeep_channel_map[handle]->channels);
+  struct _libeep_channels * obj = (struct _libeep_channels *)_libeep_registry_remove(&_libeep_channel_infos, handle);
+  if(obj != NULL) {
+    _libeep_channels_dispose(obj);
   }
-  // close handle
-  free(_libeep_channel_map[handle]);
-  // set null
-  _libeep_channel_map[handle] = NULL;
 }
 ///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_channel_map and _libeep_channel_size */
+/* local helper for manipulating _libeep_channel_infos */
 static struct _libeep_channels *
 _libeep_get_channels(chaninfo_t handle) {
-  struct _libeep_channels *rv = NULL;
-  if (handle < 0) {
-    fprintf(stderr, "libeep: invalid channel info handle %i\n", handle);
-    exit(-1);
-  }
-  if (_libeep_channel_map == NULL) {
-    fprintf(stderr, "libeep: channel info map not initialized\n");
-    exit(-1);
-  }
-  if (handle >= _libeep_channel_size) {
-    fprintf(stderr, "libeep: invalid channel info handle %i\n", handle);
-    exit(-1);
-  }
-  rv = _libeep_channel_map[handle];
-  // check valid handle
-  if (rv == NULL) {
-    fprintf(stderr, "libeep: invalid channel info handle %i\n", handle);
-    exit(-1);
-  }
-  return rv;
-}
-///////////////////////////////////////////////////////////////////////////////
-/* local helper for manipulating _libeep_channel_map and _libeep_channel_size */
-static void
-_libeep_free_channels_map() {
-  int i;
-  for (i = 0; i < _libeep_channel_size; ++i) {
-    if (_libeep_channel_map[i] != NULL) {
-      _libeep_channels_free(i);
-    }
-  }
-  if (_libeep_channel_map != NULL) {
-    free(_libeep_channel_map);
-  }
-  _libeep_channel_map = NULL;
-  _libeep_channel_size = 0;
+  return (struct _libeep_channels *)_libeep_registry_get(&_libeep_channel_infos, handle);
 }
 ///////////////////////////////////////////////////////////////////////////////
 /* local helper to return string with the end replaced */
@@ -522,18 +644,13 @@ _libeep_fini_processed_triggers(struct _libeep_entry * obj) {
 }
 ///////////////////////////////////////////////////////////////////////////////
 void libeep_init() {
-  _libeep_entry_map = NULL;
-  _libeep_entry_size = 0;
-  _libeep_recinfo_map = NULL;
-  _libeep_recinfo_size = 0;
-  _libeep_channel_map = NULL;
-  _libeep_channel_size = 0;
+  // the registries start out empty and are emptied again by libeep_exit()
 }
 ///////////////////////////////////////////////////////////////////////////////
 void libeep_exit() {
-  _libeep_free_map();
-  _libeep_free_recinfo_map();
-  _libeep_free_channels_map();
+  _libeep_registry_clear(&_libeep_entries, _libeep_entry_dispose); // TODO: or use libeep_close?
+  _libeep_registry_clear(&_libeep_recinfos, free);
+  _libeep_registry_clear(&_libeep_channel_infos, _libeep_channels_dispose);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
@@ -543,13 +660,53 @@ libeep_get_version() {
   return version_string;
 }
 ///////////////////////////////////////////////////////////////////////////////
+void
+libeep_set_memory_accounting(int enable) {
+  v_mem_set_accounting(enable);
+}
+///////////////////////////////////////////////////////////////////////////////
+void
+libeep_reset_memory_stats() {
+  v_mem_reset_stats();
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_memory_stats(struct libeep_memory_stats *statv, int statc) {
+  v_mem_stat_t * s;
+  int i, n;
+  if(statc < 0 || (statv == NULL && statc > 0)) {
+    return -1;
+  }
+  s = (v_mem_stat_t *)malloc(sizeof(v_mem_stat_t) * (statc ? statc : 1));
+  if(s == NULL) {
+    return -1;
+  }
+  n = v_mem_get_stats(s, statc);
+  for(i = 0; i < n && i < statc; ++i) {
+    statv[i].tag = s[i].tag;
+    statv[i].handle = s[i].owner;
+    statv[i].live_bytes = s[i].live_bytes;
+    statv[i].peak_bytes = s[i].peak_bytes;
+    statv[i].live_blocks = s[i].live_blocks;
+    statv[i].allocations = s[i].allocations;
+    statv[i].reallocations = s[i].reallocations;
+    statv[i].frees = s[i].frees;
+  }
+  free(s);
+  return n;
+}
+///////////////////////////////////////////////////////////////////////////////
 cntfile_t
 _libeep_read_delegate(const char *filename, int external_triggers) {
   int status;
   int handle=_libeep_allocate();
   int channel_id;
   int channel_count;
-  struct _libeep_entry * obj=_libeep_get_object(handle, om_none);
+  struct _libeep_entry * obj;
+  if(handle == -1) {
+    return -1;
+  }
+  obj=_libeep_get_object(handle, om_none);
   // open file
   obj->file=eepio_fopen(filename, "rb");
   if(obj->file==NULL) {
@@ -561,6 +718,8 @@ _libeep_read_delegate(const char *filename, int external_triggers) {
   obj->eep=eep_init_from_file(filename, obj->file, &status);
   if(status != CNTERR_NONE) {
     fprintf(stderr, "libeep: cannot open(2) %s\n", filename);
+    eepio_fclose(obj->file);
+    _libeep_free(handle);
     return -1;
   }
   // read channel scale
@@ -596,21 +755,41 @@ libeep_read_with_external_triggers(const char *filename) {
 ///////////////////////////////////////////////////////////////////////////////
 cntfile_t
 libeep_write_cnt(const char *filename, int rate, chaninfo_t channel_info_handle, int rf64) {
+  return libeep_write_cnt_with_epoch_length(filename, rate, channel_info_handle, rf64, rate);
+}
+///////////////////////////////////////////////////////////////////////////////
+cntfile_t
+libeep_write_cnt_with_epoch_length(const char *filename, int rate, chaninfo_t channel_info_handle, int rf64, int epoch_length) {
   int cf;
   eegchan_t *channel_structure;
-  int handle=_libeep_allocate();
-  struct _libeep_entry * obj=_libeep_get_object(handle, om_none);
+  int handle;
+  struct _libeep_entry * obj;
   struct _libeep_channels * channels_obj = _libeep_get_channels(channel_info_handle);
+  if(channels_obj == NULL) {
+    return -1;
+  }
+  if(epoch_length < 1) {
+    fprintf(stderr, "libeep: invalid epoch length %i\n", epoch_length);
+    return -1;
+  }
+  handle=_libeep_allocate();
+  if(handle == -1) {
+    return -1;
+  }
+  obj=_libeep_get_object(handle, om_none);
   // open file
   obj->file=eepio_fopen(filename, "wb");
   if(obj->file==NULL) {
     fprintf(stderr, "libeep: cannot open(1) %s\n", filename);
+    _libeep_free(handle);
     return -1;
   }
   // channel setup
   channel_structure = eep_chan_init(channels_obj->count);
   if(channel_structure==NULL) {
     fprintf(stderr, "error in eep_chan_init!\n");
+    eepio_fclose(obj->file);
+    _libeep_free(handle);
     return -1;
   }
   memmove(channel_structure, channels_obj->channels, sizeof(eegchan_t)* channels_obj->count);
@@ -618,6 +797,8 @@ libeep_write_cnt(const char *filename, int rate, chaninfo_t channel_info_handle,
   obj->eep = eep_init_from_values(1.0 / (double)rate, channels_obj->count, channel_structure);
   if(obj->eep==NULL) {
     fprintf(stderr, "error in eep_init_from_values!\n");
+    eepio_fclose(obj->file);
+    _libeep_free(handle);
     return -1;
   }
   // eep struct
@@ -628,11 +809,15 @@ libeep_write_cnt(const char *filename, int rate, chaninfo_t channel_info_handle,
   }
   if(cf != CNTERR_NONE) {
     fprintf(stderr, "could not create file!\n");
+    eepio_fclose(obj->file);
+    _libeep_free(handle);
     return -1;
   }
   // switch writing mode
-  if(eep_prepare_to_write(obj->eep, DATATYPE_EEG, rate, NULL) != CNTERR_NONE) {
+  if(eep_prepare_to_write(obj->eep, DATATYPE_EEG, epoch_length, NULL) != CNTERR_NONE) {
     fprintf(stderr, "could not prepare file!\n");
+    eepio_fclose(obj->file);
+    _libeep_free(handle);
     return -1;
   }
   eep_set_keep_file_consistent(obj->eep, 1);
@@ -650,6 +835,9 @@ libeep_write_cnt(const char *filename, int rate, chaninfo_t channel_info_handle,
 void
 libeep_close(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_none);
+  if(obj == NULL) {
+    return;
+  }
   // close writing
   if(obj->open_mode==om_write) {
     eep_finish_file(obj->eep);
@@ -658,8 +846,9 @@ libeep_close(cntfile_t handle) {
   if(obj->open_mode==om_read) {
     eep_free(obj->eep);
   }
-  // close scales
-  free(_libeep_entry_map[handle]->scales);
+  // close scales and scratch memory
+  free(obj->scales);
+  _libeep_arena_free(&obj->arena);
   // clear structures for external trigger files
   _libeep_fini_processed_triggers(obj);
   // cleanup
@@ -670,87 +859,142 @@ libeep_close(cntfile_t handle) {
 int
 libeep_get_channel_count(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   return eep_get_chanc(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
 libeep_get_channel_label(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_chan_label(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
 libeep_get_channel_status(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_chan_status(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
 libeep_get_channel_type(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_chan_type(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
 libeep_get_channel_unit(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_chan_unit(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 const char *
 libeep_get_channel_reference(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_chan_reflab(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 float
 libeep_get_channel_scale(cntfile_t handle, int index) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return 0;
+  }
   return (float)eep_get_chan_scale(obj->eep, index);
 }
 ///////////////////////////////////////////////////////////////////////////////
 int
+libeep_get_channels(cntfile_t handle, struct libeep_channel *channelv, int channelc) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  int channel_count;
+  int c;
+  if(obj == NULL || channelc < 0 || (channelv == NULL && channelc > 0)) {
+    return -1;
+  }
+  channel_count = eep_get_chanc(obj->eep);
+  for(c = 0; c < channel_count && c < channelc; ++c) {
+    channelv[c].label = eep_get_chan_label(obj->eep, c);
+    channelv[c].unit = eep_get_chan_unit(obj->eep, c);
+    channelv[c].reference = eep_get_chan_reflab(obj->eep, c);
+    channelv[c].status = eep_get_chan_status(obj->eep, c);
+    channelv[c].type = eep_get_chan_type(obj->eep, c);
+    channelv[c].scale = (float)eep_get_chan_scale(obj->eep, c);
+  }
+  return channel_count;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
 libeep_get_channel_index(cntfile_t handle, const char *chan) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   return eep_get_chan_index(obj->eep, chan);
 }
 ///////////////////////////////////////////////////////////////////////////////
 int
 libeep_get_sample_frequency(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   return (int)(/* TODO: round before truncating */(1.0 / eep_get_period(obj->eep)));
 }
 ///////////////////////////////////////////////////////////////////////////////
 long
 libeep_get_sample_count(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   return eep_get_samplec(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
-static float *
-_libeep_get_samples_avr(struct _libeep_entry * obj, long from, long to) {
-  float *buffer_unscaled,
-        *buffer_scaled;
-  const float * ptr_src,
-        * ptr_scales;
-  float * ptr_dst;
+int
+libeep_get_epoch_length(cntfile_t handle) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
+  return eep_get_epochl(obj->eep, obj->data_type==dt_avr ? DATATYPE_AVERAGE : DATATYPE_EEG);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* read samples [from, to) of average data scaled into buffer */
+static int
+_libeep_read_samples_avr(struct _libeep_entry * obj, long from, long to, float * buffer) {
+  const float * ptr_scales;
+  float * ptr;
+  uint64_t t0;
   int n;
   int w;
   // seek
   if(eep_seek(obj->eep, DATATYPE_AVERAGE, from, 0)) {
-    return NULL;
+    return -1;
   }
   // get unscaled data
-  buffer_unscaled = (float *)malloc(FLOAT_CNTBUF_SIZE(obj->eep, to-from));
-  if(eep_read_float(obj->eep, DATATYPE_AVERAGE, buffer_unscaled, to-from)) {
-    free(buffer_unscaled);
-    return NULL;
+  if(eep_read_float(obj->eep, DATATYPE_AVERAGE, buffer, to-from)) {
+    return -1;
   }
-  // scale data
-  buffer_scaled = (float *)malloc(sizeof(float) * (to-from) * eep_get_chanc(obj->eep));
-  ptr_src=buffer_unscaled,
+  // scale data in place
+  t0=eepio_clock_ns();
   ptr_scales=obj->scales;
-  ptr_dst=buffer_scaled;
+  ptr=buffer;
   n=eep_get_chanc(obj->eep) * (to-from);
   w = 0;
   while(n--) {
@@ -758,28 +1002,28 @@ _libeep_get_samples_avr(struct _libeep_entry * obj, long from, long to) {
       w=to-from;
       ptr_scales=obj->scales;
     }
-    *ptr_dst++ = (float)(*ptr_src++) **ptr_scales++;
+    *ptr = *ptr **ptr_scales++;
+    ++ptr;
     w--;
   }
-  free(buffer_unscaled);
-  return buffer_scaled;
-  // TODO
+  eep_get_perf(obj->eep)->scale_ns += eepio_clock_ns() - t0;
+  return 0;
 }
 ///////////////////////////////////////////////////////////////////////////////
-static float *
-_libeep_get_samples_cnt(struct _libeep_entry * obj, long from, long to) {
-  sraw_t *buffer_unscaled;
-  float * buffer_scaled;
-  const sraw_t * ptr_src;
+/* read samples [from, to) of cnt data scaled into buffer; the raw values are
+   decoded into the same memory and converted in place */
+static int
+_libeep_read_samples_cnt(struct _libeep_entry * obj, long from, long to, float * buffer) {
+  sraw_t * raw = (sraw_t *)buffer;
   const float  * ptr_scales;
-  float  * ptr_dst;
+  uint64_t t0;
   int i;
   int w;
   long sample_count;
   short channel_count;
   // seek
   if(eep_seek(obj->eep, DATATYPE_EEG, from, 0)) {
-    return NULL;
+    return -1;
   }
 
   // convenience values
@@ -787,45 +1031,85 @@ _libeep_get_samples_cnt(struct _libeep_entry * obj, long from, long to) {
   sample_count = to - from;
 
   // get unscaled data
-  buffer_unscaled = (sraw_t *)malloc(sizeof(sraw_t) * channel_count * sample_count);
-
-  if(eep_read_sraw(obj->eep, DATATYPE_EEG, buffer_unscaled, sample_count)) {
-    free(buffer_unscaled);
-    return NULL;
+  if(eep_read_sraw(obj->eep, DATATYPE_EEG, raw, sample_count)) {
+    return -1;
   }
-  // scale data
-  buffer_scaled = (float *)malloc(sizeof(float) * channel_count * sample_count);
-  ptr_src=buffer_unscaled;
-  ptr_dst=buffer_scaled;
+  // scale data, sraw_t and float have the same size
+  t0 = eepio_clock_ns();
   ptr_scales = NULL;
   w = 0;
-  i = 0;
-  while(i<(channel_count * sample_count)) {
+  for(i = 0; i < channel_count * sample_count; ++i) {
     if(!w) {
       w=channel_count;
       ptr_scales=obj->scales;
     }
-    *ptr_dst = (float)(*ptr_src) * (*ptr_scales);
-	++ptr_dst;
-	++ptr_src;
-	++ptr_scales;
+    buffer[i] = (float)raw[i] * (*ptr_scales);
+    ++ptr_scales;
     --w;
-	++i;
   }
-  free(buffer_unscaled);
-  return buffer_scaled;
+  eep_get_perf(obj->eep)->scale_ns += eepio_clock_ns() - t0;
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* read samples [from, to) scaled into buffer */
+static int
+_libeep_read_samples(struct _libeep_entry * obj, long from, long to, float * buffer) {
+  if(obj->data_type==dt_avr) {
+    return _libeep_read_samples_avr(obj, from, to, buffer);
+  }
+  if(obj->data_type==dt_cnt) {
+    return _libeep_read_samples_cnt(obj, from, to, buffer);
+  }
+  return -1;
 }
 ///////////////////////////////////////////////////////////////////////////////
 float *
 libeep_get_samples(cntfile_t handle, long from, long to) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
-  if(obj->data_type==dt_avr) {
-    return _libeep_get_samples_avr(obj, from, to);
+  float * buffer;
+  if(obj == NULL || from < 0 || to < from) {
+    return NULL;
   }
-  if(obj->data_type==dt_cnt) {
-    return _libeep_get_samples_cnt(obj, from, to);
+  buffer = (float *)malloc(FLOAT_CNTBUF_SIZE(obj->eep, to - from));
+  if(buffer == NULL) {
+    return NULL;
   }
-  return NULL;
+  _libeep_handle_lock(&obj->lock);
+  if(_libeep_read_samples(obj, from, to, buffer)) {
+    free(buffer);
+    buffer = NULL;
+  }
+  _libeep_handle_unlock(&obj->lock);
+  return buffer;
+}
+///////////////////////////////////////////////////////////////////////////////
+const float *
+libeep_get_samples_borrowed(cntfile_t handle, long from, long to) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  float * buffer;
+  if(obj == NULL || from < 0 || to < from) {
+    return NULL;
+  }
+  _libeep_handle_lock(&obj->lock);
+  buffer = (float *)_libeep_arena_reserve(&obj->arena, FLOAT_CNTBUF_SIZE(obj->eep, to - from));
+  if(buffer != NULL && _libeep_read_samples(obj, from, to, buffer)) {
+    buffer = NULL;
+  }
+  _libeep_handle_unlock(&obj->lock);
+  return buffer;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_samples_into(cntfile_t handle, long from, long to, float *buffer) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  int status;
+  if(obj == NULL || buffer == NULL || from < 0 || to < from) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = _libeep_read_samples(obj, from, to, buffer);
+  _libeep_handle_unlock(&obj->lock);
+  return status;
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
@@ -842,9 +1126,18 @@ libeep_add_samples(cntfile_t handle, const float *data, int n) {
   const float  * ptr_src;
   sraw_t * ptr_dst;
   int c;
+  if(obj == NULL) {
+    return;
+  }
 
   c=CNTBUF_SIZE(obj->eep, n);
-  buffer=(sraw_t*)malloc(c);
+  _libeep_handle_lock(&obj->lock);
+  buffer=(sraw_t*)_libeep_arena_reserve(&obj->arena, c);
+  if(buffer == NULL) {
+    _libeep_handle_unlock(&obj->lock);
+    fprintf(stderr, "libeep: cannot allocate %i bytes for samples\n", c);
+    return;
+  }
   ptr_src=data;
   ptr_dst=buffer;
 
@@ -854,35 +1147,519 @@ libeep_add_samples(cntfile_t handle, const float *data, int n) {
   }
 
   eep_write_sraw(obj->eep, buffer, n);
+  _libeep_handle_unlock(&obj->lock);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_add_samples_double(cntfile_t handle, const double *data, int n) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_write);
+  sraw_t *buffer;
+  const double * ptr_src;
+  sraw_t * ptr_dst;
+  size_t c;
+  int status;
+  if(obj == NULL || (data == NULL && n > 0) || n < 0) {
+    return -1;
+  }
 
-  free(buffer);
+  c=CNTBUF_SIZE(obj->eep, n);
+  _libeep_handle_lock(&obj->lock);
+  buffer=(sraw_t*)_libeep_arena_reserve(&obj->arena, c);
+  if(buffer == NULL) {
+    _libeep_handle_unlock(&obj->lock);
+    fprintf(stderr, "libeep: cannot allocate %lu bytes for samples\n", (unsigned long)c);
+    return -1;
+  }
+  ptr_src=data;
+  ptr_dst=buffer;
+
+  c/=sizeof(sraw_t);
+  while(c--) {
+    *ptr_dst++ = (sraw_t)(*ptr_src++ * SCALING_FACTOR);
+  }
+
+  status = eep_write_sraw(obj->eep, buffer, n) == CNTERR_NONE ? 0 : -1;
+  _libeep_handle_unlock(&obj->lock);
+  return status;
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
 libeep_add_raw_samples(cntfile_t handle, const int32_t *data, int n) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return;
+  }
+  _libeep_handle_lock(&obj->lock);
   eep_write_sraw(obj->eep, data, n);
+  _libeep_handle_unlock(&obj->lock);
 }
 ///////////////////////////////////////////////////////////////////////////////
-int32_t *
-libeep_get_raw_samples(cntfile_t handle, long from, long to) {
-  sraw_t *buffer_unscaled;
+/* samples converted per channel before moving on, keeps the strided reads of
+   channel major input and the interleaved writes within a few cache lines */
+#define _LIBEEP_ADD_BLOCK 64
+enum _libeep_sample_kind { _libeep_float, _libeep_double, _libeep_raw };
+static int
+_libeep_add_strided(cntfile_t handle, const void *data, enum _libeep_sample_kind kind, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_write);
+  sraw_t * buffer;
+  sraw_t * dst;
+  ptrdiff_t s0, s, length, offset;
+  size_t size;
+  int chanc, c, status;
+  if(obj == NULL || (data == NULL && n > 0) || n < 0) {
+    return -1;
+  }
+  chanc = eep_get_chanc(obj->eep);
+  size = CNTBUF_SIZE(obj->eep, n);
+  _libeep_handle_lock(&obj->lock);
+  buffer=(sraw_t*)_libeep_arena_reserve(&obj->arena, size);
+  if(buffer == NULL) {
+    _libeep_handle_unlock(&obj->lock);
+    fprintf(stderr, "libeep: cannot allocate %lu bytes for samples\n", (unsigned long)size);
+    return -1;
+  }
+  for(s0 = 0; s0 < n; s0 += _LIBEEP_ADD_BLOCK) {
+    length = n - s0 < _LIBEEP_ADD_BLOCK ? n - s0 : _LIBEEP_ADD_BLOCK;
+    for(c = 0; c < chanc; ++c) {
+      offset = s0 * sample_stride + c * channel_stride;
+      dst = buffer + s0 * chanc + c;
+      switch(kind) {
+        case _libeep_float: {
+          const float * src = (const float *)data + offset;
+          for(s = 0; s < length; ++s, src += sample_stride, dst += chanc) {
+            *dst = (sraw_t)(*src * SCALING_FACTOR);
+          }
+          break;
+        }
+        case _libeep_double: {
+          const double * src = (const double *)data + offset;
+          for(s = 0; s < length; ++s, src += sample_stride, dst += chanc) {
+            *dst = (sraw_t)(*src * SCALING_FACTOR);
+          }
+          break;
+        }
+        case _libeep_raw: {
+          const int32_t * src = (const int32_t *)data + offset;
+          for(s = 0; s < length; ++s, src += sample_stride, dst += chanc) {
+            *dst = (sraw_t)*src;
+          }
+          break;
+        }
+      }
+    }
+  }
+  status = eep_write_sraw(obj->eep, buffer, n) == CNTERR_NONE ? 0 : -1;
+  _libeep_handle_unlock(&obj->lock);
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_add_samples_strided(cntfile_t handle, const float *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride) {
+  return _libeep_add_strided(handle, data, _libeep_float, n, channel_stride, sample_stride);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_add_samples_double_strided(cntfile_t handle, const double *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride) {
+  return _libeep_add_strided(handle, data, _libeep_double, n, channel_stride, sample_stride);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_add_raw_samples_strided(cntfile_t handle, const int32_t *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride) {
+  return _libeep_add_strided(handle, data, _libeep_raw, n, channel_stride, sample_stride);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_write_buffering(cntfile_t handle, int64_t buffer_size, int64_t prealloc_size) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return -1;
+  }
+  if(buffer_size < 0 || prealloc_size < 0) {
+    return -1;
+  }
+  if(eep_set_write_buffering(obj->eep, (size_t)buffer_size, (uint64_t)prealloc_size) != CNTERR_NONE) {
+    fprintf(stderr, "libeep: cannot set write buffering\n");
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_channel_order_optimization(cntfile_t handle, int enable) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return -1;
+  }
+  if(eep_set_optimize_channel_order(obj->eep, enable) != CNTERR_NONE) {
+    fprintf(stderr, "libeep: channel order can only be optimized before the first epoch is written\n");
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_compression_level(cntfile_t handle, int level) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return -1;
+  }
+  if(eep_set_compression_level(obj->eep, level) != CNTERR_NONE) {
+    fprintf(stderr, "libeep: invalid compression level %i\n", level);
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_adaptive_coding(cntfile_t handle, int enable) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return -1;
+  }
+  if(eep_set_adaptive_coding(obj->eep, enable) != CNTERR_NONE) {
+    fprintf(stderr, "libeep: adaptive coding must be set before the first epoch is written\n");
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_lpc_prediction(cntfile_t handle, int enable) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
+  if(obj == NULL) {
+    return -1;
+  }
+  if(eep_set_lpc_prediction(obj->eep, enable) != CNTERR_NONE) {
+    fprintf(stderr, "libeep: linear prediction must be set before the first epoch is written\n");
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_compression_stats(cntfile_t handle, int enable) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_none);
+  int status;
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = eep_set_compression_stats(obj->eep, enable);
+  _libeep_handle_unlock(&obj->lock);
+  if(status != CNTERR_NONE) {
+    fprintf(stderr, "libeep: could not allocate compression statistics\n");
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_reset_compression_stats(cntfile_t handle) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_none);
+  int status;
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = eep_get_compression_stats(obj->eep) == NULL ? -1 : 0;
+  if(status == 0) {
+    eep_reset_compression_stats(obj->eep);
+  }
+  _libeep_handle_unlock(&obj->lock);
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_compression_stats(cntfile_t handle, int channel, struct libeep_compression_stats *cs) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_none);
+  const raw3_chanstat_t * st;
+  int m;
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  st = eep_get_compression_stats(obj->eep);
+  if(st == NULL || channel < 0 || channel >= eep_get_chanc(obj->eep)) {
+    _libeep_handle_unlock(&obj->lock);
+    return -1;
+  }
+  st += channel;
+  cs->blocks = st->blockc;
+  cs->samples = st->samplec;
+  cs->bytes = st->bytes;
+  for(m = 0; m < 16; m++) {
+    cs->methods[m] = st->methodc[m];
+  }
+  cs->nbits = st->nbits;
+  cs->nexcbits = st->nexcbits;
+  cs->nbits_max = st->nbits_max;
+  cs->nexcbits_max = st->nexcbits_max;
+  cs->exceptions = st->excc;
+  _libeep_handle_unlock(&obj->lock);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_scan_compression_stats(cntfile_t handle, long epoch) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  int status;
+  if(obj == NULL) {
+    return -1;
+  }
+  if(obj->data_type != dt_cnt || epoch < 0) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = eep_scan_compression_stats(obj->eep, (uint64_t)epoch);
+  _libeep_handle_unlock(&obj->lock);
+  if(status != CNTERR_NONE) {
+    fprintf(stderr, "libeep: could not scan epoch %li\n", epoch);
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_stats(cntfile_t handle, struct libeep_stats *stats) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  const cnt_perf_t * perf;
+  int bin;
+  if(obj == NULL || stats == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  perf = eep_get_perf(obj->eep);
+  stats->bytes_read = perf->bytes_read;
+  stats->epochs_decoded = perf->epochs_decoded;
+  stats->seeks = perf->seeks;
+  stats->cache_hits = perf->cache_hits;
+  stats->read_ns = perf->read_ns;
+  stats->decode_ns = perf->decode_ns;
+  stats->scale_ns = perf->scale_ns;
+  for(bin = 0; bin < LIBEEP_STATS_BINS; ++bin) {
+    stats->read_hist[bin] = perf->read_hist[bin];
+    stats->decode_hist[bin] = perf->decode_hist[bin];
+  }
+  _libeep_handle_unlock(&obj->lock);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_reset_stats(cntfile_t handle) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  eep_reset_perf(obj->eep);
+  _libeep_handle_unlock(&obj->lock);
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_set_trace(cntfile_t handle, int max_events) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  int status;
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = eep_set_perf_trace(obj->eep, max_events);
+  _libeep_handle_unlock(&obj->lock);
+  return status == CNTERR_NONE ? 0 : -1;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_write_trace(cntfile_t handle, const char *filename) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  FILE * f;
+  int status;
+  if(obj == NULL || filename == NULL) {
+    return -1;
+  }
+  f = fopen(filename, "w");
+  if(f == NULL) {
+    fprintf(stderr, "libeep: cannot open %s\n", filename);
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = eep_write_perf_trace(obj->eep, f, handle);
+  _libeep_handle_unlock(&obj->lock);
+  if(fclose(f) || status != CNTERR_NONE) {
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* read raw samples [from, to) of cnt data into buffer */
+static int
+_libeep_read_raw_samples(struct _libeep_entry * obj, long from, long to, sraw_t * buffer) {
+  if(obj->data_type != dt_cnt) {
+    return -1;
+  }
+  // seek
+  if (eep_seek(obj->eep, DATATYPE_EEG, from, 0)) {
+    return -1;
+  }
+  // get unscaled data
+  if (eep_read_sraw(obj->eep, DATATYPE_EEG, buffer, to - from)) {
+    return -1;
+  }
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
+int32_t *
+libeep_get_raw_samples(cntfile_t handle, long from, long to) {
+  sraw_t *buffer_unscaled;
   struct _libeep_entry * obj;
 
   obj = _libeep_get_object(handle, om_read);
-  // seek
-  if (eep_seek(obj->eep, DATATYPE_EEG, from, 0)) {
+  if(obj == NULL || from < 0 || to < from) {
     return NULL;
   }
-  // get unscaled data
   buffer_unscaled = (sraw_t *)malloc(CNTBUF_SIZE(obj->eep, to - from));
-  if (eep_read_sraw(obj->eep, DATATYPE_EEG, buffer_unscaled, to - from)) {
+  if (buffer_unscaled == NULL) {
+    return NULL;
+  }
+  _libeep_handle_lock(&obj->lock);
+  if (_libeep_read_raw_samples(obj, from, to, buffer_unscaled)) {
     free(buffer_unscaled);
+    buffer_unscaled = NULL;
+  }
+  _libeep_handle_unlock(&obj->lock);
+  return buffer_unscaled;
+}
+///////////////////////////////////////////////////////////////////////////////
+const int32_t *
+libeep_get_raw_samples_borrowed(cntfile_t handle, long from, long to) {
+  sraw_t *buffer_unscaled;
+  struct _libeep_entry * obj;
+
+  obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL || from < 0 || to < from) {
     return NULL;
   }
+  _libeep_handle_lock(&obj->lock);
+  buffer_unscaled = (sraw_t *)_libeep_arena_reserve(&obj->arena, CNTBUF_SIZE(obj->eep, to - from));
+  if (buffer_unscaled != NULL && _libeep_read_raw_samples(obj, from, to, buffer_unscaled)) {
+    buffer_unscaled = NULL;
+  }
+  _libeep_handle_unlock(&obj->lock);
   return buffer_unscaled;
 }
 ///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_raw_samples_into(cntfile_t handle, long from, long to, int32_t *buffer) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  int status;
+  if(obj == NULL || buffer == NULL || from < 0 || to < from) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = _libeep_read_raw_samples(obj, from, to, buffer);
+  _libeep_handle_unlock(&obj->lock);
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* scale the interleaved raw samples of a block into the rows of out, one row
+   per pick with factors holding the scale of each pick */
+static void
+_libeep_scatter_raw(const sraw_t * block, long sample_count, int channel_count, const int *picks, const double *factors, int pick_count, double *out, long stride) {
+  long s;
+  int k;
+  for(k = 0; k < pick_count; ++k) {
+    const sraw_t * src = block + picks[k];
+    double * dst = out + k * stride;
+    for(s = 0; s < sample_count; ++s) {
+      dst[s] = (double)src[s * channel_count] * factors[k];
+    }
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
+/* same as _libeep_scatter_raw for samples that are already scaled */
+static void
+_libeep_scatter_float(const float * block, long sample_count, int channel_count, const int *picks, const double *factors, int pick_count, double *out, long stride) {
+  long s;
+  int k;
+  for(k = 0; k < pick_count; ++k) {
+    const float * src = block + picks[k];
+    double * dst = out + k * stride;
+    for(s = 0; s < sample_count; ++s) {
+      dst[s] = (double)src[s * channel_count] * factors[k];
+    }
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_samples_picked(cntfile_t handle, long from, long to, const int *picks, int pick_count, const double *scales, double *out, long stride) {
+  struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  double * factors;
+  void * block;
+  uint64_t t0;
+  long epoch_length;
+  long sample_count;
+  int channel_count;
+  int status = 0;
+  int k;
+  if(obj == NULL || from < 0 || to < from || picks == NULL || pick_count < 0 || out == NULL || stride < to - from) {
+    return -1;
+  }
+  channel_count = eep_get_chanc(obj->eep);
+  for(k = 0; k < pick_count; ++k) {
+    if(picks[k] < 0 || channel_count <= picks[k]) {
+      return -1;
+    }
+  }
+  if(from == to || pick_count == 0) {
+    return 0;
+  }
+  factors = (double *)malloc(pick_count * sizeof(double));
+  if(factors == NULL) {
+    return -1;
+  }
+  // average data is read scaled, only the extra factor is left to apply
+  for(k = 0; k < pick_count; ++k) {
+    factors[k] = scales ? scales[k] : 1.0;
+    if(obj->data_type == dt_cnt) {
+      factors[k] *= obj->scales[picks[k]];
+    }
+  }
+  // decode one compression epoch at a time: the scratch memory stays bounded
+  // and each sample is scaled straight into its row of out
+  epoch_length = eep_get_epochl(obj->eep, obj->data_type==dt_avr ? DATATYPE_AVERAGE : DATATYPE_EEG);
+  if(epoch_length <= 0 || to - from < epoch_length) {
+    epoch_length = to - from;
+  }
+  _libeep_handle_lock(&obj->lock);
+  block = _libeep_arena_reserve(&obj->arena, FLOAT_CNTBUF_SIZE(obj->eep, epoch_length));
+  if(block == NULL || (obj->data_type == dt_cnt && eep_seek(obj->eep, DATATYPE_EEG, from, 0))) {
+    status = -1;
+  }
+  while(status == 0 && from < to) {
+    sample_count = epoch_length < to - from ? epoch_length : to - from;
+    if(obj->data_type == dt_cnt) {
+      status = eep_read_sraw(obj->eep, DATATYPE_EEG, (sraw_t *)block, sample_count) ? -1 : 0;
+    } else {
+      status = _libeep_read_samples(obj, from, from + sample_count, (float *)block);
+    }
+    if(status) {
+      break;
+    }
+    t0 = eepio_clock_ns();
+    if(obj->data_type == dt_cnt) {
+      _libeep_scatter_raw((const sraw_t *)block, sample_count, channel_count, picks, factors, pick_count, out, stride);
+    } else {
+      _libeep_scatter_float((const float *)block, sample_count, channel_count, picks, factors, pick_count, out, stride);
+    }
+    eep_get_perf(obj->eep)->scale_ns += eepio_clock_ns() - t0;
+    out += sample_count;
+    from += sample_count;
+  }
+  _libeep_handle_unlock(&obj->lock);
+  free(factors);
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
 void
 libeep_free_raw_samples(int32_t *buffer) {
   if(buffer) {
@@ -896,9 +1673,17 @@ libeep_create_recinfo() {
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
+libeep_close_recinfo(recinfo_t handle) {
+  _libeep_recinfo_free(handle);
+}
+///////////////////////////////////////////////////////////////////////////////
+void
 libeep_add_recording_info(cntfile_t cnt_handle, recinfo_t recinfo_handle) {
   struct _libeep_entry * cnt = _libeep_get_object(cnt_handle, om_write);
   struct record_info_s * rec = _libeep_get_recinfo(recinfo_handle);
+  if(cnt == NULL || rec == NULL) {
+    return;
+  }
 
   // bail if this is not a cnt file
   if(cnt->data_type != dt_cnt) {
@@ -916,6 +1701,9 @@ libeep_add_recording_info(cntfile_t cnt_handle, recinfo_t recinfo_handle) {
 time_t
 libeep_get_start_time(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return (time_t)-1;
+  }
   return eep_get_recording_startdate_epoch(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -923,6 +1711,9 @@ void
 libeep_get_start_date_and_fraction(recinfo_t handle, double* start_date, double* start_fraction) {
   record_info_t rec_inf;
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return;
+  }
   if (start_date) *start_date = 0.0;
   if (start_fraction) *start_fraction = 0.0;
   if (eep_has_recording_info(obj->eep)) {
@@ -935,12 +1726,18 @@ libeep_get_start_date_and_fraction(recinfo_t handle, double* start_date, double*
 void
 libeep_set_start_time(recinfo_t handle, time_t start_time) {
   struct record_info_s * obj = _libeep_get_recinfo(handle);
+  if(obj == NULL) {
+    return;
+  }
   eep_unixdate_to_exceldate(start_time, &obj->m_startDate, &obj->m_startFraction);
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
 libeep_set_start_date_and_fraction(recinfo_t handle, double start_date, double start_fraction) {
   struct record_info_s * obj = _libeep_get_recinfo(handle);
+  if(obj == NULL) {
+    return;
+  }
   obj->m_startDate = start_date;
   obj->m_startFraction = start_fraction;
 }
@@ -948,6 +1745,9 @@ libeep_set_start_date_and_fraction(recinfo_t handle, double start_date, double s
 const char *
 libeep_get_hospital(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_hospital(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -956,6 +1756,9 @@ libeep_set_hospital(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szHospital) / sizeof(obj->m_szHospital[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szHospital, value, len);
   }
 }
@@ -963,6 +1766,9 @@ libeep_set_hospital(recinfo_t handle, const char *value) {
 const char *
 libeep_get_test_name(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_test_name(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -971,6 +1777,9 @@ libeep_set_test_name(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szTestName) / sizeof(obj->m_szTestName[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szTestName, value, len);
   }
 }
@@ -978,6 +1787,9 @@ libeep_set_test_name(recinfo_t handle, const char *value) {
 const char *
 libeep_get_test_serial(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_test_serial(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -986,6 +1798,9 @@ libeep_set_test_serial(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szTestSerial) / sizeof(obj->m_szTestSerial[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szTestSerial, value, len);
   }
 }
@@ -993,6 +1808,9 @@ libeep_set_test_serial(recinfo_t handle, const char *value) {
 const char *
 libeep_get_physician(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_physician(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1001,6 +1819,9 @@ libeep_set_physician(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szPhysician) / sizeof(obj->m_szPhysician[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szPhysician, value, len);
   }
 }
@@ -1008,6 +1829,9 @@ libeep_set_physician(recinfo_t handle, const char *value) {
 const char *
 libeep_get_technician(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_technician(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1016,6 +1840,9 @@ libeep_set_technician(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szTechnician) / sizeof(obj->m_szTechnician[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szTechnician, value, len);
   }
 }
@@ -1023,6 +1850,9 @@ libeep_set_technician(recinfo_t handle, const char *value) {
 const char *
 libeep_get_machine_make(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_machine_make(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1031,6 +1861,9 @@ libeep_set_machine_make(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szMachineMake) / sizeof(obj->m_szMachineMake[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szMachineMake, value, len);
   }
 }
@@ -1038,6 +1871,9 @@ libeep_set_machine_make(recinfo_t handle, const char *value) {
 const char *
 libeep_get_machine_model(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_machine_model(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1046,6 +1882,9 @@ libeep_set_machine_model(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szMachineModel) / sizeof(obj->m_szMachineModel[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szMachineModel, value, len);
   }
 }
@@ -1053,6 +1892,9 @@ libeep_set_machine_model(recinfo_t handle, const char *value) {
 const char *
 libeep_get_machine_serial_number(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_machine_serial_number(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1061,6 +1903,9 @@ libeep_set_machine_serial_number(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szMachineSN) / sizeof(obj->m_szMachineSN[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szMachineSN, value, len);
   }
 }
@@ -1068,6 +1913,9 @@ libeep_set_machine_serial_number(recinfo_t handle, const char *value) {
 const char *
 libeep_get_patient_name(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_patient_name(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1076,6 +1924,9 @@ libeep_set_patient_name(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szName) / sizeof(obj->m_szName[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szName, value, len);
   }
 }
@@ -1083,6 +1934,9 @@ libeep_set_patient_name(recinfo_t handle, const char *value) {
 const char *
 libeep_get_patient_id(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_patient_id(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1091,6 +1945,9 @@ libeep_set_patient_id(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szID) / sizeof(obj->m_szID[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szID, value, len);
   }
 }
@@ -1098,6 +1955,9 @@ libeep_set_patient_id(recinfo_t handle, const char *value) {
 const char *
 libeep_get_patient_address(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_patient_address(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1106,6 +1966,9 @@ libeep_set_patient_address(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szAddress) / sizeof(obj->m_szAddress[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szAddress, value, len);
   }
 }
@@ -1113,6 +1976,9 @@ libeep_set_patient_address(recinfo_t handle, const char *value) {
 const char *
 libeep_get_patient_phone(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_patient_phone(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1121,6 +1987,9 @@ libeep_set_patient_phone(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szPhone) / sizeof(obj->m_szPhone[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szPhone, value, len);
   }
 }
@@ -1128,6 +1997,9 @@ libeep_set_patient_phone(recinfo_t handle, const char *value) {
 const char *
 libeep_get_comment(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   return eep_get_comment(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1136,6 +2008,9 @@ libeep_set_comment(recinfo_t handle, const char *value) {
   if (value) {
     struct record_info_s * obj = _libeep_get_recinfo(handle);
     const size_t len = sizeof(obj->m_szComment) / sizeof(obj->m_szComment[0]) - 1;
+    if(obj == NULL) {
+      return;
+    }
     strncpy(obj->m_szComment, value, len);
   }
 }
@@ -1143,24 +2018,36 @@ libeep_set_comment(recinfo_t handle, const char *value) {
 char
 libeep_get_patient_sex(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return 0;
+  }
   return eep_get_patient_sex(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
 libeep_set_patient_sex(recinfo_t handle, char value) {
   struct record_info_s * obj = _libeep_get_recinfo(handle);
+  if(obj == NULL) {
+    return;
+  }
   obj->m_chSex = value;
 }
 ///////////////////////////////////////////////////////////////////////////////
 char
 libeep_get_patient_handedness(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return 0;
+  }
   return eep_get_patient_handedness(obj->eep);
 }
 ///////////////////////////////////////////////////////////////////////////////
 void
 libeep_set_patient_handedness(recinfo_t handle, char value) {
   struct record_info_s * obj = _libeep_get_recinfo(handle);
+  if(obj == NULL) {
+    return;
+  }
   obj->m_chHandedness = value;
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1168,16 +2055,60 @@ void
 libeep_get_date_of_birth(cntfile_t handle, int * year, int * month, int  * day) {
   struct tm *dob = NULL;
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return;
+  }
   dob = eep_get_patient_day_of_birth(obj->eep);
   *year = dob->tm_year + 1900;
   *month = dob->tm_mon + 1;
   *day = dob->tm_mday;
 }
 ///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_recording(cntfile_t handle, struct libeep_recording *recording) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  const struct tm * dob;
+  record_info_t rec_inf;
+  if(obj == NULL || recording == NULL) {
+    return -1;
+  }
+  recording->start_time = eep_get_recording_startdate_epoch(obj->eep);
+  recording->start_date = 0.0;
+  recording->start_fraction = 0.0;
+  if(eep_has_recording_info(obj->eep)) {
+    eep_get_recording_info(obj->eep, &rec_inf);
+    recording->start_date = rec_inf.m_startDate;
+    recording->start_fraction = rec_inf.m_startFraction;
+  }
+  recording->hospital = eep_get_hospital(obj->eep);
+  recording->test_name = eep_get_test_name(obj->eep);
+  recording->test_serial = eep_get_test_serial(obj->eep);
+  recording->physician = eep_get_physician(obj->eep);
+  recording->technician = eep_get_technician(obj->eep);
+  recording->machine_make = eep_get_machine_make(obj->eep);
+  recording->machine_model = eep_get_machine_model(obj->eep);
+  recording->machine_serial_number = eep_get_machine_serial_number(obj->eep);
+  recording->patient_name = eep_get_patient_name(obj->eep);
+  recording->patient_id = eep_get_patient_id(obj->eep);
+  recording->patient_address = eep_get_patient_address(obj->eep);
+  recording->patient_phone = eep_get_patient_phone(obj->eep);
+  recording->comment = eep_get_comment(obj->eep);
+  recording->patient_sex = eep_get_patient_sex(obj->eep);
+  recording->patient_handedness = eep_get_patient_handedness(obj->eep);
+  dob = eep_get_patient_day_of_birth(obj->eep);
+  recording->date_of_birth_year = dob ? dob->tm_year + 1900 : 0;
+  recording->date_of_birth_month = dob ? dob->tm_mon + 1 : 0;
+  recording->date_of_birth_day = dob ? dob->tm_mday : 0;
+  return 0;
+}
+///////////////////////////////////////////////////////////////////////////////
 void
 libeep_set_date_of_birth(recinfo_t handle, int year, int month, int day) {
   struct record_info_s * obj = _libeep_get_recinfo(handle);
   struct tm temp;
+  if(obj == NULL) {
+    return;
+  }
   memset(&temp, 0, sizeof(temp));
   temp.tm_year = year - 1900;
   temp.tm_mon = month - 1;
@@ -1192,12 +2123,22 @@ libeep_set_date_of_birth(recinfo_t handle, int year, int month, int day) {
 int
 libeep_add_trigger(cntfile_t handle, uint64_t sample, const char *code) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_write);
-  return trg_set(eep_get_trg(obj->eep), sample, code);
+  int status;
+  if(obj == NULL) {
+    return -1;
+  }
+  _libeep_handle_lock(&obj->lock);
+  status = trg_set(eep_get_trg(obj->eep), sample, code);
+  _libeep_handle_unlock(&obj->lock);
+  return status;
 }
 ///////////////////////////////////////////////////////////////////////////////
 int
 libeep_get_trigger_count(cntfile_t handle) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   return obj->processed_trigger_count;
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -1209,6 +2150,9 @@ libeep_get_trigger(cntfile_t handle, int idx, uint64_t *sample) {
 const char *
 libeep_get_trigger_with_extensions(cntfile_t handle, int idx, uint64_t *sample, struct libeep_trigger_extension * te) {
   struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   *sample = obj->processed_trigger_data[idx].sample;
   if(te != NULL) {
     te->type = obj->processed_trigger_data[idx].te.type;
@@ -1222,9 +2166,122 @@ libeep_get_trigger_with_extensions(cntfile_t handle, int idx, uint64_t *sample,
   return obj->processed_trigger_data[idx].label;
 }
 ///////////////////////////////////////////////////////////////////////////////
+int
+libeep_get_triggers(cntfile_t handle, const struct libeep_trigger_columns *columns, int count) {
+  struct _libeep_entry * obj = _libeep_get_object(handle, om_read);
+  const struct _processed_trigger * trigger;
+  int i;
+  if(obj == NULL || columns == NULL || count < 0) {
+    return -1;
+  }
+  for(i = 0; i < count && i < obj->processed_trigger_count; ++i) {
+    trigger = obj->processed_trigger_data + i;
+    if(columns->samples) columns->samples[i] = trigger->sample;
+    if(columns->durations) columns->durations[i] = trigger->te.duration_in_samples;
+    if(columns->types) columns->types[i] = trigger->te.type;
+    if(columns->codes) columns->codes[i] = trigger->te.code;
+    if(columns->labels) columns->labels[i] = trigger->label;
+    if(columns->conditions) columns->conditions[i] = trigger->te.condition;
+    if(columns->descriptions) columns->descriptions[i] = trigger->te.description;
+    if(columns->impedances) columns->impedances[i] = trigger->te.impedances;
+  }
+  return obj->processed_trigger_count;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* length of the number at ptr in the C locale syntax of strtod, without hex
+   floats and nan(...), or 0 */
+static int
+_libeep_scan_number(const char *ptr) {
+  static const char * const words[] = { "infinity", "inf", "nan" };
+  const char * p = ptr;
+  int digits = 0;
+  size_t i, n;
+  if(*p == '+' || *p == '-') {
+    ++p;
+  }
+  for(i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+    for(n = 0; words[i][n] != '\0' && tolower((unsigned char)p[n]) == words[i][n]; ++n) {
+    }
+    if(words[i][n] == '\0') {
+      return (int)(p + n - ptr);
+    }
+  }
+  for(; isdigit((unsigned char)*p); ++p, ++digits) {
+  }
+  if(*p == '.') {
+    for(++p; isdigit((unsigned char)*p); ++p, ++digits) {
+    }
+  }
+  if(digits == 0) {
+    return 0;
+  }
+  if(*p == 'e' || *p == 'E') {
+    ++p;
+    if(*p == '+' || *p == '-') {
+      ++p;
+    }
+    if(!isdigit((unsigned char)*p)) {
+      return 0;
+    }
+    for(; isdigit((unsigned char)*p); ++p) {
+    }
+  }
+  return (int)(p - ptr);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_parse_impedances(const char *impedances, double *values, int count) {
+  const char * ptr = impedances;
+  const char * point;
+  char number[64];
+  char * end;
+  size_t point_length;
+  double value;
+  int length, i, k;
+  int n = 0;
+  if(impedances == NULL || count < 0 || (values == NULL && count > 0)) {
+    return -1;
+  }
+  // strtod expects the decimal point of the current locale, the file has '.'
+  point = localeconv()->decimal_point;
+  point_length = strlen(point);
+  for(;;) {
+    length = _libeep_scan_number(ptr);
+    if(length == 0 || (ptr[length] != ' ' && ptr[length] != '\0')
+       || length + point_length > sizeof(number) - 1) {
+      return -1;
+    }
+    if(n < count) {
+      for(i = 0, k = 0; i < length; ++i) {
+        if(ptr[i] == '.') {
+          memcpy(number + k, point, point_length);
+          k += (int)point_length;
+        } else {
+          number[k++] = ptr[i];
+        }
+      }
+      number[k] = '\0';
+      value = strtod(number, &end);
+      if(end != number + k) {
+        return -1;
+      }
+      values[n] = value;
+    }
+    ++n;
+    ptr += length;
+    if(*ptr == '\0') {
+      return n;
+    }
+    ++ptr;
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
 long
 libeep_get_zero_offset(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   if(obj->data_type==dt_avr) {
     return (int)(libeep_get_sample_frequency(handle) * eep_get_pre_stimulus_interval(obj->eep));
   }
@@ -1234,6 +2291,9 @@ libeep_get_zero_offset(cntfile_t handle) {
 const char *
 libeep_get_condition_label(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   if(obj->data_type==dt_avr) {
     return eep_get_conditionlabel(obj->eep);
   }
@@ -1243,6 +2303,9 @@ libeep_get_condition_label(cntfile_t handle) {
 const char *
 libeep_get_condition_color(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return NULL;
+  }
   if(obj->data_type==dt_avr) {
     return eep_get_conditioncolor(obj->eep);
   }
@@ -1252,6 +2315,9 @@ libeep_get_condition_color(cntfile_t handle) {
 long
 libeep_get_trials_total(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   if(obj->data_type==dt_avr) {
     return eep_get_total_trials(obj->eep);
   }
@@ -1261,6 +2327,9 @@ libeep_get_trials_total(cntfile_t handle) {
 long
 libeep_get_trials_averaged(cntfile_t handle) {
   struct _libeep_entry * obj=_libeep_get_object(handle, om_read);
+  if(obj == NULL) {
+    return -1;
+  }
   if(obj->data_type==dt_avr) {
     return eep_get_averaged_trials(obj->eep);
   }
@@ -1280,6 +2349,9 @@ int libeep_add_channel(chaninfo_t handle, const char *label, const char *ref_lab
   const char *default_ref_label = "ref";
   const char *default_unit = "uV";
   struct _libeep_channels * obj = _libeep_get_channels(handle);
+  if(obj == NULL) {
+    return -1;
+  }
   // the channel label shall have a value; ref_label and unit might be NULL
   if (label == NULL) {
     return obj->count;
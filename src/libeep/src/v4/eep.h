@@ -3,6 +3,7 @@
 
 // system
 #include <time.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -41,6 +42,21 @@ The handle obtained in this way will be automatically disposed when libeep_exit(
 */
 typedef int chaninfo_t;
 
+/*
+Handles of all three kinds are non-negative. A disposed handle becomes invalid, its slot is
+reused by later handles with a new generation number, so a stale handle never refers to a
+newer object. Functions called with an invalid handle, or with a CNT handle of the wrong open
+mode, print a message and return -1 for handles, counts and status codes, NULL for strings
+and buffers, 0 for scales and characters, and do nothing otherwise.
+All handle operations may be called from several threads. Calls on different handles run
+concurrently. The sample reads and writes, libeep_add_trigger() and the statistics and trace
+functions of one handle are serialized by a lock of that handle, so a handle may be shared
+between threads for these; a borrowed buffer then stays valid only until the next call from
+any thread. The configuration calls of a write handle, like libeep_set_compression_level(),
+shall be made before it is shared, and libeep_close() shall not overlap any other call with
+that handle.
+*/
+
 /**
  * @brief init library
  */
@@ -54,6 +70,37 @@ void libeep_exit();
  * @return version(do not free this string)
  */
 const char * libeep_get_version();
+/**
+* allocation accounting of one tag and handle, see libeep_get_memory_stats()
+*/
+struct libeep_memory_stats {
+  const char * tag;            // allocation tag such as "epochv" or "buf", NULL for the sum over all tags
+  int          handle;         // CNT handle, -1 for memory allocated outside of one, -2 for the sum over all handles
+  uint64_t     live_bytes;     // bytes allocated and not yet freed
+  uint64_t     peak_bytes;     // largest value of live_bytes
+  uint64_t     live_blocks;    // blocks allocated and not yet freed
+  uint64_t     allocations;
+  uint64_t     reallocations;
+  uint64_t     frees;
+};
+/**
+* @brief account the memory libeep allocates from now on per tag and CNT handle. Enabling again resets the statistics
+* @param enable if not zero, account allocations, otherwise stop and discard the statistics
+*/
+void libeep_set_memory_accounting(int enable);
+/**
+* @brief set the peaks to the live sizes and the allocation counts to zero
+*/
+void libeep_reset_memory_stats();
+/**
+* @brief get the memory accounting statistics. There is one entry per tag and handle, plus the sums
+* over all tags of each handle (tag NULL), over all handles of each tag (handle -2) and the total.
+* Memory is charged to the handle of the allocating call; entries of closed handles are kept
+* @param statv array to fill in, may be NULL if statc is 0
+* @param statc size of the array
+* @return number of entries, which may be larger than statc
+*/
+int libeep_get_memory_stats(struct libeep_memory_stats *statv, int statc);
 /**
  * @brief open file for reading
  * @param filename the filename to the CNT or AVR to open
@@ -75,6 +122,16 @@ cntfile_t libeep_read_with_external_triggers(const char *filename);
  * @return -1 on error, handle otherwise
  */
 cntfile_t libeep_write_cnt(const char *filename, int rate, chaninfo_t channel_info_handle, int rf64);
+/**
+ * @brief open cnt file for writing with a given compression epoch length
+ * @param filename the filename to the CNT or AVR to open
+ * @param rate the sampling rate(in Hz)
+ * @param channel_info_handle handle obtained by a call to libeep_create_channel_info (and eventually populated by calls to libeep_add_channel). Can not be invalid
+ * @param rf64 if not zero, create 64-bit riff variant
+ * @param epoch_length number of samples per compressed epoch. Short epochs give cheaper random access and lower writer latency, long epochs compress better. libeep_write_cnt() uses the sampling rate
+ * @return -1 on error, handle otherwise
+ */
+cntfile_t libeep_write_cnt_with_epoch_length(const char *filename, int rate, chaninfo_t channel_info_handle, int rf64, int epoch_length);
 /**
  * @brief close data file
  * @param handle handle obtained by a call to either libeep_read() or libeep_write_cnt()
@@ -123,6 +180,26 @@ const char * libeep_get_channel_reference(cntfile_t handle, int index);
  * @return scaling of the channel
  */
 float libeep_get_channel_scale(cntfile_t handle, int index);
+/**
+* information of one channel, see libeep_get_channels(). The strings belong to the file, they are
+* valid until it is closed and NULL if not set
+*/
+struct libeep_channel {
+  const char * label;
+  const char * unit;
+  const char * reference;
+  const char * status;
+  const char * type;
+  float        scale;         // see libeep_get_channel_scale()
+};
+/**
+* @brief get the information of all the channels in one call
+* @param handle handle obtained by a call to libeep_read()
+* @param channelv array to fill in, may be NULL if channelc is 0
+* @param channelc size of the array
+* @return number of channels, which may be larger than channelc, or -1 on failure
+*/
+int libeep_get_channels(cntfile_t handle, struct libeep_channel *channelv, int channelc);
 /**
  * @brief get the channel index
  * @param handle handle obtained by a call to libeep_read()
@@ -141,6 +218,12 @@ int libeep_get_sample_frequency(cntfile_t handle);
  * @return the number of samples belonging to this recording
  */
 long libeep_get_sample_count(cntfile_t handle);
+/**
+ * @brief get the number of samples per compressed epoch
+ * @param handle handle obtained by a call to libeep_read()
+ * @return the epoch length in samples
+ */
+int libeep_get_epoch_length(cntfile_t handle);
 /**
  * @brief get data samples
  * @param handle handle obtained by a call to libeep_read()
@@ -149,6 +232,39 @@ long libeep_get_sample_count(cntfile_t handle);
  * @return dynamically allocated array of samples or NULL on failure(Result should be freed with a call to libeep_free_samples)
  */
 float * libeep_get_samples(cntfile_t handle, long from, long to);
+/**
+ * @brief get data samples without allocating a result
+ * @param handle handle obtained by a call to libeep_read()
+ * @param from the first sample to be returned
+ * @param to the end sample to be returned
+ * @return array of samples or NULL on failure. The array is scratch memory of the handle, 64 byte aligned and reused by later calls: it stays valid until the next call with this handle and shall not be freed
+ */
+const float * libeep_get_samples_borrowed(cntfile_t handle, long from, long to);
+/**
+ * @brief get data samples into a buffer of the caller
+ * @param handle handle obtained by a call to libeep_read()
+ * @param from the first sample to be returned
+ * @param to the end sample to be returned
+ * @param buffer array of at least (to - from) * channel count floats, filled sample by sample
+ * @return 0 on success, -1 on failure
+ */
+int libeep_get_samples_into(cntfile_t handle, long from, long to, float *buffer);
+/**
+ * @brief get the samples of some channels into rows of a double buffer of the caller
+ * @param handle handle obtained by a call to libeep_read()
+ * @param from the first sample to be returned
+ * @param to the end sample to be returned
+ * @param picks indices of the channels, one row of out per index
+ * @param pick_count number of indices in picks
+ * @param scales one factor per pick applied on top of the channel scale, or NULL
+ * @param out array of at least (pick_count - 1) * stride + (to - from) doubles
+ * @param stride distance in doubles between the starts of consecutive rows, at least to - from
+ * @return 0 on success, -1 on failure
+ *
+ * The samples are decoded one compression epoch at a time and written straight
+ * into their row, no buffer of all the channels is allocated for the range.
+ */
+int libeep_get_samples_picked(cntfile_t handle, long from, long to, const int *picks, int pick_count, const double *scales, double *out, long stride);
 /**
 * @brief deallocates the buffer returned by libeep_get_samples
 * @param data pointer to float array obtained by a call to libeep_get_samples()
@@ -161,6 +277,14 @@ void libeep_free_samples(float *data);
  * @param n number of items in array
  */
 void libeep_add_samples(cntfile_t handle, const float *data, int n);
+/**
+ * @brief add data samples given in double precision
+ * @param handle handle obtained by a call to libeep_write_cnt()
+ * @param data pointer to double array, scaled like the floats of libeep_add_samples()
+ * @param n number of samples in array
+ * @return 0 on success, -1 on failure, e.g. if the samples cannot be written to disk
+ */
+int libeep_add_samples_double(cntfile_t handle, const double *data, int n);
 /**
 * @brief add data samples
 * @param handle handle obtained by a call to libeep_write_cnt()
@@ -168,6 +292,148 @@ void libeep_add_samples(cntfile_t handle, const float *data, int n);
 * @param n number of items in array
 */
 void libeep_add_raw_samples(cntfile_t handle, const int32_t *data, int n);
+/**
+ * @brief add data samples laid out with arbitrary strides
+ * @param handle handle obtained by a call to libeep_write_cnt()
+ * @param data pointer to the first channel of the first sample
+ * @param n number of samples
+ * @param channel_stride distance in floats between two channels of a sample
+ * @param sample_stride distance in floats between two samples of a channel
+ * @return 0 on success, -1 on failure, e.g. if the samples cannot be written to disk
+ *
+ * The samples are interleaved while they are converted, channel major data
+ * (channel_stride of n, sample_stride of 1) is written without a copy.
+ */
+int libeep_add_samples_strided(cntfile_t handle, const float *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride);
+/**
+ * @brief add data samples given in double precision, see libeep_add_samples_strided()
+ */
+int libeep_add_samples_double_strided(cntfile_t handle, const double *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride);
+/**
+ * @brief add unscaled data samples, see libeep_add_samples_strided()
+ */
+int libeep_add_raw_samples_strided(cntfile_t handle, const int32_t *data, int n, ptrdiff_t channel_stride, ptrdiff_t sample_stride);
+/**
+* @brief collect compressed data in large blocks before writing, and reserve disk space ahead of the writes
+* @param handle handle obtained by a call to libeep_write_cnt(), before any samples are added
+* @param buffer_size size of the write buffer in bytes, 0 writes every epoch directly
+* @param prealloc_size disk space is reserved in steps of this many bytes and trimmed on libeep_close(), 0 disables
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_write_buffering(cntfile_t handle, int64_t buffer_size, int64_t prealloc_size);
+/**
+* @brief choose the channel sequence used for compression from the first epoch instead of using the channel order. Smaller files, same data
+* @param handle handle obtained by a call to libeep_write_cnt(), before the first epoch is complete
+* @param enable if not zero, optimize the channel sequence
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_channel_order_optimization(cntfile_t handle, int enable);
+/**
+* @brief set the effort of the compression encoder, trading compression ratio for CPU time. Files written at any level are readable by all readers
+* @param handle handle obtained by a call to libeep_write_cnt()
+* @param level 0: try every prediction method on every sample (default), 1: rank the methods on a subsample, 2: reuse the method of the previous epochs per channel
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_compression_level(cntfile_t handle, int level);
+/**
+* @brief code the compressed channel blocks with adaptive Rice codes where that is smaller. The data is stored in a new chunk type that older readers do not read
+* @param handle handle obtained by a call to libeep_write_cnt(), before the first epoch is complete
+* @param enable if not zero, use adaptive coding
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_adaptive_coding(cntfile_t handle, int enable);
+/**
+* @brief let the compression encoder also try linear predictors of order 3 to 8 per channel and epoch, used where that is smaller. The file is then stamped with file version 5.0, which older readers refuse
+* @param handle handle obtained by a call to libeep_write_cnt(), before the first epoch is complete
+* @param enable if not zero, try linear prediction
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_lpc_prediction(cntfile_t handle, int enable);
+/**
+* compression statistics of one channel, see libeep_get_compression_stats()
+*/
+struct libeep_compression_stats {
+  uint64_t blocks;        // compressed blocks, one per channel and epoch
+  uint64_t samples;       // samples in these blocks
+  uint64_t bytes;         // compressed size of these blocks
+  uint64_t methods[16];   // blocks per method: 0 copy, 1 time, 2 time2, 3 chan, +4 for Rice coding, +8 for 32 bit coding, 12 linear prediction
+  uint64_t nbits;         // sum of residual bit widths over the blocks that are not copies
+  uint64_t nexcbits;      // sum of exception bit widths over the blocks that are not copies
+  int32_t  nbits_max;     // largest residual bit width
+  int32_t  nexcbits_max;  // largest exception bit width
+  uint64_t exceptions;    // residuals too large for the residual bit width
+};
+/**
+* @brief collect compression statistics for every EEG epoch read or written from now on. Enabling again resets them
+* @param handle handle obtained by a call to libeep_read() or libeep_write_cnt()
+* @param enable if not zero, collect statistics, otherwise stop and discard them
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_compression_stats(cntfile_t handle, int enable);
+/**
+* @brief reset the collected compression statistics, e.g. to get them per epoch
+* @param handle handle obtained by a call to libeep_read() or libeep_write_cnt()
+* @return 0 on success, -1 if statistics are not collected
+*/
+int libeep_reset_compression_stats(cntfile_t handle);
+/**
+* @brief get the compression statistics of a channel. Epochs read more than once are counted more than once
+* @param handle handle obtained by a call to libeep_read() or libeep_write_cnt()
+* @param channel index of the channel in the file
+* @param cs statistics to fill in
+* @return 0 on success, -1 on failure
+*/
+int libeep_get_compression_stats(cntfile_t handle, int channel, struct libeep_compression_stats *cs);
+/**
+* @brief add one epoch to the compression statistics without reading its samples. Read positions are not changed
+* @param handle handle obtained by a call to libeep_read(), with statistics enabled
+* @param epoch index of the epoch, see libeep_get_epoch_length()
+* @return 0 on success, -1 on failure
+*/
+int libeep_scan_compression_stats(cntfile_t handle, long epoch);
+/**
+* read performance counters of a handle, see libeep_get_stats(). Times are in nanoseconds, the
+* histograms count epochs by the time their read or decode took, bin k holding [2^k, 2^(k+1)) ns
+*/
+#define LIBEEP_STATS_BINS 32
+struct libeep_stats {
+  uint64_t bytes_read;                     // stored epoch bytes read from the file
+  uint64_t epochs_decoded;
+  uint64_t seeks;                          // repositionings, one per read of samples
+  uint64_t cache_hits;                     // seeks within the epoch decoded last
+  uint64_t read_ns;                        // time reading epochs from the file
+  uint64_t decode_ns;                      // time decompressing epochs
+  uint64_t scale_ns;                       // time scaling samples to physical units
+  uint64_t read_hist[LIBEEP_STATS_BINS];
+  uint64_t decode_hist[LIBEEP_STATS_BINS];
+};
+/**
+* @brief get the read performance counters, which are always collected
+* @param handle handle obtained by a call to libeep_read()
+* @param stats counters to fill in
+* @return 0 on success, -1 on failure
+*/
+int libeep_get_stats(cntfile_t handle, struct libeep_stats *stats);
+/**
+* @brief zero the read performance counters and drop the recorded trace
+* @param handle handle obtained by a call to libeep_read()
+* @return 0 on success, -1 on failure
+*/
+int libeep_reset_stats(cntfile_t handle);
+/**
+* @brief record the read and decode spans of epochs from now on, for libeep_write_trace()
+* @param handle handle obtained by a call to libeep_read()
+* @param max_events number of spans to keep, later ones are not recorded. 0 stops recording and drops the trace
+* @return 0 on success, -1 on failure
+*/
+int libeep_set_trace(cntfile_t handle, int max_events);
+/**
+* @brief write the recorded spans as Chrome trace event JSON, to be opened in chrome://tracing or Perfetto
+* @param handle handle obtained by a call to libeep_read()
+* @param filename the file to write
+* @return 0 on success, -1 on failure
+*/
+int libeep_write_trace(cntfile_t handle, const char *filename);
 /**
 * @brief get data samples
 * @param handle handle obtained by a call to libeep_read()
@@ -177,6 +443,23 @@ void libeep_add_raw_samples(cntfile_t handle, const int32_t *data, int n);
 */
 int32_t * libeep_get_raw_samples(cntfile_t handle, long from, long to);
 /**
+* @brief get raw data samples without allocating a result
+* @param handle handle obtained by a call to libeep_read()
+* @param from the first sample to be returned
+* @param to the end sample to be returned
+* @return array of samples or NULL on failure. Like libeep_get_samples_borrowed() the array stays valid until the next call with this handle and shall not be freed
+*/
+const int32_t * libeep_get_raw_samples_borrowed(cntfile_t handle, long from, long to);
+/**
+* @brief get unscaled data samples into a buffer of the caller
+* @param handle handle obtained by a call to libeep_read()
+* @param from the first sample to be returned
+* @param to the end sample to be returned
+* @param buffer array of at least (to - from) * channel count int32_t, filled sample by sample
+* @return 0 on success, -1 on failure or for average data
+*/
+int libeep_get_raw_samples_into(cntfile_t handle, long from, long to, int32_t *buffer);
+/**
 * @brief deallocates the buffer returned by libeep_get_raw_samples
 * @param data pointer to float array obtained by a call to libeep_get_raw_samples()
 */
@@ -186,6 +469,10 @@ void libeep_free_raw_samples(int32_t *data);
 */
 recinfo_t libeep_create_recinfo();
 /**
+* @brief close recording info handle, the information added to CNT files is kept
+*/
+void libeep_close_recinfo(recinfo_t);
+/**
 * @brief add recording info to file
 * @param recinfo the handle to a recording info structure
 */
@@ -389,6 +676,40 @@ void libeep_set_patient_handedness(recinfo_t handle, char value);
 */
 void libeep_get_date_of_birth(cntfile_t handle, int * year, int * month, int *day);
 /**
+* recording information of a file, see libeep_get_recording(). The strings belong to the file, they
+* are valid until it is closed and NULL if the file has no recording info, as the getters above
+*/
+struct libeep_recording {
+  time_t       start_time;              // see libeep_get_start_time()
+  double       start_date;              // see libeep_get_start_date_and_fraction()
+  double       start_fraction;
+  const char * hospital;
+  const char * test_name;
+  const char * test_serial;
+  const char * physician;
+  const char * technician;
+  const char * machine_make;
+  const char * machine_model;
+  const char * machine_serial_number;
+  const char * patient_name;
+  const char * patient_id;
+  const char * patient_address;
+  const char * patient_phone;
+  const char * comment;
+  char         patient_sex;
+  char         patient_handedness;
+  int          date_of_birth_year;      // 0 if the file has no recording info
+  int          date_of_birth_month;
+  int          date_of_birth_day;
+};
+/**
+* @brief get all the recording information in one call
+* @param handle handle obtained by a call to libeep_read()
+* @param recording information to fill in
+* @return 0 on success, -1 on failure
+*/
+int libeep_get_recording(cntfile_t handle, struct libeep_recording *recording);
+/**
 * @brief sets information about the patients date of birth
 * @param year gregorian year
 * @param month 1-12
@@ -434,6 +755,40 @@ struct libeep_trigger_extension {
 * @param duration duration in samples of the trigger
 */
 const char *libeep_get_trigger_with_extensions(cntfile_t handle, int idx, uint64_t *sample, struct libeep_trigger_extension * te);
+/**
+* columns filled by libeep_get_triggers(), one entry per trigger. Columns left NULL are skipped.
+* The strings belong to the file, they are valid until it is closed and NULL if not set
+*/
+struct libeep_trigger_columns {
+  uint64_t    * samples;
+  uint64_t    * durations;      // in samples
+  int32_t     * types;
+  int32_t     * codes;
+  const char ** labels;
+  const char ** conditions;
+  const char ** descriptions;
+  const char ** impedances;     // see libeep_parse_impedances()
+};
+/**
+* @brief get all the triggers in one call, column by column
+* @param handle handle obtained by a call to libeep_read()
+* @param columns columns of at least count entries to fill in
+* @param count number of triggers to fill in
+* @return number of triggers, which may be larger than count, or -1 on failure
+*/
+int libeep_get_triggers(cntfile_t handle, const struct libeep_trigger_columns *columns, int count);
+/**
+* @brief parse the impedances of a trigger, numbers separated by single spaces
+* @param impedances string of a trigger, see struct libeep_trigger_extension
+* @param values array to fill in, may be NULL if count is 0
+* @param count size of values
+* @return number of values in the string, which may be larger than count, or -1 if the string has another form
+*
+* The numbers are read with a '.' decimal point whatever the locale, in the syntax of
+* strtod() without hexadecimal numbers. Numbers of more than 62 characters are refused.
+* The locale shall not be changed by another thread during the call.
+*/
+int libeep_parse_impedances(const char *impedances, double *values, int count);
 /**
  * @brief get zero offset(averages only)
  * @param handle handle obtained by a call to libeep_read()
@@ -481,5 +836,26 @@ void libeep_close_channel_info(chaninfo_t);
 * @return the number of channels if succesfull; -1 on error
 */
 int libeep_add_channel(chaninfo_t handle, const char *label, const char *ref_label, const char *unit);
+/**
+* parameters of a synthetic recording, see libeep_write_synthetic()
+*/
+struct libeep_synthetic {
+  int      channel_count;
+  int      rate;             // sampling rate in Hz
+  double   duration;         // length in seconds
+  int      rf64;             // if not zero, create 64-bit riff variant
+  double   trigger_rate;     // mean number of triggers per second, 0 for none
+  int      segments;         // number of recording segments, the recording pauses between two of them. More than one needs sidecars
+  int      sidecars;         // if not zero, also write the triggers and two impedance measurements to a .evt file, and the segments to a .seg file
+  double   line_frequency;   // power line frequency in Hz
+  uint64_t seed;             // the same seed writes the same samples and triggers
+};
+/**
+* @brief write a CNT file of synthetic EEG for testing at scale. The signal is pink noise, an alpha rhythm and line noise with blinks and electrode pops, so it compresses like recorded data. Triggers have codes 1 to 8 at random times
+* @param filename the filename of the CNT file, sidecars are written next to it
+* @param synthetic parameters of the recording
+* @return 0 on success, -1 on failure
+*/
+int libeep_write_synthetic(const char *filename, const struct libeep_synthetic *synthetic);
 
 #endif
@@ -0,0 +1,372 @@
+// system
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// libeep
+#include <v4/eep.h>
+#include <cnt/evt.h>
+#include <cnt/seg.h>
+///////////////////////////////////////////////////////////////////////////////
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+/* recordings start on 2024-01-01 12:00:00 UTC */
+#define SYNTH_START_TIME    1704110400.0
+/* seconds from the excel epoch, 1899-12-30, to the unix epoch */
+#define SYNTH_EXCEL_OFFSET  2209161600.0
+/* pause between two segments, in seconds */
+#define SYNTH_SEGMENT_GAP   10.0
+/* mean number of blinks and electrode pops per second */
+#define SYNTH_BLINK_RATE    0.2
+#define SYNTH_POP_RATE      (1.0 / 60.0)
+#define SYNTH_TRIGGER_CODES 8
+///////////////////////////////////////////////////////////////////////////////
+/* labels of a 64 channel cap, later channels are named E65, E66, ... */
+static const char * _synth_labels[] = {
+  "Fp1", "Fpz", "Fp2", "F7",  "F3",  "Fz",  "F4",  "F8",
+  "FC5", "FC1", "FC2", "FC6", "M1",  "T7",  "C3",  "Cz",
+  "C4",  "T8",  "M2",  "CP5", "CP1", "CP2", "CP6", "P7",
+  "P3",  "Pz",  "P4",  "P8",  "POz", "O1",  "O2",  "EOG",
+  "AF7", "AF3", "AF4", "AF8", "F5",  "F1",  "F2",  "F6",
+  "FC3", "FCz", "FC4", "C5",  "C1",  "C2",  "C6",  "CP3",
+  "CP4", "P5",  "P1",  "P2",  "P6",  "PO5", "PO3", "PO4",
+  "PO6", "FT7", "FT8", "TP7", "TP8", "PO7", "PO8", "Oz"
+};
+#define SYNTH_LABEL_COUNT (int)(sizeof(_synth_labels) / sizeof(_synth_labels[0]))
+///////////////////////////////////////////////////////////////////////////////
+struct _synth_channel {
+  double pink[3];      // pink noise filter state
+  double offset;       // electrode offset, uV
+  double alpha_cos;    // alpha rhythm, uV, split over sin and cos for the phase
+  double alpha_sin;
+  double line_cos;     // line noise, uV
+  double line_sin;
+  double blink;        // share of the blink amplitude
+};
+///////////////////////////////////////////////////////////////////////////////
+/* splitmix64 */
+static uint64_t
+_synth_next(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* uniform in [0, 1) */
+static double
+_synth_uniform(uint64_t *state) {
+  return (double)(_synth_next(state) >> 11) / 9007199254740992.0;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* pair of standard normal values, Box-Muller */
+static void
+_synth_gauss(uint64_t *state, double *g0, double *g1) {
+  double r = sqrt(-2.0 * log(1.0 - _synth_uniform(state)));
+  double phi = 2 * M_PI * _synth_uniform(state);
+  *g0 = r * cos(phi);
+  *g1 = r * sin(phi);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* samples to the next event of a Poisson process, never 0 */
+static uint64_t
+_synth_wait(uint64_t *state, double events_per_sample) {
+  return 1 + (uint64_t)(-log(1.0 - _synth_uniform(state)) / events_per_sample);
+}
+///////////////////////////////////////////////////////////////////////////////
+/* seconds since the unix epoch to an excel date, with the sub-second part in
+   the fraction */
+static void
+_synth_excel_time(double t, double *date, double *fraction) {
+  double whole = floor(t);
+  *date = (whole + SYNTH_EXCEL_OFFSET) / 86400.0;
+  *fraction = t - whole;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* filename with its extension replaced, to be freed */
+static char *
+_synth_sidecar_name(const char *filename, const char *extension) {
+  const char *dot = strrchr(filename, '.');
+  size_t length = dot == NULL ? strlen(filename) : (size_t)(dot - filename);
+  char *rv = (char *)malloc(length + strlen(extension) + 2);
+  if(rv != NULL) {
+    memcpy(rv, filename, length);
+    sprintf(rv + length, ".%s", extension);
+  }
+  return rv;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+_synth_init_channel(struct _synth_channel *ch, const char *label, uint64_t *state) {
+  double alpha, line, phase;
+
+  memset(ch, 0, sizeof(struct _synth_channel));
+  ch->offset = 400.0 * (_synth_uniform(state) - 0.5);
+
+  /* alpha is strongest over the back of the head, blinks at the front */
+  alpha = 4.0;
+  if(label[0] == 'P' || label[0] == 'O') {
+    alpha = 15.0;
+  }
+  phase = 0.3 * M_PI * _synth_uniform(state);
+  ch->alpha_cos = alpha * cos(phase);
+  ch->alpha_sin = alpha * sin(phase);
+
+  line = 1.0 + 5.0 * _synth_uniform(state);
+  phase = 2 * M_PI * _synth_uniform(state);
+  ch->line_cos = line * cos(phase);
+  ch->line_sin = line * sin(phase);
+
+  if(!strcmp(label, "EOG")) {
+    ch->blink = 1.0;
+  } else if(!strncmp(label, "Fp", 2) || !strncmp(label, "AF", 2)) {
+    ch->blink = 0.6;
+  } else if(label[0] == 'F') {
+    ch->blink = 0.25;
+  } else {
+    ch->blink = 0.03;
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
+static libeep_evt_event_t *
+_synth_event(double t, int32_t code, char *description, char *impedances) {
+  libeep_evt_event_t *ev = libeep_evt_event_new();
+  ev->type = 1;
+  ev->original = 1;
+  ev->code = code;
+  ev->description = description;
+  ev->impedances = impedances;
+  _synth_excel_time(t, &ev->time_stamp.date, &ev->time_stamp.fraction);
+  return ev;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* impedances of all channels in kOhm, as the reader formats them */
+static char *
+_synth_impedances(int channel_count, uint64_t *state) {
+  char *rv = (char *)malloc(16 * channel_count + 1);
+  char *p = rv;
+  int c;
+  if(rv == NULL) {
+    return NULL;
+  }
+  for(c = 0; c < channel_count; ++c) {
+    p += sprintf(p, c ? " %f" : "%f", 1.0 + 20.0 * _synth_uniform(state));
+  }
+  return rv;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+_synth_append(libeep_evt_t *evt, libeep_evt_event_t *ev) {
+  if(ev == NULL) {
+    return;
+  }
+  ev->visible_id = evt->evt_list_last == NULL ? 1 : evt->evt_list_last->visible_id + 1;
+  if(evt->evt_list_first == NULL) {
+    evt->evt_list_first = ev;
+  } else {
+    evt->evt_list_last->next_event = ev;
+  }
+  evt->evt_list_last = ev;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* first sample of a segment, the segments split the recording evenly */
+static uint64_t
+_synth_segment_first(int segment, uint64_t sample_count, int segments) {
+  return (segment * sample_count + segments - 1) / segments;
+}
+///////////////////////////////////////////////////////////////////////////////
+/* wall clock time of a sample, the recording pauses between segments */
+static double
+_synth_sample_time(uint64_t s, uint64_t sample_count, int rate, int segments) {
+  int segment = (int)(s * segments / sample_count);
+  /* quarter sample later, the reader truncates the offset */
+  return SYNTH_START_TIME + ((double)s + 0.25) / rate + segment * SYNTH_SEGMENT_GAP;
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+_synth_write_sidecars(const char *filename, const struct libeep_synthetic *synthetic, uint64_t sample_count, libeep_evt_t *evt) {
+  libeep_seg_t seg;
+  char *name;
+  double t;
+  int k, status = 0;
+
+  name = _synth_sidecar_name(filename, "evt");
+  if(name == NULL || libeep_evt_write(name, evt)) {
+    fprintf(stderr, "libeep: cannot write the events of %s\n", filename);
+    status = -1;
+  }
+  free(name);
+
+  if(status == 0 && synthetic->segments > 1) {
+    seg.count = synthetic->segments - 1;
+    seg.array = (libeep_seg_info_t *)malloc(sizeof(libeep_seg_info_t) * seg.count);
+    name = _synth_sidecar_name(filename, "seg");
+    if(seg.array != NULL) {
+      for(k = 1; k < synthetic->segments; ++k) {
+        uint64_t first = _synth_segment_first(k, sample_count, synthetic->segments);
+        uint64_t end = _synth_segment_first(k + 1, sample_count, synthetic->segments);
+        t = SYNTH_START_TIME + (double)first / synthetic->rate + k * SYNTH_SEGMENT_GAP;
+        _synth_excel_time(t, &seg.array[k - 1].date, &seg.array[k - 1].fraction);
+        seg.array[k - 1].sample_count = (uint32_t)(end - first);
+      }
+    }
+    if(seg.array == NULL || name == NULL || libeep_seg_write(name, &seg)) {
+      fprintf(stderr, "libeep: cannot write the segments of %s\n", filename);
+      status = -1;
+    }
+    free(seg.array);
+    free(name);
+  }
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+libeep_write_synthetic(const char *filename, const struct libeep_synthetic *synthetic) {
+  struct _synth_channel *channels;
+  libeep_evt_t *evt = NULL;
+  chaninfo_t channel_info;
+  recinfo_t recording_info;
+  cntfile_t handle;
+  uint64_t state = synthetic->seed;
+  /* separate stream, the samples do not depend on the sidecars */
+  uint64_t impedance_state = ~synthetic->seed;
+  uint64_t sample_count, s, next_trigger, next_blink, next_pop, blink_start = 0, blink_length;
+  double date, fraction, alpha_freq, t, envelope, alpha_c, alpha_s, line_c, line_s;
+  double g0, g1 = 0, pink, blink = 0, blink_amplitude = 0, pop = 0, pop_decay;
+  float *block;
+  char label[16];
+  int channel_count = synthetic->channel_count;
+  int rate = synthetic->rate;
+  int c, n, block_length, pop_channel = 0, status = 0;
+
+  if(channel_count < 1 || rate < 1 || synthetic->duration <= 0 || synthetic->trigger_rate < 0
+     || synthetic->segments < 1 || (synthetic->segments > 1 && !synthetic->sidecars)) {
+    fprintf(stderr, "libeep: invalid synthetic recording parameters\n");
+    return -1;
+  }
+  sample_count = (uint64_t)(synthetic->duration * rate + 0.5);
+  if(sample_count < (uint64_t)synthetic->segments) {
+    fprintf(stderr, "libeep: invalid synthetic recording parameters\n");
+    return -1;
+  }
+
+  channel_info = libeep_create_channel_info();
+  for(c = 0; c < channel_count; ++c) {
+    if(c < SYNTH_LABEL_COUNT) {
+      strcpy(label, _synth_labels[c]);
+    } else {
+      sprintf(label, "E%i", c + 1);
+    }
+    libeep_add_channel(channel_info, label, "CPz", "uV");
+  }
+  handle = libeep_write_cnt(filename, rate, channel_info, synthetic->rf64);
+  libeep_close_channel_info(channel_info);
+  if(handle == -1) {
+    return -1;
+  }
+  recording_info = libeep_create_recinfo();
+  _synth_excel_time(SYNTH_START_TIME, &date, &fraction);
+  libeep_set_start_date_and_fraction(recording_info, date, fraction);
+  libeep_add_recording_info(handle, recording_info);
+  libeep_close_recinfo(recording_info);
+
+  channels = (struct _synth_channel *)malloc(sizeof(struct _synth_channel) * channel_count);
+  block = (float *)malloc(sizeof(float) * rate * channel_count);
+  if(synthetic->sidecars) {
+    evt = libeep_evt_new();
+  }
+  if(channels == NULL || block == NULL || (synthetic->sidecars && evt == NULL)) {
+    fprintf(stderr, "libeep: cannot allocate the synthetic recording\n");
+    free(channels);
+    free(block);
+    libeep_evt_delete(evt);
+    libeep_close(handle);
+    return -1;
+  }
+  for(c = 0; c < channel_count; ++c) {
+    _synth_init_channel(&channels[c], c < SYNTH_LABEL_COUNT ? _synth_labels[c] : "E", &state);
+  }
+  alpha_freq = 9.0 + 2.0 * _synth_uniform(&state);
+  blink_length = (uint64_t)(0.3 * rate) + 1;
+  pop_decay = exp(-2.0 / rate);
+  next_trigger = synthetic->trigger_rate > 0 ? _synth_wait(&state, synthetic->trigger_rate / rate) : sample_count;
+  next_blink = _synth_wait(&state, SYNTH_BLINK_RATE / rate);
+  next_pop = _synth_wait(&state, SYNTH_POP_RATE / rate);
+  if(evt != NULL) {
+    _synth_append(evt, _synth_event(_synth_sample_time(0, sample_count, rate, synthetic->segments),
+                                    0, strdup("Impedance"), _synth_impedances(channel_count, &impedance_state)));
+  }
+
+  for(s = 0; s < sample_count; s += block_length) {
+    block_length = sample_count - s < (uint64_t)rate ? (int)(sample_count - s) : rate;
+    for(n = 0; n < block_length; ++n) {
+      uint64_t i = s + n;
+
+      /* triggers, blinks and electrode pops arrive at random */
+      if(i == next_trigger) {
+        int32_t code = 1 + (int32_t)(_synth_next(&state) % SYNTH_TRIGGER_CODES);
+        sprintf(label, "%i", code);
+        libeep_add_trigger(handle, i, label);
+        if(evt != NULL) {
+          _synth_append(evt, _synth_event(_synth_sample_time(i, sample_count, rate, synthetic->segments), code, NULL, NULL));
+        }
+        next_trigger += _synth_wait(&state, synthetic->trigger_rate / rate);
+      }
+      if(i == next_blink) {
+        blink_start = i;
+        blink_amplitude = 100.0 + 150.0 * _synth_uniform(&state);
+        next_blink += blink_length + _synth_wait(&state, SYNTH_BLINK_RATE / rate);
+      }
+      if(i == next_pop) {
+        pop_channel = (int)(_synth_next(&state) % channel_count);
+        pop = (_synth_uniform(&state) < 0.5 ? -1 : 1) * (50.0 + 450.0 * _synth_uniform(&state));
+        next_pop += _synth_wait(&state, SYNTH_POP_RATE / rate);
+      }
+      blink = i >= blink_start && i < blink_start + blink_length && blink_amplitude > 0
+            ? blink_amplitude * sin(M_PI * (double)(i - blink_start) / blink_length) : 0;
+      pop *= pop_decay;
+
+      /* alpha waxes and wanes */
+      t = (double)i / rate;
+      envelope = 0.6 + 0.4 * sin(2 * M_PI * t / 7.3);
+      alpha_c = envelope * cos(2 * M_PI * alpha_freq * t);
+      alpha_s = envelope * sin(2 * M_PI * alpha_freq * t);
+      line_c = cos(2 * M_PI * synthetic->line_frequency * t);
+      line_s = sin(2 * M_PI * synthetic->line_frequency * t);
+
+      for(c = 0; c < channel_count; ++c) {
+        struct _synth_channel *ch = &channels[c];
+        /* normal values come in pairs */
+        if(c & 1) {
+          g0 = g1;
+        } else {
+          _synth_gauss(&state, &g0, &g1);
+        }
+        /* Paul Kellet's economy pink noise filter */
+        ch->pink[0] = 0.99765 * ch->pink[0] + g0 * 0.0990460;
+        ch->pink[1] = 0.96300 * ch->pink[1] + g0 * 0.2965164;
+        ch->pink[2] = 0.57000 * ch->pink[2] + g0 * 1.0526913;
+        pink = ch->pink[0] + ch->pink[1] + ch->pink[2] + g0 * 0.1848;
+        block[n * channel_count + c] = (float)(ch->offset + 3.0 * pink
+                                               + ch->alpha_sin * alpha_c + ch->alpha_cos * alpha_s
+                                               + ch->line_sin * line_c + ch->line_cos * line_s
+                                               + ch->blink * blink
+                                               + (c == pop_channel ? pop : 0));
+      }
+    }
+    libeep_add_samples(handle, block, block_length);
+  }
+  libeep_close(handle);
+
+  if(evt != NULL) {
+    _synth_append(evt, _synth_event(_synth_sample_time(sample_count - 1, sample_count, rate, synthetic->segments),
+                                    0, strdup("Impedance"), _synth_impedances(channel_count, &impedance_state)));
+    status = _synth_write_sidecars(filename, synthetic, sample_count, evt);
+    libeep_evt_delete(evt);
+  }
+  free(channels);
+  free(block);
+  return status;
+}
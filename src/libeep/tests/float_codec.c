@@ -0,0 +1,197 @@
+/*
+ * round trip of the float blocks of TIMEFREQ and AVERAGE data
+ *
+ * Data with smooth runs, noise and special values (signed zeros, subnormals,
+ * infinities, NaN) is written with plain and with compressed float blocks
+ * (eep_set_float_compression) and must read back bit identical, from the
+ * start and from a sample within an epoch. Files with compressed blocks must
+ * be stamped with file version 5.0, the others with the compatible version.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cnt/cnt.h>
+#include <cnt/cnt_version.h>
+#include <eep/eepio.h>
+
+#define CHANNELS      5
+#define COMPONENTS    3
+#define SAMPLES       1000 /* not a multiple of the epoch length */
+#define EPOCH_LENGTH  256
+#define SEEK_SAMPLE   300
+#define TEMP_FILENAME "libeep_float_codec.tmp.cnt"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+  do { \
+    if(!(cond)) { \
+      fprintf(stderr, "float_codec: "); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ++failures; \
+    } \
+  } while(0)
+
+/* xorshift, the same data on every platform */
+static uint32_t
+next_random(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+///////////////////////////////////////////////////////////////////////////////
+static float
+from_bits(uint32_t bits) {
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+fill(float *data, long sample_count, int values) {
+  static const uint32_t special[] = {
+    0x00000000, 0x80000000, 0x00000001, 0x807fffff, 0x7f800000, 0xff800000, 0x7fc00000, 0x7f7fffff
+  };
+  uint32_t state = 2463534242u;
+  long s;
+  int v;
+
+  for(s = 0; s < sample_count; ++s) {
+    for(v = 0; v < values; ++v) {
+      float *x = &data[s * values + v];
+      if(v == 0) {
+        *x = (float)sin(0.05 * s); /* smooth */
+      } else if(v == 1) {
+        *x = from_bits(next_random(&state)); /* every bit pattern */
+      } else if(v == 2) {
+        *x = (float)s; /* exact steps */
+      } else {
+        *x = (float)(next_random(&state) % 2000) * 0.25f - 250.0f;
+      }
+    }
+  }
+  for(v = 0; v < (int)(sizeof(special) / sizeof(special[0])); ++v) {
+    data[(SEEK_SAMPLE + v) * values + values - 1] = from_bits(special[v]);
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
+static int
+write_floats(eep_datatype_e type, float *data, int compress) {
+  eegchan_t *chanv = eep_chan_init(CHANNELS);
+  tf_component_t *compv;
+  eeg_t *cnt;
+  FILE *f;
+  char label[16];
+  int c, status;
+
+  for(c = 0; c < CHANNELS; ++c) {
+    sprintf(label, "E%i", c + 1);
+    eep_chan_set(chanv, (short)c, label, 1.0, 1.0, "uV");
+  }
+  if(type == DATATYPE_TIMEFREQ) {
+    compv = eep_comp_init(COMPONENTS);
+    for(c = 0; c < COMPONENTS; ++c) {
+      eep_comp_set(compv, (short)c, (float)c, "");
+    }
+    cnt = eep_init_from_tf_values(0.002, CHANNELS, chanv, COMPONENTS, compv);
+    if(cnt != NULL) {
+      eep_set_tf_type(cnt, "Test");
+      eep_set_tf_contenttype(cnt, CONTENT_POWER);
+    }
+  } else {
+    cnt = eep_init_from_values(0.002, CHANNELS, chanv);
+  }
+  if(cnt == NULL) {
+    return CNTERR_MEM;
+  }
+  f = eepio_fopen(TEMP_FILENAME, "wb");
+  if(f == NULL) {
+    eep_free(cnt);
+    return CNTERR_FILE;
+  }
+  status = eep_create_file(cnt, TEMP_FILENAME, f, NULL, 0, "float_codec");
+  if(status == CNTERR_NONE) {
+    status = eep_prepare_to_write(cnt, type, EPOCH_LENGTH, NULL);
+  }
+  if(status == CNTERR_NONE) {
+    eep_set_float_compression(cnt, compress);
+    status = eep_write_float(cnt, data, SAMPLES);
+  }
+  if(status == CNTERR_NONE) {
+    status = eep_fclose(cnt);
+  }
+  return status;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+check_type(const char *name, eep_datatype_e type, int values) {
+  float *data = (float *)malloc(sizeof(float) * SAMPLES * values);
+  float *buf = (float *)malloc(sizeof(float) * SAMPLES * values);
+  eeg_t *cnt;
+  FILE *f;
+  int compress, status;
+
+  if(data == NULL || buf == NULL) {
+    CHECK(0, "cannot allocate the %s data", name);
+    free(data);
+    free(buf);
+    return;
+  }
+  fill(data, SAMPLES, values);
+  for(compress = 0; compress < 2; ++compress) {
+    status = write_floats(type, data, compress);
+    CHECK(status == CNTERR_NONE, "%s compress=%i: cannot write (%i)", name, compress, status);
+    if(status != CNTERR_NONE) {
+      continue;
+    }
+    f = eepio_fopen(TEMP_FILENAME, "rb");
+    cnt = f != NULL ? eep_init_from_file(TEMP_FILENAME, f, &status) : NULL;
+    CHECK(cnt != NULL && status == CNTERR_NONE, "%s compress=%i: cannot open (%i)", name, compress, status);
+    if(cnt != NULL && status == CNTERR_NONE) {
+      CHECK(eep_get_fileversion_major(cnt) == (compress ? CNTVERSION_MAJOR : CNTVERSION_COMPAT_MAJOR)
+            && eep_get_fileversion_minor(cnt) == (compress ? CNTVERSION_MINOR : CNTVERSION_COMPAT_MINOR),
+            "%s compress=%i: stamped with version %i.%i", name, compress,
+            eep_get_fileversion_major(cnt), eep_get_fileversion_minor(cnt));
+
+      memset(buf, 0, sizeof(float) * SAMPLES * values);
+      status = eep_seek(cnt, type, 0, 0);
+      if(status == CNTERR_NONE) {
+        status = eep_read_float(cnt, type, buf, SAMPLES);
+      }
+      CHECK(status == CNTERR_NONE && !memcmp(buf, data, sizeof(float) * SAMPLES * values),
+            "%s compress=%i: data read back differs", name, compress);
+
+      memset(buf, 0, sizeof(float) * SAMPLES * values);
+      status = eep_seek(cnt, type, SEEK_SAMPLE, 0);
+      if(status == CNTERR_NONE) {
+        status = eep_read_float(cnt, type, buf, SAMPLES - SEEK_SAMPLE);
+      }
+      CHECK(status == CNTERR_NONE
+            && !memcmp(buf, data + SEEK_SAMPLE * values, sizeof(float) * (SAMPLES - SEEK_SAMPLE) * values),
+            "%s compress=%i: data read back from sample %i differs", name, compress, SEEK_SAMPLE);
+    }
+    if(cnt != NULL) {
+      eep_fclose(cnt);
+    } else if(f != NULL) {
+      eepio_fclose(f);
+    }
+    remove(TEMP_FILENAME);
+  }
+  free(data);
+  free(buf);
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(void) {
+  check_type("timefreq", DATATYPE_TIMEFREQ, CHANNELS * COMPONENTS);
+  check_type("average", DATATYPE_AVERAGE, CHANNELS);
+  if(failures == 0) {
+    printf("float_codec: ok\n");
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * parsing of the impedance strings of the triggers
+ *
+ * Uneven and malformed strings are checked in the C locale and, when one is
+ * installed, in a locale with a decimal comma: the strings always have a '.'
+ * decimal point.
+ */
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <v4/eep.h>
+
+#define MAX_VALUES 8
+
+static int failures = 0;
+
+/* values to expect for a string, count is -1 if it must be refused */
+struct impedance_case {
+  const char * string;
+  int          count;
+  double       values[MAX_VALUES];
+};
+
+static const struct impedance_case cases[] = {
+  { "1", 1, { 1 } },
+  { "5 10 2.5", 3, { 5, 10, 2.5 } },
+  { "0.125 -3 +4 1e3 2.5E-1 1. .5", 7, { 0.125, -3, 4, 1000, 0.25, 1, 0.5 } },
+  { "inf -Infinity NaN", 3, { INFINITY, -INFINITY, NAN } },
+  { "", -1, { 0 } },
+  { "1,5 2", -1, { 0 } },
+  { "1  2", -1, { 0 } },
+  { " 1 2", -1, { 0 } },
+  { "1 2 ", -1, { 0 } },
+  { "1\t2", -1, { 0 } },
+  { "0x10", -1, { 0 } },
+  { "1e", -1, { 0 } },
+  { ".", -1, { 0 } },
+  { "nan(1)", -1, { 0 } },
+  { "infinit", -1, { 0 } },
+  { "1 kOhm", -1, { 0 } },
+  { "1.000000000000000000000000000000000000000000000000000000000000", 1, { 1 } },
+  { "1.0000000000000000000000000000000000000000000000000000000000001", -1, { 0 } },
+};
+
+static int
+same(double a, double b) {
+  return (isnan(a) && isnan(b)) || a == b;
+}
+///////////////////////////////////////////////////////////////////////////////
+static void
+check_cases(const char *locale) {
+  double values[MAX_VALUES];
+  size_t i;
+  int k, n;
+
+  for(i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    const struct impedance_case *c = &cases[i];
+    n = libeep_parse_impedances(c->string, NULL, 0);
+    if(n != c->count) {
+      fprintf(stderr, "impedances: %s: \"%s\" counted %i values, expected %i\n", locale, c->string, n, c->count);
+      ++failures;
+      continue;
+    }
+    if(n < 0) {
+      continue;
+    }
+    /* a shorter array gets the first values and the full count */
+    memset(values, 0, sizeof(values));
+    n = libeep_parse_impedances(c->string, values, c->count - 1);
+    for(k = 0; k < c->count - 1 && same(values[k], c->values[k]); ++k) {
+    }
+    if(n != c->count || k != c->count - 1 || values[c->count - 1] != 0) {
+      fprintf(stderr, "impedances: %s: \"%s\" parsed into %i values differs\n", locale, c->string, c->count - 1);
+      ++failures;
+    }
+    n = libeep_parse_impedances(c->string, values, MAX_VALUES);
+    for(k = 0; k < c->count && same(values[k], c->values[k]); ++k) {
+    }
+    if(n != c->count || k != c->count) {
+      fprintf(stderr, "impedances: %s: \"%s\" parsed differs\n", locale, c->string);
+      ++failures;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////////////////////
+int
+main(void) {
+  static const char * const comma_locales[] = {
+    "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR", "German_Germany", NULL
+  };
+  int i;
+
+  if(libeep_parse_impedances(NULL, NULL, 0) != -1) {
+    fprintf(stderr, "impedances: NULL string accepted\n");
+    ++failures;
+  }
+  check_cases("C");
+  for(i = 0; comma_locales[i] != NULL; ++i) {
+    if(setlocale(LC_NUMERIC, comma_locales[i]) != NULL) {
+      check_cases(comma_locales[i]);
+      setlocale(LC_NUMERIC, "C");
+      break;
+    }
+  }
+  if(comma_locales[i] == NULL) {
+    printf("impedances: no locale with a decimal comma, only the C locale checked\n");
+  }
+  if(failures == 0) {
+    printf("impedances: ok\n");
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+import pytest
+from click.testing import CliRunner
+
+from antio.commands.compression_report import run
+
+
+@pytest.mark.parametrize("per_epoch", [False, True])
+def test_compression_report(per_epoch: bool, ca_208):
+    """Test the compression report entry-point."""
+    runner = CliRunner()
+    fname = str(ca_208["cnt"]["start-stop"])
+    args = [fname, "--top", "3"] + (["--per-epoch"] if per_epoch else [])
+    result = runner.invoke(run, args)
+    assert result.exit_code == 0
+    assert "Channels: 88" in result.output
+    assert "bits/sample" in result.output
+    assert "Methods:" in result.output
+    assert "Exceptions:" in result.output
+    assert "Worst epoch" in result.output
+    assert ("Worst channel" in result.output) == per_epoch
@@ -0,0 +1,20 @@
+from click.testing import CliRunner
+
+from antio.commands.synthetic import run
+from antio.libeep import read_cnt
+
+
+def test_synthetic(tmp_path):
+    """Test the synthetic recording entry-point."""
+    runner = CliRunner()
+    fname = tmp_path / "synthetic.cnt"
+    args = [str(fname), "--channels", "4", "--sfreq", "250", "--duration", "8"]
+    result = runner.invoke(run, args + ["--segments", "2", "--sidecars"])
+    assert result.exit_code == 0
+    cnt = read_cnt(fname)
+    assert cnt.get_channel_count() == 4
+    assert cnt.get_sample_count() == 2000
+    assert fname.with_suffix(".seg").exists()
+    result = runner.invoke(run, args + ["--segments", "2"])
+    assert result.exit_code != 0
+    assert "requires --sidecars" in result.output
@@ -1,13 +1,25 @@
 from __future__ import annotations
 
-from datetime import date, datetime
+import json
+import tracemalloc
+from concurrent.futures import ThreadPoolExecutor
+from datetime import date, datetime, timezone
 from itertools import product
 
 import numpy as np
 import pytest
-from numpy.testing import assert_allclose
+from numpy.testing import assert_allclose, assert_array_equal
 
-from antio.libeep import read_cnt
+from antio.libeep import (
+    RawArray,
+    get_memory_stats,
+    pyeep,
+    read_cnt,
+    reset_memory_stats,
+    set_memory_accounting,
+    write_cnt,
+    write_synthetic,
+)
 
 DATASETS: list[str] = [
     "andy_101",
@@ -75,6 +87,58 @@ def test_get_invalid_channel(dataset, request):
     assert len(info) != 0
 
 
+@pytest.mark.parametrize("dataset", DATASETS)
+def test_get_channels(dataset, request):
+    """Test getting the information of all the channels at once."""
+    dataset = request.getfixturevalue(dataset)
+    cnt = read_cnt(dataset["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    channels = cnt.get_channels(encoding="latin-1")
+    assert len(channels) == 5
+    assert all(len(field) == n_channels for field in channels)
+    getters = (
+        pyeep.get_channel_label,
+        pyeep.get_channel_unit,
+        pyeep.get_channel_reference,
+        pyeep.get_channel_status,
+        pyeep.get_channel_type,
+    )
+    for k in range(n_channels):
+        expected = [func(cnt._handle, k) for func in getters]
+        expected = tuple(
+            "" if elt is None else elt.decode("latin-1") for elt in expected
+        )
+        assert tuple(field[k] for field in channels) == expected
+        assert cnt.get_channel(k, encoding="latin-1") == expected
+    scales = [pyeep.get_channel_scale(cnt._handle, k) for k in range(n_channels)]
+    assert_array_equal(cnt.get_channel_scales(), np.array(scales, dtype=np.float32))
+
+
+@pytest.mark.parametrize("dataset", DATASETS)
+def test_get_recording_info(dataset, request):
+    """Test getting all the recording information at once."""
+    dataset = request.getfixturevalue(dataset)
+    cnt = read_cnt(dataset["cnt"]["short"])
+    info = cnt.get_recording_info(encoding="latin-1")
+    for key in (
+        "hospital",
+        "machine_make",
+        "machine_model",
+        "machine_serial_number",
+        "patient_name",
+        "patient_id",
+    ):
+        value = getattr(pyeep, f"get_{key}")(cnt._handle)
+        assert info[key] == ("" if value is None else value.decode("latin-1"))
+    for key in ("test_name", "physician", "technician", "comment"):
+        assert isinstance(info[key], str)
+    assert info["hospital"] == dataset["hospital"]
+    assert info["patient_sex"] == dataset["patient_info"]["sex"]
+    assert isinstance(info["date_of_birth"], date)
+    start_time = pyeep.get_start_time(cnt._handle)
+    assert cnt.get_start_time() == datetime.fromtimestamp(start_time, timezone.utc)
+
+
 def test_read_invalid_cnt(tmp_path):
     """Test reading of an invalid file."""
     with open(tmp_path / "test.txt", "w") as fid:
@@ -161,6 +225,202 @@ def test_get_invalid_samples(dataset, request):
     assert samples_np.size == len(samples)
 
 
+def test_get_samples_out(ca_208):
+    """Test decoding samples into a preallocated array."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    expected = cnt.get_samples_as_nparray(100, 300)
+    assert not expected.flags.writeable
+    out = np.empty((n_channels, 200), dtype=np.float32, order="F")
+    assert cnt.get_samples_as_nparray(100, 300, out=out) is out
+    np.testing.assert_array_equal(out, expected)
+    # the same buffer is reused for the next block
+    cnt.get_samples_as_nparray(300, 500, out=out)
+    np.testing.assert_array_equal(out, cnt.get_samples_as_nparray(300, 500))
+    with pytest.raises(ValueError, match="output shape"):
+        cnt.get_samples_as_nparray(100, 200, out=out)
+    with pytest.raises(ValueError, match="C-contiguous"):
+        cnt.get_samples_as_nparray(100, 300, out=np.empty((n_channels, 200), "f4"))
+    with pytest.raises(TypeError, match="float32"):
+        cnt.get_samples_as_nparray(100, 300, out=np.empty((n_channels, 200), "f8"))
+    out.flags.writeable = False
+    with pytest.raises(ValueError, match="writable"):
+        cnt.get_samples_as_nparray(100, 300, out=out)
+
+
+def test_get_samples_as_nparray_release(ca_208):
+    """Test that the memory of the returned arrays is released with them."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_samples = cnt.get_sample_count()
+    size = 4 * cnt.get_channel_count() * n_samples
+    tracemalloc.start()
+    try:
+        for _ in range(10):
+            data = cnt.get_samples_as_nparray(0, n_samples)
+            assert data.base.nbytes == size
+            del data
+        current, peak = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    assert size <= peak < 2 * size
+    assert current < size
+
+
+@pytest.mark.parametrize("reuse_buffer", [False, True])
+@pytest.mark.parametrize(
+    ("chunk_samples", "overlap", "channels", "dtype"),
+    [
+        (None, 0, None, np.float32),
+        (1000, 0, [3, 0, -1], np.float64),
+        (777, 100, None, np.float32),
+        (50, 49, [1, 2], np.float64),
+    ],
+)
+def test_iter_chunks(
+    chunk_samples, overlap, channels, dtype, reuse_buffer, user_annotations
+):
+    """Test iterating over blocks of samples."""
+    cnt = read_cnt(user_annotations["cnt"]["short"])
+    n_samples = cnt.get_sample_count()
+    data = cnt.get_samples_as_nparray(0, n_samples)
+    if channels is not None:
+        data = data[channels]
+    size = cnt.get_epoch_length() if chunk_samples is None else chunk_samples
+    starts = []
+    first = None
+    for start, samples in cnt.iter_chunks(
+        chunk_samples,
+        overlap,
+        channels=channels,
+        dtype=dtype,
+        reuse_buffer=reuse_buffer,
+    ):
+        assert samples.dtype == dtype
+        assert samples.shape == (data.shape[0], min(size, n_samples - start))
+        assert_allclose(samples, data[:, start : start + size])
+        starts.append(start)
+        first = samples if first is None else first
+        assert np.shares_memory(first, samples) == reuse_buffer or start == 0
+    # the blocks stop with the first one reaching the end of the recording
+    assert starts == list(range(0, n_samples - overlap, size - overlap))
+
+
+def test_iter_chunks_invalid(ca_208):
+    """Test the validation of the block iterator arguments."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    with pytest.raises(ValueError, match="should be positive"):
+        next(cnt.iter_chunks(0))
+    with pytest.raises(ValueError, match="overlap"):
+        next(cnt.iter_chunks(100, 100))
+    with pytest.raises(ValueError, match="out of range"):
+        next(cnt.iter_chunks(100, channels=[cnt.get_channel_count()]))
+    with pytest.raises(TypeError, match="indices"):
+        next(cnt.iter_chunks(100, channels=["Fp1"]))
+
+
+def test_as_array(user_annotations):
+    """Test the lazy array view of a recording."""
+    cnt = read_cnt(user_annotations["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    data = cnt.get_samples_as_nparray(0, n_samples)
+    array = cnt.as_array(cache_epochs=1)
+    assert array.shape == (n_channels, n_samples)
+    assert array.dtype == np.float32
+    assert array.ndim == 2
+    assert len(array) == n_channels
+    keys = [
+        (slice(None), slice(7990, 8010)),
+        (slice(2, 5), slice(None, None, 97)),
+        ([4, 0, -1], slice(8100, 7000, -3)),
+        (1, slice(10, 20)),
+        (slice(None), 8005),
+        (3, -1),
+        (Ellipsis, [8200, 5, 8001, 5]),
+        np.s_[::2],
+        np.s_[..., 100:110],
+    ]
+    for key in keys:
+        assert_allclose(array[key], data[key])
+    # each epoch is read once, then served from the cache
+    array = cnt.as_array(cache_epochs=2)
+    cnt.reset_stats()
+    array[:, 7990:8010]
+    assert cnt.get_stats()["seeks"] == 2
+    array[:, 8001:8010]
+    array[:5, 10]
+    assert cnt.get_stats()["seeks"] == 2
+    assert_allclose(np.asarray(array), data)
+    assert np.asarray(array, dtype=np.float64).dtype == np.float64
+    copied = np.array(array, copy=True)
+    copied[:] = 0
+    assert_allclose(np.asarray(array, dtype=np.float64, copy=None), data)
+    with pytest.raises(ValueError, match="without copy"):
+        np.asarray(array, copy=False)
+    # empty sample selections
+    for key in (np.s_[:, 5:5], np.s_[:, []], np.s_[:, 10:2], np.s_[2:4, 5:5]):
+        empty = array[key]
+        assert empty.shape == data[key].shape
+        assert empty.dtype == np.float32
+    with pytest.raises(IndexError, match="out of range"):
+        array[:, n_samples]
+    with pytest.raises(IndexError, match="Too many indices"):
+        array[0, 0, 0]
+    with pytest.raises(ValueError, match="At least one epoch"):
+        cnt.as_array(0)
+
+
+@pytest.mark.parametrize("dataset", DATASETS)
+def test_get_raw_samples(dataset, request):
+    """Test reading the unscaled samples and the channel scales."""
+    dataset = request.getfixturevalue(dataset)
+    cnt = read_cnt(dataset["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    scales = cnt.get_channel_scales()
+    assert scales.shape == (n_channels,)
+    assert scales.dtype == np.float32
+    raw = cnt.get_raw_samples_as_nparray(0, n_samples)
+    assert raw.shape == (n_channels, n_samples)
+    assert raw.dtype == np.int32
+    data = cnt.get_samples_as_nparray(0, n_samples)
+    assert_array_equal(raw.astype(np.float32) * scales[:, np.newaxis], data)
+    out = np.zeros((10, n_channels), dtype=np.int32).T
+    assert cnt.get_raw_samples_as_nparray(5, 15, out=out) is out
+    assert_array_equal(out, raw[:, 5:15])
+    with pytest.raises(TypeError, match="int32"):
+        cnt.get_raw_samples_as_nparray(5, 15, out=out.astype(np.int64))
+    with pytest.raises(ValueError, match="C-contiguous"):
+        cnt.get_raw_samples_as_nparray(5, 15, out=np.ascontiguousarray(out))
+    with pytest.raises(RuntimeError, match="exceeds"):
+        cnt.get_raw_samples_as_nparray(0, n_samples + 1)
+
+
+def test_raw_array(ca_208):
+    """Test the int32 array scaled on access."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_samples = cnt.get_sample_count()
+    data = cnt.get_samples_as_nparray(0, n_samples)
+    array = cnt.load_raw_array()
+    assert array.shape == data.shape
+    assert array.dtype == np.float32
+    assert len(array) == data.shape[0]
+    assert array.nbytes < data.astype(np.float64).nbytes / 1.9
+    for key in (np.s_[:, 10:20], np.s_[[3, 0], ::7], np.s_[2], np.s_[1, -1]):
+        assert_array_equal(array[key], data[key])
+    assert_array_equal(np.asarray(array), data)
+    assert np.asarray(array, dtype=np.float64).dtype == np.float64
+    copied = np.array(array, copy=True)
+    copied[:] = 0
+    assert_array_equal(np.asarray(array, copy=None), data)
+    with pytest.raises(ValueError, match="without copy"):
+        np.asarray(array, copy=False)
+    array = cnt.load_raw_array(100, 200)
+    assert_array_equal(np.asarray(array), data[:, 100:200])
+    with pytest.raises(ValueError, match="scales shape"):
+        RawArray(array.raw, array.scales[1:])
+
+
 @pytest.mark.parametrize("dataset", DATASETS)
 def test_get_patient_information(dataset, birthday_format, request):
     """Test reading the patient information."""
@@ -204,6 +464,36 @@ def test_get_base_triggers(dataset, request):
     assert len(cnt.get_trigger(0)[5].split(" ")) == n_channels
 
 
+@pytest.mark.parametrize("dataset", DATASETS)
+def test_get_triggers(dataset, request):
+    """Test getting all the triggers as columns."""
+    dataset = request.getfixturevalue(dataset)
+    cnt = read_cnt(dataset["cnt"]["short"])
+    n_triggers = cnt.get_trigger_count()
+    triggers = cnt.get_triggers()
+    for key in ("sample", "duration", "type", "code", "label", "condition"):
+        assert len(triggers[key]) == n_triggers
+    impedances = []
+    for k in range(n_triggers):
+        code, idx, duration, condition, description, impedance = cnt.get_trigger(k)
+        assert triggers["label"][k] == code
+        assert triggers["sample"][k] == idx
+        assert triggers["duration"][k] == duration
+        assert triggers["condition"][k] == condition
+        assert triggers["description"][k] == description
+        if impedance is not None:
+            impedances.append((k, [float(elt) for elt in impedance.split(" ")]))
+    assert triggers["impedance_index"].tolist() == [k for k, _ in impedances]
+    assert triggers["impedance_size"].tolist() == [len(row) for _, row in impedances]
+    assert triggers["impedances"].shape[0] == len(impedances)
+    if impedances:
+        assert triggers["impedances"].shape[1] == cnt.get_channel_count()
+        assert_array_equal(triggers["impedances"], [row for _, row in impedances])
+    # equal strings are shared
+    labels = [elt for elt in triggers["label"] if elt == triggers["label"][0]]
+    assert all(elt is labels[0] for elt in labels)
+
+
 @pytest.mark.parametrize("dataset", DATASETS)
 def test_get_invalid_triggers(dataset, request):
     """Test getting triggers from an invalid index."""
@@ -216,3 +506,555 @@ def test_get_invalid_triggers(dataset, request):
     trigger = cnt.get_trigger(cnt.get_trigger_count() - 1)
     assert isinstance(trigger, tuple)
     assert len(trigger) != 0
+
+
+def _write_cnt(
+    fname,
+    cnt,
+    buffering=None,
+    step=37,
+    epoch_length=0,
+    optimize_channels=False,
+    compression_level=None,
+    adaptive_coding=False,
+    lpc_prediction=False,
+):
+    """Copy the samples of an InputCNT to a new file with pyeep."""
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        label, unit, ref, _, _ = cnt.get_channel(k, encoding="latin-1")
+        pyeep.add_channel(channel_info, label, ref, unit)
+    sfreq = cnt.get_sample_frequency()
+    handle = pyeep.write_cnt(str(fname), sfreq, channel_info, 0, epoch_length)
+    assert handle != -1
+    if buffering is not None:
+        assert pyeep.set_write_buffering(handle, *buffering) == 0
+    if optimize_channels:
+        assert pyeep.set_channel_order_optimization(handle, 1) == 0
+    if compression_level is not None:
+        assert pyeep.set_compression_level(handle, compression_level) == 0
+    if adaptive_coding:
+        assert pyeep.set_adaptive_coding(handle, 1) == 0
+    if lpc_prediction:
+        assert pyeep.set_lpc_prediction(handle, 1) == 0
+    for start in range(0, n_samples, step):
+        stop = min(start + step, n_samples)
+        pyeep.add_samples(handle, cnt.get_samples(start, stop), n_channels)
+    pyeep.close(handle)
+
+
+@pytest.mark.parametrize("buffering", [(1 << 16, 1 << 20), (64, 0), (0, 1 << 20)])
+def test_write_buffering(buffering, ca_208, tmp_path, monkeypatch):
+    """Test that large-block writing produces the same file as direct writing."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    # the file name ends up in the header history, keep it identical
+    (tmp_path / "direct").mkdir()
+    (tmp_path / "buffered").mkdir()
+    monkeypatch.chdir(tmp_path / "direct")
+    _write_cnt("test.cnt", cnt)
+    monkeypatch.chdir(tmp_path / "buffered")
+    _write_cnt("test.cnt", cnt, buffering)
+    direct = (tmp_path / "direct" / "test.cnt").read_bytes()
+    buffered = (tmp_path / "buffered" / "test.cnt").read_bytes()
+    assert direct == buffered
+    written = read_cnt(tmp_path / "buffered" / "test.cnt")
+    assert written.get_sample_count() == cnt.get_sample_count()
+    assert_allclose(
+        written.get_samples_as_nparray(0, 100),
+        cnt.get_samples_as_nparray(0, 100),
+        atol=1 / 128,
+    )
+
+
+@pytest.mark.parametrize("epoch_length", [0, 1, 7, 100, 4096])
+def test_write_epoch_length(epoch_length, ca_208, tmp_path):
+    """Test writing with a custom compression epoch length."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    assert cnt.get_epoch_length() > 0
+    _write_cnt(tmp_path / "test.cnt", cnt, epoch_length=epoch_length)
+    written = read_cnt(tmp_path / "test.cnt")
+    expected = epoch_length if epoch_length else cnt.get_sample_frequency()
+    assert written.get_epoch_length() == expected
+    assert written.get_sample_count() == cnt.get_sample_count()
+    n_samples = cnt.get_sample_count()
+    for start, stop in ((0, 10), (95, 205), (n_samples - 3, n_samples)):
+        assert_allclose(
+            written.get_samples_as_nparray(start, stop),
+            cnt.get_samples_as_nparray(start, stop),
+            atol=1 / 128,
+        )
+
+
+def test_write_channel_order_optimization(ca_208, tmp_path):
+    """Test writing with a channel sequence optimized for compression."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    _write_cnt(tmp_path / "identity.cnt", cnt)
+    _write_cnt(tmp_path / "optimized.cnt", cnt, optimize_channels=True)
+    size_identity = (tmp_path / "identity.cnt").stat().st_size
+    size_optimized = (tmp_path / "optimized.cnt").stat().st_size
+    assert size_optimized < size_identity
+    written = read_cnt(tmp_path / "optimized.cnt")
+    assert written.get_sample_count() == cnt.get_sample_count()
+    for start, stop in ((0, 10), (995, 1005), (5000, 6000)):
+        assert_allclose(
+            written.get_samples_as_nparray(start, stop),
+            cnt.get_samples_as_nparray(start, stop),
+            atol=1 / 128,
+        )
+
+
+def test_write_channel_order_optimization_too_late(ca_208, tmp_path):
+    """Test that the channel sequence cannot change once an epoch is written."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    channel_info = pyeep.create_channel_info()
+    for k in range(cnt.get_channel_count()):
+        pyeep.add_channel(channel_info, f"ch{k}", "ref", "uV")
+    handle = pyeep.write_cnt(
+        str(tmp_path / "test.cnt"), cnt.get_sample_frequency(), channel_info, 0, 10
+    )
+    pyeep.add_samples(handle, cnt.get_samples(0, 20), cnt.get_channel_count())
+    assert pyeep.set_channel_order_optimization(handle, 1) == -1
+    pyeep.close(handle)
+
+
+def test_write_zero_samples(ca_208, tmp_path, capfd):
+    """Test that empty sample blocks are accepted and write nothing."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        pyeep.add_channel(channel_info, f"ch{k}", "ref", "uV")
+    handle = pyeep.write_cnt(
+        str(tmp_path / "test.cnt"), cnt.get_sample_frequency(), channel_info, 0, 10
+    )
+    pyeep.add_samples(handle, [], n_channels)
+    pyeep.add_samples(handle, cnt.get_samples(0, 20), n_channels)
+    pyeep.add_samples(handle, [], n_channels)
+    pyeep.close(handle)
+    assert "cannot allocate" not in capfd.readouterr().err
+    written = read_cnt(tmp_path / "test.cnt")
+    assert written.get_sample_count() == 20
+    assert_allclose(
+        written.get_samples_as_nparray(0, 20),
+        cnt.get_samples_as_nparray(0, 20),
+        atol=1 / 128,
+    )
+
+
+@pytest.mark.parametrize("level", [0, 1, 2])
+def test_write_compression_level(level, ca_208, tmp_path, monkeypatch):
+    """Test the compression encoder levels."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    (tmp_path / "default").mkdir()
+    (tmp_path / "level").mkdir()
+    monkeypatch.chdir(tmp_path / "default")
+    _write_cnt("test.cnt", cnt)
+    monkeypatch.chdir(tmp_path / "level")
+    _write_cnt("test.cnt", cnt, compression_level=level)
+    default = (tmp_path / "default" / "test.cnt").read_bytes()
+    written = (tmp_path / "level" / "test.cnt").read_bytes()
+    if level == 0:
+        assert default == written
+    else:
+        # a subsample decides the prediction method, costing a bit of compression
+        assert len(written) < 1.01 * len(default)
+    written = read_cnt(tmp_path / "level" / "test.cnt")
+    n_samples = cnt.get_sample_count()
+    assert written.get_sample_count() == n_samples
+    assert_allclose(
+        written.get_samples_as_nparray(0, n_samples),
+        cnt.get_samples_as_nparray(0, n_samples),
+        atol=1 / 128,
+    )
+
+
+def test_write_invalid_compression_level(tmp_path):
+    """Test setting an unknown compression level."""
+    channel_info = pyeep.create_channel_info()
+    pyeep.add_channel(channel_info, "ch", "ref", "uV")
+    handle = pyeep.write_cnt(str(tmp_path / "test.cnt"), 1000, channel_info, 0)
+    assert pyeep.set_compression_level(handle, 3) == -1
+    assert pyeep.set_compression_level(handle, -1) == -1
+    pyeep.close(handle)
+
+
+@pytest.mark.parametrize("compression_level", [0, 1, 2])
+def test_write_adaptive_coding(compression_level, ca_208, tmp_path):
+    """Test writing with adaptive residual coding."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    _write_cnt(tmp_path / "fixed.cnt", cnt, compression_level=compression_level)
+    _write_cnt(
+        tmp_path / "adaptive.cnt",
+        cnt,
+        compression_level=compression_level,
+        adaptive_coding=True,
+    )
+    fixed = (tmp_path / "fixed.cnt").read_bytes()
+    adaptive = (tmp_path / "adaptive.cnt").read_bytes()
+    assert len(adaptive) < len(fixed)
+    # the EEG data is stored in a list older readers don't look for
+    assert b"raw3" in fixed and b"arw3" not in fixed
+    assert b"arw3" in adaptive and b"raw3" not in adaptive
+    fixed = read_cnt(tmp_path / "fixed.cnt")
+    adaptive = read_cnt(tmp_path / "adaptive.cnt")
+    n_samples = cnt.get_sample_count()
+    assert adaptive.get_sample_count() == n_samples
+    assert_allclose(
+        adaptive.get_samples_as_nparray(0, n_samples),
+        fixed.get_samples_as_nparray(0, n_samples),
+        rtol=0,
+        atol=0,
+    )
+
+
+def test_write_adaptive_coding_too_late(ca_208, tmp_path):
+    """Test that adaptive coding can't be enabled once an epoch is written."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        pyeep.add_channel(channel_info, f"ch{k}", "ref", "uV")
+    handle = pyeep.write_cnt(str(tmp_path / "test.cnt"), 1000, channel_info, 0, 10)
+    pyeep.add_samples(handle, cnt.get_samples(0, 20), n_channels)
+    assert pyeep.set_adaptive_coding(handle, 1) == -1
+    pyeep.close(handle)
+
+
+@pytest.mark.parametrize("adaptive_coding", [False, True])
+@pytest.mark.parametrize("compression_level", [0, 2])
+def test_write_lpc_prediction(compression_level, adaptive_coding, ca_208, tmp_path):
+    """Test writing with linear prediction blocks."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    kwargs = dict(compression_level=compression_level, adaptive_coding=adaptive_coding)
+    _write_cnt(tmp_path / "default.cnt", cnt, **kwargs)
+    _write_cnt(tmp_path / "lpc.cnt", cnt, lpc_prediction=True, **kwargs)
+    default = (tmp_path / "default.cnt").read_bytes()
+    lpc = (tmp_path / "lpc.cnt").read_bytes()
+    assert len(lpc) < len(default)
+    # only files which need it are stamped with the new version
+    assert b"[File Version]\n4.1\n" in default
+    assert b"[File Version]\n5.0\n" in lpc
+    default = read_cnt(tmp_path / "default.cnt")
+    lpc = read_cnt(tmp_path / "lpc.cnt")
+    n_samples = cnt.get_sample_count()
+    assert lpc.get_sample_count() == n_samples
+    assert_allclose(
+        lpc.get_samples_as_nparray(0, n_samples),
+        default.get_samples_as_nparray(0, n_samples),
+        rtol=0,
+        atol=0,
+    )
+    lpc.set_compression_stats()
+    for epoch in range(-(-n_samples // lpc.get_epoch_length())):
+        lpc.scan_compression_stats(epoch)
+    assert lpc.get_compression_stats()["methods"][:, 12].sum() > 0
+
+
+def test_write_lpc_prediction_too_late(ca_208, tmp_path):
+    """Test that linear prediction can't be enabled once an epoch is written."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        pyeep.add_channel(channel_info, f"ch{k}", "ref", "uV")
+    handle = pyeep.write_cnt(str(tmp_path / "test.cnt"), 1000, channel_info, 0, 10)
+    pyeep.add_samples(handle, cnt.get_samples(0, 20), n_channels)
+    assert pyeep.set_lpc_prediction(handle, 1) == -1
+    pyeep.close(handle)
+
+
+@pytest.mark.parametrize("compression_level", [0, 1, 2])
+def test_compression_stats(compression_level, ca_208, tmp_path):
+    """Test that encoder and decoder report the same compression statistics."""
+    cnt = read_cnt(ca_208["cnt"]["start-stop"])
+    n_channels = cnt.get_channel_count()
+    n_samples = cnt.get_sample_count()
+    channel_info = pyeep.create_channel_info()
+    for k in range(n_channels):
+        label, unit, ref, _, _ = cnt.get_channel(k, encoding="latin-1")
+        pyeep.add_channel(channel_info, label, ref, unit)
+    fname = tmp_path / "test.cnt"
+    sfreq = cnt.get_sample_frequency()
+    handle = pyeep.write_cnt(str(fname), sfreq, channel_info, 0, 100)
+    assert pyeep.set_compression_level(handle, compression_level) == 0
+    assert pyeep.set_compression_stats(handle, 1) == 0
+    pyeep.add_samples(handle, cnt.get_samples(0, n_samples), n_channels)
+    # the last, incomplete epoch is compressed when the file is closed
+    written = [pyeep.get_compression_stats(handle, k) for k in range(n_channels)]
+    pyeep.close(handle)
+
+    n_epochs = n_samples // 100
+    assert all(value[0] == n_epochs for value in written)
+    assert sum(value[2] for value in written) < n_channels * n_epochs * 100 * 4
+    cnt = read_cnt(fname)
+    with pytest.raises(RuntimeError, match="not collected"):
+        cnt.get_compression_stats()
+    cnt.set_compression_stats()
+    for epoch in range(n_epochs):
+        cnt.scan_compression_stats(epoch)
+    read = [pyeep.get_compression_stats(cnt._handle, k) for k in range(n_channels)]
+    assert read == written
+
+    stats = cnt.get_compression_stats()
+    assert_allclose(stats["methods"].sum(axis=1), n_epochs)
+    assert (stats["nbits_mean"] <= stats["nbits_max"]).all()
+    assert (stats["exceptions"] < stats["samples"]).all()
+    # scanning does not interfere with reading, and covers exactly one epoch
+    cnt.reset_compression_stats()
+    data = cnt.get_samples_as_nparray(0, 250)
+    cnt.scan_compression_stats(n_epochs)
+    assert_allclose(cnt.get_samples_as_nparray(0, 250), data)
+    cnt.reset_compression_stats()
+    cnt.scan_compression_stats(n_epochs)
+    stats = cnt.get_compression_stats()
+    assert (stats["blocks"] == 1).all()
+    assert (stats["samples"] == n_samples - n_epochs * 100).all()
+    with pytest.raises(RuntimeError, match="out of range"):
+        cnt.scan_compression_stats(n_epochs + 1)
+
+
+def _decode(fname, step):
+    """Read all samples and triggers of a CNT file, step samples at a time."""
+    cnt = read_cnt(fname)
+    n_samples = cnt.get_sample_count()
+    data = np.concatenate(
+        [
+            cnt.get_samples_as_nparray(start, min(start + step, n_samples))
+            for start in range(0, n_samples, step)
+        ],
+        axis=1,
+    )
+    triggers = [cnt.get_trigger(k) for k in range(cnt.get_trigger_count())]
+    return data, triggers
+
+
+def test_concurrent_decoding(request):
+    """Test that files decoded on many threads match the sequential decode."""
+    fnames = [
+        fname
+        for dataset in DATASETS
+        for fname in request.getfixturevalue(dataset)["cnt"].values()
+    ]
+    expected = [_decode(fname, 1000) for fname in fnames]
+    # interleave the files and vary the read size so that handles are opened,
+    # read and closed concurrently
+    jobs = [(k % len(fnames), 500 + 37 * k) for k in range(4 * len(fnames))]
+    with ThreadPoolExecutor(max_workers=8) as executor:
+        results = list(executor.map(lambda job: _decode(fnames[job[0]], job[1]), jobs))
+    for (idx, _), (data, triggers) in zip(jobs, results):
+        np.testing.assert_array_equal(data, expected[idx][0])
+        assert triggers == expected[idx][1]
+
+
+def test_concurrent_reads_same_handle(user_annotations):
+    """Test that threads sharing one handle read the same samples."""
+    cnt = read_cnt(user_annotations["cnt"]["short"])
+    n_samples = cnt.get_sample_count()
+    ranges = [(fro, min(fro + 700, n_samples)) for fro in range(0, n_samples, 350)]
+    expected = [cnt.get_samples_as_nparray(*elt) for elt in ranges]
+    with ThreadPoolExecutor(max_workers=8) as executor:
+        arrays = list(
+            executor.map(lambda elt: cnt.get_samples_as_nparray(*elt), 3 * ranges)
+        )
+        lists = list(executor.map(lambda elt: cnt.get_samples(*elt), ranges))
+    for data, ref in zip(arrays, 3 * expected):
+        np.testing.assert_array_equal(data, ref)
+    for data, ref in zip(lists, expected):
+        np.testing.assert_array_equal(np.reshape(data, ref.shape[::-1]).T, ref)
+
+
+def test_handle_reuse(ca_208):
+    """Test that closed handles are recycled and stale handles are rejected."""
+    fname = str(ca_208["cnt"]["short"])
+    first = pyeep.read(fname)
+    n_samples = pyeep.get_sample_count(first)
+    pyeep.close(first)
+    assert pyeep.get_sample_count(first) == -1
+    handles = set()
+    for _ in range(100):
+        handle = pyeep.read(fname)
+        assert handle not in (-1, first)
+        assert pyeep.get_sample_count(handle) == n_samples
+        pyeep.close(handle)
+        handles.add(handle)
+    # the same slot is reused with a new generation each time
+    assert len(handles) == 100
+    assert len({handle & 0xFFFFF for handle in handles}) == 1
+    # closing twice or using a write-only call on a read handle fails cleanly
+    pyeep.close(handle)
+    handle = pyeep.read(fname)
+    assert pyeep.set_compression_level(handle, 0) == -1
+    pyeep.close(handle)
+    assert pyeep.get_channel_count(handle) == -1
+
+
+def test_memory_accounting(ca_208):
+    """Test the allocation accounting per tag and per file."""
+    set_memory_accounting()
+    try:
+        cnt = read_cnt(ca_208["cnt"]["short"])
+        cnt.get_samples(0, 1000)
+        stats = cnt.get_memory_stats()
+        # decoded epoch and epoch table of the file
+        for tag in ("buf", "epochv"):
+            assert stats[tag]["live_bytes"] > 0
+            assert stats[tag]["live_blocks"] >= 1
+        total = stats.pop("total")
+        assert total["live_bytes"] == sum(elt["live_bytes"] for elt in stats.values())
+        assert total["allocations"] == sum(elt["allocations"] for elt in stats.values())
+        live = total["live_bytes"]
+        del cnt
+        stats = get_memory_stats()
+        assert stats["total"]["live_bytes"] <= stats["total"]["peak_bytes"]
+        assert stats["total"]["peak_bytes"] >= live
+        assert stats["buf"]["live_bytes"] == 0
+        assert stats["buf"]["frees"] == stats["buf"]["allocations"]
+        reset_memory_stats()
+        stats = get_memory_stats()
+        assert stats["total"]["peak_bytes"] == stats["total"]["live_bytes"]
+        assert stats["total"]["allocations"] == 0
+        # a second file is accounted separately
+        cnt = read_cnt(ca_208["cnt"]["short"])
+        live = cnt.get_memory_stats()["total"]["live_bytes"]
+        assert 0 < live <= get_memory_stats()["total"]["peak_bytes"]
+    finally:
+        set_memory_accounting(False)
+    assert get_memory_stats() == dict()
+
+
+def test_read_stats(user_annotations, tmp_path):
+    """Test the read performance counters and the trace export."""
+    cnt = read_cnt(user_annotations["cnt"]["short"])
+    epoch_length = cnt.get_epoch_length()
+    cnt.reset_stats()
+    cnt.set_trace()
+    # opening the file buffers the first epoch, the second read is a cache hit
+    cnt.get_samples_as_nparray(epoch_length, epoch_length + 10)
+    cnt.get_samples_as_nparray(epoch_length + 10, epoch_length + 20)
+    cnt.get_samples_as_nparray(0, 10)
+    stats = cnt.get_stats()
+    assert stats["seeks"] == 3
+    assert stats["cache_hits"] == 1
+    assert stats["epochs_decoded"] == 2
+    assert stats["decode_hist"].sum() == 2
+    assert stats["read_hist"].sum() == 2
+    assert stats["bytes_read"] > 0
+    assert stats["decode_ns"] > 0
+    cnt.write_trace(tmp_path / "trace.json")
+    with open(tmp_path / "trace.json") as fid:
+        events = json.load(fid)["traceEvents"]
+    assert [event["name"] for event in events] == ["read", "decode"] * 2
+    assert [event["args"]["epoch"] for event in events] == [1, 1, 0, 0]
+    assert sum(event["args"]["bytes"] for event in events[::2]) == stats["bytes_read"]
+    assert all(event["ph"] == "X" and event["dur"] >= 0 for event in events)
+    cnt.reset_stats()
+    assert cnt.get_stats()["seeks"] == 0
+    with pytest.raises(RuntimeError, match="trace events"):
+        cnt.set_trace(-1)
+
+
+@pytest.mark.parametrize("rf64", [False, True])
+def test_write_synthetic(rf64, tmp_path):
+    """Test writing a synthetic recording with sidecars."""
+    fname = tmp_path / "synthetic.cnt"
+    kwargs = dict(trigger_rate=2.0, rf64=rf64, seed=3)
+    write_synthetic(fname, 8, 500, 20, n_segments=2, sidecars=True, **kwargs)
+    assert fname.with_suffix(".evt").exists()
+    assert fname.with_suffix(".seg").exists()
+    cnt = read_cnt(fname)
+    assert cnt.get_channel_count() == 8
+    assert cnt.get_sample_frequency() == 500
+    assert cnt.get_sample_count() == 10000
+    assert cnt.get_channel(0, encoding="latin-1")[:3] == ("Fp1", "uV", "CPz")
+    data = cnt.get_samples_as_nparray(0, 10000)
+    assert np.all((1 < data.std(axis=1)) & (data.std(axis=1) < 100))
+    # the .evt file adds an impedance measurement at the start and at the end
+    triggers = [cnt.get_trigger(k) for k in range(cnt.get_trigger_count())]
+    assert triggers[0][4] == triggers[-1][4] == "Impedance"
+    assert triggers[0][1] == 0 and triggers[-1][1] == 9999
+    assert len(triggers[0][5].split()) == 8
+    # the samples and the triggers do not depend on the sidecars
+    fname = tmp_path / "synthetic-nosidecars.cnt"
+    write_synthetic(fname, 8, 500, 20, **kwargs)
+    cnt = read_cnt(fname)
+    assert_allclose(cnt.get_samples_as_nparray(0, 10000), data)
+    assert [
+        cnt.get_trigger(k)[:2] for k in range(cnt.get_trigger_count())
+    ] == [trigger[:2] for trigger in triggers[1:-1]]
+    assert 0 < cnt.get_trigger_count() < 100
+    with pytest.raises(ValueError, match="require sidecars"):
+        write_synthetic(fname, 8, 500, 20, n_segments=2)
+    with pytest.raises(RuntimeError, match="Could not write"):
+        write_synthetic(fname, 0, 500, 20)
+
+
+@pytest.mark.parametrize("background", [False, True])
+def test_output_cnt(background, ca_208, tmp_path):
+    """Test writing a file from numpy arrays with recording information."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    ch_names = [cnt.get_channel(k, encoding="latin-1")[0] for k in range(n_channels)]
+    data = cnt.get_samples_as_nparray(0, 3000)
+    meas_date = datetime(2024, 3, 1, 10, 20, 30, 250000, tzinfo=timezone.utc)
+    patient_info = ("Jane Doe", "P01", "F", date(1990, 5, 17))
+    fname = tmp_path / "output.cnt"
+    with write_cnt(
+        fname,
+        cnt.get_sample_frequency(),
+        ch_names,
+        meas_date=meas_date,
+        hospital="Hôpital",
+        machine_info=("ANT", "eego", "1234"),
+        patient_info=patient_info,
+        background=background,
+    ) as output:
+        assert output.get_channel_count() == n_channels
+        # channel major float32 view, interleaved float64 and raw int32 blocks
+        output.add_samples(data[:, :1000])
+        # empty blocks are accepted and do not add samples
+        output.add_samples(data[:, :0])
+        output.add_samples(np.zeros((n_channels, 0), dtype=np.int32))
+        output.add_samples(np.asfortranarray(data[:, 1000:2000], dtype=np.float64))
+        output.add_samples(np.round(data[:, 2000:] * 128).astype(np.int32))
+        output.add_trigger(10, "1")
+        output.add_triggers(np.array([500, 2500]), ["2", "boundary"])
+        output.flush()
+    with pytest.raises(RuntimeError, match="closed"):
+        output.add_samples(data)
+    written = read_cnt(fname)
+    assert written.get_sample_count() == 3000
+    assert_allclose(written.get_samples_as_nparray(0, 3000), data, atol=1 / 128)
+    triggers = [written.get_trigger(k)[:2] for k in range(written.get_trigger_count())]
+    assert triggers == [("1", 10), ("2", 500), ("boundary", 2500)]
+    assert written.get_start_time_and_fraction() == meas_date
+    assert written.get_hospital(encoding="latin-1") == "Hôpital"
+    assert written.get_machine_info(encoding="latin-1") == ("ANT", "eego", "1234")
+    assert written.get_patient_info(encoding="latin-1") == patient_info
+
+
+def test_output_cnt_invalid(tmp_path):
+    """Test the validation of the written samples and triggers."""
+    output = write_cnt(tmp_path / "output.cnt", 500, ["Fp1", "Fp2"], rf64=True)
+    with pytest.raises(ValueError, match="should be of shape"):
+        output.add_samples(np.zeros((3, 10), dtype=np.float32))
+    with pytest.raises(ValueError, match="should be equal"):
+        output.add_triggers([1, 2], ["1"])
+    with pytest.raises(ValueError, match="cannot be negative"):
+        output.add_trigger(-1, "1")
+    with pytest.raises(TypeError, match="float32, float64 or int32"):
+        output.add_samples(np.zeros((2, 10), dtype=np.int16))
+    # reversed strides and a non-native byte order
+    data = np.arange(20, dtype=np.float32).reshape(2, 10)
+    output.add_samples(data[::-1, ::-1])
+    output.add_samples(data.astype(">i4"))
+    output.close()
+    written = read_cnt(tmp_path / "output.cnt")
+    assert written.get_sample_count() == 20
+    assert_allclose(written.get_samples_as_nparray(0, 10), data[::-1, ::-1])
+    assert_allclose(written.get_samples_as_nparray(10, 20), data / 128)
+    with pytest.raises(ValueError, match="should match"):
+        write_cnt(tmp_path / "output.cnt", 500, ["Fp1", "Fp2"], ch_units=["uV"])
+    with pytest.raises(RuntimeError, match="Unsupported file extension"):
+        write_cnt(tmp_path / "output.fif", 500, ["Fp1"])
@@ -7,6 +7,7 @@ from numpy.testing import assert_allclose
 from antio import read_cnt
 from antio.parser import (
     read_data,
+    read_data_into,
     read_device_info,
     read_info,
     read_meas_date,
@@ -105,6 +106,76 @@ def test_read_data(dataset, read_raw_bv, request):
     assert_allclose(data, raw.get_data(), atol=1e-8)
 
 
+@pytest.mark.parametrize("dataset", ["andy_101", "ca_208", "user_annotations"])
+def test_read_data_into(dataset, request):
+    """Test reading the data of picked channels into a preallocated array."""
+    dataset = request.getfixturevalue(dataset)
+    cnt = read_cnt(dataset["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    # span a compression epoch boundary when the recording has more than one
+    n_samples = cnt.get_sample_count()
+    start = max(min(cnt.get_epoch_length(), n_samples) - 100, 0)
+    stop = min(start + 300, n_samples)
+    expected = cnt.get_samples_as_nparray(start, stop).astype(np.float64)
+    picks = np.array([n_channels - 1, 0, 2, 2])
+    cals = np.linspace(0.5, 2, picks.size)
+    # slice of a larger block, as MNE does when it reads a segment
+    block = np.full((picks.size, 2 * (stop - start)), np.nan)
+    out = block[:, 10 : 10 + stop - start]
+    assert read_data_into(cnt, out, start, stop, picks, 1e-6 * cals) is out
+    assert_allclose(out, expected[picks] * 1e-6 * cals[:, np.newaxis], rtol=1e-6)
+    assert np.isnan(block[:, :10]).all()
+    assert np.isnan(block[:, 10 + stop - start :]).all()
+    # all channels and a slice of channels
+    out = read_data_into(cnt, np.empty(expected.shape), start, stop)
+    assert_allclose(out, expected, rtol=1e-6)
+    out = np.empty((n_channels // 2, stop - start))
+    read_data_into(cnt, out, start, stop, slice(None, None, 2))
+    assert_allclose(out, expected[::2], rtol=1e-6)
+    # a single sample and no sample
+    out = np.empty((1, 1))
+    read_data_into(cnt, out, start, start + 1, [3], 2.0)
+    assert_allclose(out, 2 * expected[3:4, :1], rtol=1e-6)
+    read_data_into(cnt, np.empty((picks.size, 0)), start, start, picks)
+
+
+def test_read_data_into_invalid(ca_208):
+    """Test invalid arguments to read_data_into."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_channels = cnt.get_channel_count()
+    out = np.empty((2, 10))
+    with pytest.raises(TypeError, match="float64"):
+        read_data_into(cnt, out.astype(np.float32), 0, 10, [0, 1])
+    with pytest.raises(ValueError, match="shape"):
+        read_data_into(cnt, out, 0, 11, [0, 1])
+    with pytest.raises(ValueError, match="shape"):
+        read_data_into(cnt, out, 0, 10, [0, 1, 2])
+    with pytest.raises(ValueError, match="out of range"):
+        read_data_into(cnt, out, 0, 10, [0, n_channels])
+    with pytest.raises(ValueError, match="out of range"):
+        read_data_into(cnt, out, -1, 9, [0, 1])
+    with pytest.raises(ValueError, match="scale"):
+        read_data_into(cnt, out, 0, 10, [0, 1], [1.0, 2.0, 3.0])
+    with pytest.raises(ValueError, match="C-contiguous"):
+        read_data_into(cnt, np.empty((10, 2)).T, 0, 10, [0, 1])
+    out.flags.writeable = False
+    with pytest.raises(ValueError, match="writable"):
+        read_data_into(cnt, out, 0, 10, [0, 1])
+
+
+def test_read_data_invalid(ca_208):
+    """Test invalid sample ranges of read_data."""
+    cnt = read_cnt(ca_208["cnt"]["short"])
+    n_samples = cnt.get_sample_count()
+    with pytest.raises(RuntimeError, match="cannot be negative"):
+        read_data(cnt, -1, 10)
+    with pytest.raises(RuntimeError, match="exceeds total sample count"):
+        read_data(cnt, 0, n_samples + 1)
+    with pytest.raises(RuntimeError, match="before the start index"):
+        read_data(cnt, 10, 5)
+    assert read_data(cnt, 5, 5).shape == (cnt.get_channel_count(), 0)
+
+
 @pytest.mark.parametrize("dataset", ["andy_101", "ca_208"])
 def test_read_triggers(dataset, read_raw_bv, request):
     """Test reading the triggers from a cnt file."""
@@ -172,6 +243,49 @@ def test_read_triggers_disconnet(ca_208, read_raw_bv):
         assert_allclose(onset1, onset2 / raw.info["sfreq"], atol=2e-3)
 
 
+class _ImpedanceCNT:
+    """Triggers with impedance strings, as returned by InputCNT.get_triggers."""
+
+    def __init__(self, strings, sizes, rows):
+        self._strings = strings
+        n_values = max(len(row) for row in rows)
+        self._triggers = dict(
+            sample=np.arange(len(strings), dtype=np.int64),
+            duration=np.zeros(len(strings), dtype=np.int64),
+            label=["0"] * len(strings),
+            condition=[None] * len(strings),
+            description=["Impedance"] * len(strings),
+            impedance_index=np.arange(len(strings), dtype=np.int32),
+            impedance_size=np.array(sizes, dtype=np.int32),
+            impedances=np.array(
+                [row + [np.nan] * (n_values - len(row)) for row in rows]
+            ),
+        )
+
+    def get_triggers(self):
+        return self._triggers
+
+    def get_trigger(self, k):
+        return ("0", k, 0, None, "Impedance", self._strings[k])
+
+
+def test_read_triggers_impedances():
+    """Test the impedances of uneven and malformed strings."""
+    # libeep refuses the tab, float() accepts it
+    cnt = _ImpedanceCNT(
+        ["5 10", "5 nan 7", "1\t 2"], [2, 3, -1], [[5, 10], [5, np.nan, 7], []]
+    )
+    _, _, descriptions, impedances, _ = read_triggers(cnt)
+    assert descriptions == ["impedance"] * 3
+    assert impedances[0] == [5.0, 10.0]
+    assert impedances[1][0] == 5.0 and np.isnan(impedances[1][1])
+    assert impedances[1][2] == 7.0
+    assert impedances[2] == [1.0, 2.0]
+    cnt = _ImpedanceCNT(["5 10", "1,5 2"], [2, -1], [[5, 10], []])
+    with pytest.raises(ValueError, match="could not convert"):
+        read_triggers(cnt)
+
+
 def test_read_user_annotations(user_annotations):
     """Test reading of user annotations."""
     onsets, durations, descriptions, impedances, disconnect = read_triggers(